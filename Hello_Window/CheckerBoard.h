@@ -1,20 +1,23 @@
 ﻿#pragma once
 
+#include <span>
 #include <vector>
 #include <glm/glm.hpp>
 
-#include "Object.h"
-#include "Checker.h"
+#include "entity.h"
 #include "shader.h"
 #include "font.h"
+#include "animation.h"
+#include "rules.h"
+#include "pdn.h"
 
 class CheckersBoard {
 public:
-    enum GameState { PLAYING, WHITE_WIN, BLACK_WIN };
+    enum GameState { PLAYING, WHITE_WIN, BLACK_WIN, DRAW };
     GameState gameState = PLAYING;
     enum Player { WHITE, BLACK };
     Player currentPlayer = Player::WHITE;
-    static constexpr int SIZE = 8;
+    static constexpr int MAX_SIZE = GameRules::MAX_SIZE;
     glm::vec3 origin;
     float cellSize;
     float height;
@@ -24,6 +27,19 @@ public:
     glm::mat4* projection;
     Shader* shaderFont;
 
+    //--Всё, что нужно кадру, чтобы нарисовать доску: матрицы шашек (стоящих и в движении, масштаб
+    //  доски учтён), подсветка и итог партии. Пишет поток симуляции, рисует поток кадра
+    struct Snapshot {
+        static constexpr int MAX_PIECES = MAX_SIZE * MAX_SIZE / 2;
+        glm::mat4 pieces[2][MAX_PIECES];   // Белые, чёрные
+        uint32_t pieceIds[2][MAX_PIECES];  // Номера для буфера выбора (cellPickId); у шашек в движении 0
+        int pieceCount[2] = { 0, 0 };
+        glm::mat4 highlights[MAX_PIECES];
+        uint32_t highlightIds[MAX_PIECES];
+        int highlightCount = 0;
+        GameState gameState = PLAYING;
+    };
+
     CheckersBoard(Model whiteModel_,
         Model blackModel_,
         Model highlightModel_,
@@ -31,39 +47,149 @@ public:
         Shader* shaderFont_,
         glm::vec3 origin_,
         float cellSize_,
-        float height_ = 0.0f);
-    ~CheckersBoard();
+        float height_ = 0.0f,
+        std::unique_ptr<GameRules> rules_ = makeRules(Variant::RUSSIAN));
+
+    int size() const { return boardSize; }
+    // Центр поля на поверхности доски
+    glm::vec3 cellPosition(int row, int col) const {
+        return origin + glm::vec3(col * cellSize, height, row * cellSize);
+    }
+    // Номер поля в буфере выбора (IdPicker): шашка и подсветка пишут номер своего поля, 0 — «ничего»
+    static uint32_t cellPickId(int row, int col) { return 1 + uint32_t(row * MAX_SIZE + col); }
+    static bool pickedCell(uint32_t id, int& row, int& col) {
+        if (id == 0 || id > uint32_t(MAX_SIZE * MAX_SIZE)) return false;
+        row = int(id - 1) / MAX_SIZE;
+        col = int(id - 1) % MAX_SIZE;
+        return true;
+    }
+    const GameRules& getRules() const { return *rules; }
 
     void resetGame(); // Перезапуск игры
+    // Расстановка из записи партии (тег FEN); история ходов начинается заново
+    void loadPosition(const GameRules::Cells& cells, bool whiteToMove);
+    // Ход целиком (из записи партии): проходит те же шаги, что и щелчки игрока. false — ход недопустим
+    bool playMove(const GameRules::PathMove& move);
+    // Отмена и повтор ходов: мгновенно, снятые шашки возвращаются из запаса, память не выделяется.
+    // Места под шашки и подсветку резервируются вместе с доской: партия не трогает кучу.
+    // announce = false — без сообщения о смене хода (перемотка к началу партии)
+    bool undoMove(bool announce = true);
+    bool redoMove();
+    size_t movesPlayed() const { return played; }
+    bool isAnimating() const { return animations.size() > 0; }
+    void getPosition(GameRules::Cells& cells, bool& whiteToMove) const {
+        currentCells(cells);
+        whiteToMove = currentPlayer == Player::WHITE;
+    }
+
+    // Партия PDN: стартовая расстановка ставится на доску, ходы возвращаются для проигрывания
+    bool loadPdn(const PdnGame& game, std::vector<GameRules::PathMove>& moves, std::string& error);
+    void savePdn(std::ostream& out) const;
     bool checkWinCondition();                          // Проверка победы
+    bool checkDrawCondition();                         // Троекратное повторение или ходы одними дамками
+    void loseOnTime();                                 // Сторона, чей ход, просрочила время
 
     // Process click on board cell
     void onCellClick(int row, int col);
-    // Draw all checkers and highlights
-    void render(Shader& shader);
+    // Время анимаций: ходы, начатые до следующего update, стартуют с этого момента
+    void setTime(float now) { clock = now; }
+    // Advance piece animations to time now (seconds)
+    void update(float now);
+    // Картинка доски после update — для потока кадра (заодно пересчитывает матрицы сдвинутых шашек)
+    void snapshot(Snapshot& out);
+    // Draw all checkers and highlights. Читает только модели и масштаб, которые не меняются после
+    // построения доски, поэтому вызывается из потока кадра параллельно с симуляцией
+    void render(const Snapshot& snapshot, Shader& shader) const;
+
+    // Занятость хранилища сущностей (для профиля кадра)
+    size_t checkersInUse() const { return entities.alive() - highlights.size(); }
+    size_t checkerCapacity() const { return 2 * squares; }
+    size_t highlightsInUse() const { return highlights.size(); }
+    size_t highlightCapacity() const { return squares; }
 
 private:
-    bool canJumpAgain = false;  // Может ли шашка прыгать снова
-    int jumpRow = -1;           // Текущая строка прыгающей шашки
-    int jumpCol = -1;           // Текущий столбец прыгающей шашки
-
-    Checker* board[SIZE][SIZE] = { {} };
+    std::unique_ptr<GameRules> rules;
+    int boardSize;
+    float pieceScale;           // Модели шашек рассчитаны на клетку доски 8x8
+    float kingLift;             // Дамка стоит на перевёрнутой шашке: выше на высоту шашки
+    size_t squares;             // Тёмных полей: шашек одного цвета на доске не бывает больше
+
+    // Допустимые ходы текущего игрока (считаются раз за ход) и ходы, подходящие под уже сделанные шаги.
+    // Действительны первые legalCount ходов, остальные — запас выделенных путей для следующих пересчётов
+    std::vector<GameRules::PathMove> legalMoves;
+    size_t legalCount = 0;
+    std::vector<const GameRules::PathMove*> candidates, nextCandidates;
+    std::vector<std::pair<int, int>> replayPath; // Путь хода из playMove (legalMoves меняются по ходу)
+    int stepsDone = 0;          // Сколько прыжков серии уже сделано
+
+    // Запись партии: стартовая расстановка и ходы. plies[played..recorded) — отменённые ходы для повтора,
+    // элементы за recorded — запас от прошлых партий и обрезанных веток
+    struct Ply {
+        GameRules::PathMove move;
+        bool promoted = false;   // Шашка стала дамкой этим ходом
+        bool reversible = false; // Тихий ход дамкой
+        uint64_t hash = 0;       // Позиция после хода
+    };
+    GameRules::Cells startCells = {};
+    bool startWhite = true;
+    bool startIsSetup = true;    // Партия начата с начальной расстановки
+    uint64_t startHash = 0;
+    uint64_t positionHash = 0;
+    std::vector<Ply> plies;
+    size_t recorded = 0;
+    size_t played = 0;
+
+    Entity board[MAX_SIZE][MAX_SIZE];
     Model highlightModel;
 
-    std::vector<Object*> highlights;
-    Checker* selectedChecker = nullptr;
+    // Шашки и подсветка — сущности своего хранилища (оно живёт в потоке симуляции). Места в нём
+    // зарезервированы на все тёмные поля для каждого вида, удалённые сущности переиспользуются.
+    // Снятые шашки остаются в capturedPieces (невидимыми) до отмены хода или новой партии
+    EntityStore entities;
+    EntityStore::MeshHandle whiteMesh, blackMesh, highlightMesh;
+    std::vector<Entity> highlights;
+
+    // Анимации ходов: снятые шашки живут в dying, пока не доиграет их исчезновение
+    enum AnimationBatch { ANIM_WHITE, ANIM_BLACK };
+    AnimationSystem animations;
+    std::vector<glm::mat4> animated[2];
+    std::vector<Entity> capturedPieces; // Снятые шашки в порядке взятия (для отмены)
+    std::vector<Entity> dying;    // Снятые, чья анимация исчезновения ещё идёт (ключ анимации — сущность)
+    float clock = 0.0f;
+
+    Entity selectedChecker = NO_ENTITY;
     int selectedRow = -1, selectedCol = -1;
-    bool checkPath(int r1, int c1, int r2, int c2) const;
     void clearHighlights();
-    std::vector<std::pair<int, int>> calculateMoves(int row, int col) const;
-    bool hasCaptures(Player player) const;
-    bool isInside(int r, int c) const { return r >= 0 && r < SIZE && c >= 0 && c < SIZE; }
-    glm::vec3 cellPosition(int row, int col) const {
-        return origin + glm::vec3(col * cellSize, height, row * cellSize);
+    void highlightNextSteps();
+    void refreshMoves();
+    void setupPieces();
+    void clearPieces();
+    void currentCells(GameRules::Cells& cells) const;
+    void startRecording();
+    void recordPly(const GameRules::PathMove& move, bool promoted);
+    void finishAnimations();
+    std::span<const GameRules::PathMove> legal() const { return { legalMoves.data(), legalCount }; }
+    bool mustCapture() const { return legalCount > 0 && !legalMoves[0].taken.empty(); }
+    bool isInside(int r, int c) const { return r >= 0 && r < boardSize && c >= 0 && c < boardSize; }
+    // Новая шашка ставится на поле простой
+    Entity spawnChecker(bool white, int row, int col) {
+        const Entity e = entities.create(white ? whiteMesh : blackMesh, cellPosition(row, col), glm::vec3(0.0f), pieceScale,
+            white ? EntityStore::WHITE : EntityStore::BLACK);
+        entities.pickId[e] = cellPickId(row, col);
+        return e;
     }
-    void switchPlayer() {
+    // Шашка встаёт на поле; дамка перевёрнута и поднята на kingLift
+    void placeChecker(Entity e, int row, int col) {
+        const bool king = isKing(e);
+        entities.place(e, cellPosition(row, col) + glm::vec3(0.0f, king ? kingLift : 0.0f, 0.0f),
+            glm::vec3(0.0f, 0.0f, king ? 180.0f : 0.0f));
+        entities.pickId[e] = cellPickId(row, col);
+    }
+    bool isWhite(Entity e) const { return entities.colour[e] == EntityStore::WHITE; }
+    bool isKing(Entity e) const { return entities.has(e, EntityStore::KING); }
+    void switchPlayer(bool announce = true) {
         currentPlayer = (currentPlayer == Player::WHITE) ? Player::BLACK : Player::WHITE;
-        std::cout << (currentPlayer == Player::WHITE ? "Ход белых\n" : "Ход черных\n");
+        if (announce) std::cout << (currentPlayer == Player::WHITE ? "Ход белых\n" : "Ход черных\n");
     }
 };
 
@@ -75,47 +201,119 @@ CheckersBoard::CheckersBoard (
     Shader* shaderFont_,
     glm::vec3 origin_,
     float cellSize_,
-    float height_)
+    float height_,
+    std::unique_ptr<GameRules> rules_)
     : highlightModel(highlightModel_), origin(origin_), cellSize(cellSize_), 
-    height(height_), blackModel(blackModel_), whiteModel(whiteModel_), font(_font), shaderFont(shaderFont_) {
+    height(height_), blackModel(blackModel_), whiteModel(whiteModel_), font(_font), shaderFont(shaderFont_),
+    rules(std::move(rules_)) {
 
+    boardSize = rules->size();
+    pieceScale = float(RussianRules::SIZE) / boardSize;
+    currentPlayer = rules->whiteStarts() ? Player::WHITE : Player::BLACK;
     textProjection = glm::ortho(0.0f, 1600.0f, 0.0f, 900.0f);
-    for (int r = 0; r < SIZE; ++r)
-        for (int c = 0; c < SIZE; ++c)
-            board[r][c] = nullptr;
-    // Setup initial pieces
-    for (int r = 0; r < 3; ++r)
-        for (int c = 0; c < SIZE; ++c)
-            if ((r + c) % 2 == 1) board[r][c] = new Checker("Black", blackModel, cellPosition(r, c));
-    for (int r = 5; r < SIZE; ++r)
-        for (int c = 0; c < SIZE; ++c)
-            if ((r + c) % 2 == 1) board[r][c] = new Checker("White", whiteModel, cellPosition(r, c));
+    kingLift = whiteModel.checkBox().height * pieceScale;
+    for (int r = 0; r < MAX_SIZE; ++r)
+        for (int c = 0; c < MAX_SIZE; ++c)
+            board[r][c] = NO_ENTITY;
+
+    // Вся память партии выделяется здесь; дальше сущности только создаются и удаляются
+    squares = size_t(boardSize) * boardSize / 2;
+    whiteMesh = entities.addMesh(whiteModel);
+    blackMesh = entities.addMesh(blackModel);
+    highlightMesh = entities.addMesh(highlightModel);
+    entities.reserve(3 * squares);
+    highlights.reserve(squares);
+    capturedPieces.reserve(squares);
+    dying.reserve(squares);
+    candidates.reserve(squares);
+    nextCandidates.reserve(squares);
+    replayPath.reserve(squares);
+    plies.reserve(256);
+
+    setupPieces();
+    entities.updateTransforms();
+    refreshMoves();
+    startRecording();
 }
 
-CheckersBoard::~CheckersBoard() {
-    for (int r = 0; r < SIZE; ++r)
-        for (int c = 0; c < SIZE; ++c)
-            delete board[r][c];
-    clearHighlights();
+// Начальная расстановка: rules->startRows() рядов шашек у каждой стороны
+void CheckersBoard::setupPieces() {
+    const int rows = rules->startRows();
+    for (int r = 0; r < rows; ++r)
+        for (int c = 0; c < boardSize; ++c)
+            if ((r + c) % 2 == 1) board[r][c] = spawnChecker(false, r, c);
+    for (int r = boardSize - rows; r < boardSize; ++r)
+        for (int c = 0; c < boardSize; ++c)
+            if ((r + c) % 2 == 1) board[r][c] = spawnChecker(true, r, c);
 }
 
-bool CheckersBoard::checkWinCondition() {
-    for (int row = 0; row < SIZE; row++) {
-        for (int col = 0; col < SIZE; col++) {
-            if(board[row][col] != nullptr) {
-                if (board[row][col]->isWhite() && currentPlayer == Player::WHITE) {
-                    if (!calculateMoves(row, col).empty()) {
-                        return false;
-                    }
-                }
-                else if (!board[row][col]->isWhite() && currentPlayer == Player::BLACK) {
-                    if (!calculateMoves(row, col).empty()) {
-                        return false;
-                    }
-                }
+void CheckersBoard::clearPieces() {
+    finishAnimations();
+    for (int r = 0; r < boardSize; ++r)
+        for (int c = 0; c < boardSize; ++c)
+            if (board[r][c] != NO_ENTITY) {
+                entities.destroy(board[r][c]);
+                board[r][c] = NO_ENTITY;
             }
-        }
+    for (Entity piece : capturedPieces) entities.destroy(piece);
+    capturedPieces.clear();
+}
+
+void CheckersBoard::currentCells(GameRules::Cells& cells) const {
+    for (int r = 0; r < MAX_SIZE; ++r)
+        for (int c = 0; c < MAX_SIZE; ++c)
+            cells[r][c] = PIECE_NONE;
+    for (int r = 0; r < boardSize; ++r)
+        for (int c = 0; c < boardSize; ++c)
+            if (Entity checker = board[r][c]; checker != NO_ENTITY)
+                cells[r][c] = isWhite(checker)
+                    ? (isKing(checker) ? PIECE_WHITE_KING : PIECE_WHITE)
+                    : (isKing(checker) ? PIECE_BLACK_KING : PIECE_BLACK);
+}
+
+// Текущая расстановка становится началом записи партии (вызывается после refreshMoves)
+void CheckersBoard::startRecording() {
+    currentCells(startCells);
+    startWhite = currentPlayer == Player::WHITE;
+    startHash = positionHash;
+    recorded = 0;
+    played = 0;
+}
+
+// Ход, совпавший с отменённым, сохраняет ветку для повтора; другой ход её обрезает
+void CheckersBoard::recordPly(const GameRules::PathMove& move, bool promoted) {
+    if (played < recorded && plies[played].move.path == move.path && plies[played].move.taken == move.taken) {
+        played++;
+        return;
     }
+    // Ход пишется поверх запасного элемента: assign оставляет уже выделенную память путей
+    if (played == plies.size()) plies.emplace_back();
+    Ply& ply = plies[played];
+    ply.move.path.assign(move.path.begin(), move.path.end());
+    ply.move.taken.assign(move.taken.begin(), move.taken.end());
+    ply.move.promotes = move.promotes;
+    auto [r, c] = move.path.back();
+    ply.promoted = promoted;
+    ply.reversible = move.taken.empty() && isKing(board[r][c]) && !promoted;
+    ply.hash = 0;
+    recorded = ++played;
+}
+
+// Пересчёт допустимых ходов текущего игрока по расстановке на доске
+void CheckersBoard::refreshMoves() {
+    GameRules::Cells cells;
+    currentCells(cells);
+    legalCount = rules->fillLegalMoves(cells, currentPlayer == Player::WHITE, legalMoves);
+    positionHash = rules->hash(cells, currentPlayer == Player::WHITE);
+    if (played > 0) plies[played - 1].hash = positionHash;
+    candidates.clear();
+    stepsDone = 0;
+}
+
+bool CheckersBoard::checkWinCondition() {
+    // Проигрывает тот, кому нечем ходить (шашек не осталось или все заперты)
+    if (legalCount > 0)
+        return false;
     if (currentPlayer == Player::WHITE) {
         gameState = BLACK_WIN;
     }
@@ -125,366 +323,390 @@ bool CheckersBoard::checkWinCondition() {
     return true;
 }
 
+bool CheckersBoard::checkDrawCondition() {
+    // Повториться позиция может только внутри хвоста тихих ходов дамками
+    size_t quiet = 0;
+    while (quiet < played && plies[played - 1 - quiet].reversible) quiet++;
+    if (quiet >= size_t(2 * rules->drawKingMoves())) {
+        gameState = DRAW;
+        std::cout << "Ничья: " << rules->drawKingMoves() << " ходов одними дамками без взятий\n";
+        return true;
+    }
+
+    int repeats = 1;
+    for (size_t back = 2; back <= quiet; back += 2) {
+        uint64_t earlier = back == played ? startHash : plies[played - 1 - back].hash;
+        repeats += earlier == positionHash;
+    }
+    if (repeats >= 3) {
+        gameState = DRAW;
+        std::cout << "Ничья: троекратное повторение позиции\n";
+        return true;
+    }
+    return false;
+}
+
+void CheckersBoard::loseOnTime() {
+    if (gameState != PLAYING) return;
+    gameState = currentPlayer == Player::WHITE ? BLACK_WIN : WHITE_WIN;
+    std::cout << (currentPlayer == Player::WHITE ? "Белые" : "Черные") << " просрочили время\n";
+    // Ход проигравшего обрывается: выбранная шашка и подсветка снимаются, щелчки больше не принимаются
+    clearHighlights();
+    selectedChecker = NO_ENTITY;
+}
+
 // Реализация перезапуска игры
 void CheckersBoard::resetGame() {
-    // Очистка доски
-    for (int r = 0; r < SIZE; ++r) {
-        for (int c = 0; c < SIZE; ++c) {
-            delete board[r][c];
-            board[r][c] = nullptr;
-        }
+    // Партию с начальной расстановки откатываем отменой ходов: шашки не пересоздаются
+    if (startIsSetup && stepsDone == 0) {
+        // Партия могла закончиться до первого хода (флаг, ничья): тогда отменять нечего,
+        // и состояние с очерёдностью восстанавливаются здесь
+        while (undoMove(false)) {}
+        recorded = 0;
+        gameState = PLAYING;
+        currentPlayer = rules->whiteStarts() ? Player::WHITE : Player::BLACK;
+        clearHighlights();
+        selectedChecker = NO_ENTITY;
+        refreshMoves();
+        return;
     }
 
+    // Очистка доски
+    clearPieces();
+
     // Повторная инициализация
-    for (int r = 0; r < 3; ++r) {
-        for (int c = 0; c < SIZE; ++c) {
-            if ((r + c) % 2 == 1) {
-                board[r][c] = new Checker("Black", blackModel, cellPosition(r, c));
+    setupPieces();
+
+    // Сброс состояния
+    gameState = PLAYING;
+    currentPlayer = rules->whiteStarts() ? Player::WHITE : Player::BLACK;
+    clearHighlights();
+    selectedChecker = NO_ENTITY;
+    refreshMoves();
+    startRecording();
+    startIsSetup = true;
+}
+
+void CheckersBoard::loadPosition(const GameRules::Cells& cells, bool whiteToMove) {
+    clearPieces();
+    for (int r = 0; r < boardSize; ++r) {
+        for (int c = 0; c < boardSize; ++c) {
+            const uint8_t code = cells[r][c];
+            if (code == PIECE_NONE) continue;
+            const bool white = code == PIECE_WHITE || code == PIECE_WHITE_KING;
+            board[r][c] = spawnChecker(white, r, c);
+            if (code == PIECE_WHITE_KING || code == PIECE_BLACK_KING) {
+                entities.set(board[r][c], EntityStore::KING, true);
+                placeChecker(board[r][c], r, c);
             }
         }
     }
-    for (int r = 5; r < SIZE; ++r) {
-        for (int c = 0; c < SIZE; ++c) {
-            if ((r + c) % 2 == 1) {
-                board[r][c] = new Checker("White", whiteModel, cellPosition(r, c));
-            }
-        }
+
+    gameState = PLAYING;
+    currentPlayer = whiteToMove ? Player::WHITE : Player::BLACK;
+    clearHighlights();
+    selectedChecker = NO_ENTITY;
+    refreshMoves();
+    startRecording();
+    startIsSetup = false;
+    checkWinCondition();
+}
+
+// Незаконченные анимации доигрываются мгновенно: шашки встают на свои поля
+void CheckersBoard::finishAnimations() {
+    animations.clear();
+    dying.clear();
+    std::fill(entities.tweens.begin(), entities.tweens.end(), uint8_t(0));
+}
+
+bool CheckersBoard::undoMove(bool announce) {
+    if (played == 0 || stepsDone != 0) return false;
+    finishAnimations();
+
+    const Ply& ply = plies[--played];
+    auto [fromR, fromC] = ply.move.path.front();
+    auto [toR, toC] = ply.move.path.back();
+    Entity mover = board[toR][toC];
+    board[toR][toC] = NO_ENTITY;
+    board[fromR][fromC] = mover;
+    if (ply.promoted) entities.set(mover, EntityStore::KING, false);
+    placeChecker(mover, fromR, fromC);
+
+    // Снятые шашки возвращаются в обратном порядке взятия
+    for (size_t i = ply.move.taken.size(); i-- > 0; ) {
+        Entity piece = capturedPieces.back();
+        capturedPieces.pop_back();
+        auto [r, c] = ply.move.taken[i];
+        board[r][c] = piece;
+        entities.set(piece, EntityStore::VISIBLE, true);
+        placeChecker(piece, r, c);
     }
 
-    // Сброс состояния
     gameState = PLAYING;
-    currentPlayer = Player::WHITE;
     clearHighlights();
-    selectedChecker = nullptr;
+    selectedChecker = NO_ENTITY;
+    switchPlayer(announce);
+    refreshMoves();
+    return true;
 }
 
-bool CheckersBoard::hasCaptures(Player player) const {
-    for (int r = 0; r < SIZE; ++r) {
-        for (int c = 0; c < SIZE; ++c) {
-            Checker* checker = board[r][c];
-            if (!checker || (player == Player::WHITE && !checker->isWhite())
-                || (player == Player::BLACK && checker->isWhite())) continue;
-
-            auto moves = calculateMoves(r, c);
-            for (const auto& move : moves) {
-                if (abs(move.first - r) > 1 || abs(move.second - c) > 1) {
-                    // Проверяем, есть ли реальный враг на пути
-                    int dr = (move.first - r) > 0 ? 1 : -1;
-                    int dc = (move.second - c) > 0 ? 1 : -1;
-                    int steps = std::max(abs(move.first - r), abs(move.second - c));
-
-                    for (int i = 1; i < steps; ++i) {
-                        int curR = r + dr * i;
-                        int curC = c + dc * i;
-                        if (board[curR][curC] && board[curR][curC]->isWhite() != checker->isWhite()) {
-                            return true; // Найдено реальное взятие
-                        }
-                    }
-                }
-            }
-        }
+bool CheckersBoard::redoMove() {
+    if (played >= recorded) return false;
+    // Тот же ход recordPly узнаёт и не переписывает, а путь playMove копирует до первого шага
+    return playMove(plies[played].move);
+}
+
+bool CheckersBoard::playMove(const GameRules::PathMove& move) {
+    if (gameState != PLAYING || stepsDone != 0 || move.path.size() < 2) return false;
+
+    const GameRules::PathMove* found = nullptr;
+    for (const auto& m : legal())
+        if (m.path == move.path && m.taken == move.taken) found = &m;
+    if (!found) return false;
+
+    // Ход может ссылаться на legalMoves или plies, а они меняются на последнем шаге
+    replayPath.assign(move.path.begin(), move.path.end());
+    clearHighlights();
+    selectedChecker = board[replayPath[0].first][replayPath[0].second];
+    selectedRow = replayPath[0].first;
+    selectedCol = replayPath[0].second;
+    candidates.clear();
+    candidates.push_back(found);
+    for (size_t i = 1; i < replayPath.size(); ++i)
+        onCellClick(replayPath[i].first, replayPath[i].second);
+    return true;
+}
+
+bool CheckersBoard::loadPdn(const PdnGame& game, std::vector<GameRules::PathMove>& moves, std::string& error) {
+    // Тег GameType другого варианта — ошибка: доска уже построена под свой размер
+    Variant variant = rules->variant();
+    if (variantFromGameType(game.tag("GameType"), variant) && variant != rules->variant()) {
+        error = "партия для другого варианта правил (GameType " + std::string(game.tag("GameType")) + ")";
+        return false;
+    }
+    GameRules::Cells cells = {};
+    bool whiteToMove = true;
+    if (!loadPdnGame(variant, game, cells, whiteToMove, moves, error)) return false;
+    loadPosition(cells, whiteToMove);
+    return true;
+}
+
+void CheckersBoard::savePdn(std::ostream& out) const {
+    const char* result = gameState == WHITE_WIN ? "1-0" : gameState == BLACK_WIN ? "0-1"
+        : gameState == DRAW ? "1/2-1/2" : "*";
+    std::vector<GameRules::PathMove> moves;
+    for (size_t i = 0; i < played; ++i) moves.push_back(plies[i].move);
+    savePdnGame(rules->variant(), out, { { "Event", "Hello_Window" }, { "Result", result } },
+        startCells, startWhite, moves, result);
+}
+
+// Подсветка полей, на которые выбранная шашка может встать следующим шагом
+void CheckersBoard::highlightNextSteps() {
+    clearHighlights();
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const auto square = candidates[i]->path[stepsDone + 1];
+        // Несколько продолжений серии могут идти через одно поле: подсветка на нём одна
+        bool shown = false;
+        for (size_t j = 0; j < i && !shown; ++j)
+            shown = candidates[j]->path[stepsDone + 1] == square;
+        if (shown) continue;
+        const Entity highlight = entities.create(highlightMesh, cellPosition(square.first, square.second),
+            glm::vec3(0.0f), pieceScale);
+        entities.pickId[highlight] = cellPickId(square.first, square.second);
+        highlights.push_back(highlight);
     }
-    return false;
 }
 
 void CheckersBoard::onCellClick(int row, int col) {
     if (!isInside(row, col)) return;
-    if (gameState != PLAYING) std::cout << "Перезапустите игру (нажмите кнопку R)\n";
-    Checker* clickedChecker = board[row][col];
-    bool moveProcessed = false;
-    bool mustCapture = hasCaptures(currentPlayer);
+    if (gameState != PLAYING) {
+        std::cout << "Перезапустите игру (нажмите кнопку R)\n";
+        return;
+    }
+    Entity clickedChecker = board[row][col];
 
     // ─── Блок выбора шашки ────────────────────────────────────────────────
-    if (clickedChecker && !selectedChecker) {
-        if ((currentPlayer == Player::WHITE && clickedChecker->isWhite()) ||
-            (currentPlayer == Player::BLACK && !clickedChecker->isWhite())) {
-
-            auto moves = calculateMoves(row, col);
-            bool hasRealJump = std::any_of(moves.begin(), moves.end(), [row, col](const auto& m) {
-                return abs(m.first - row) > 1 || abs(m.second - col) > 1; });
-
-            // Проверяем только прыжки с реальным врагом на пути
-            for (const auto& move : moves) {
-                if (abs(move.first - row) > 1 || abs(move.second - col) > 1) {
-                    int dr = (move.first - row) > 0 ? 1 : -1;
-                    int dc = (move.second - col) > 0 ? 1 : -1;
-                    int steps = std::max(abs(move.first - row), abs(move.second - col));
-
-                    for (int i = 1; i < steps; ++i) {
-                        int curR = row + dr * i;
-                        int curC = col + dc * i;
-                        if (board[curR][curC] && board[curR][curC]->isWhite() != clickedChecker->isWhite()) {
-                            hasRealJump = true;
-                            break;
-                        }
-                    }
-                    if (hasRealJump) break;
-                }
-            }
+    // Посреди серии прыжков сменить шашку нельзя
+    if (clickedChecker != NO_ENTITY && clickedChecker != selectedChecker && stepsDone == 0) {
+        if ((currentPlayer == Player::WHITE && isWhite(clickedChecker)) ||
+            (currentPlayer == Player::BLACK && !isWhite(clickedChecker))) {
+
+            nextCandidates.clear();
+            for (const auto& move : legal())
+                if (move.path[0] == std::make_pair(row, col))
+                    nextCandidates.push_back(&move);
 
             // Если есть обязательные взятия, но у шашки их нет - блокируем выбор
-            if (mustCapture && !hasRealJump) {
+            if (nextCandidates.empty() && mustCapture()) {
                 std::cout << "Вы должны выбрать шашку с возможностью взятия!\n";
                 return;
             }
 
-            clearHighlights();
             selectedChecker = clickedChecker;
             selectedRow = row;
             selectedCol = col;
+            candidates.swap(nextCandidates);
 
             // Подсветка только реальных ходов
-            for (const auto& m : moves) {
-                highlights.push_back(new Object("Highlight", highlightModel, cellPosition(m.first, m.second)));
-            }
+            highlightNextSteps();
         }
         return;
     }
     // ─── Блок обработки хода ──────────────────────────────────────────────
-    if (selectedChecker) {
-        auto moves = calculateMoves(selectedRow, selectedCol);
-        bool validMove = false;
-        bool isJumpMove = false;
-        std::vector<std::pair<int, int>> capturedCheckers;
-
-        for (const auto& move : moves) {
-            if (move.first == row && move.second == col) {
-                validMove = true;
-                isJumpMove = abs(row - selectedRow) > 1 || abs(col - selectedCol) > 1;
-                break;
-            }
-        }
-
-        if (validMove) {
-            // Проверка на обязательное взятие
-            if (mustCapture && !isJumpMove) {
-                std::cout << "Вы должны совершить взятие!\n";
-                return;
-            }
-
-            // Обработка прыжка
-            if (isJumpMove) {
-                int dr = (row - selectedRow) > 0 ? 1 : -1;
-                int dc = (col - selectedCol) > 0 ? 1 : -1;
-                int steps = std::max(abs(row - selectedRow), abs(col - selectedCol));
-
-                // Удаление съеденных шашек
-                for (int i = 1; i < steps; ++i) {
-                    int curR = selectedRow + dr * i;
-                    int curC = selectedCol + dc * i;
-                    if (board[curR][curC] && board[curR][curC]->isWhite() != selectedChecker->isWhite()) {
-                        delete board[curR][curC];
-                        board[curR][curC] = nullptr;
-                        capturedCheckers.emplace_back(curR, curC);
-                        std::cout << "Шашка (" << curR << "," << curC << ") съедена\n";
-                    }
-                }
-            }
-
-            // Перемещение шашки
-            board[row][col] = selectedChecker;
-            board[selectedRow][selectedCol] = nullptr;
-            selectedChecker->newPos(cellPosition(row, col));
-
-            // Проверка превращения в дамку (только при движении вперед)
-            if (!selectedChecker->getKing()) {
-                bool isWhite = selectedChecker->isWhite();
-                if ((isWhite && row == 0) || (!isWhite && row == SIZE - 1)) {
-                    selectedChecker->setKing();
-                    std::cout << "Шашка стала дамкой!\n";
-                }
-            }
-
-            // Проверка продолжения прыжков
-            if (!capturedCheckers.empty()) {
-                auto newMoves = calculateMoves(row, col);
-                bool hasMoreCaptures = false;
-
-                // Проверяем, есть ли новые враги для взятия
-                for (const auto& move : newMoves) {
-                    if (abs(move.first - row) > 1 || abs(move.second - col) > 1) {
-                        int dr = (move.first - row) > 0 ? 1 : -1;
-                        int dc = (move.second - col) > 0 ? 1 : -1;
-                        int steps = std::max(abs(move.first - row), abs(move.second - col));
-
-                        for (int i = 1; i < steps; ++i) {
-                            int curR = row + dr * i;
-                            int curC = col + dc * i;
-                            if (board[curR][curC] && board[curR][curC]->isWhite() != selectedChecker->isWhite()) {
-                                hasMoreCaptures = true;
-                                break;
-                            }
-                        }
-                        if (hasMoreCaptures) break;
-                    }
-                }
-
-                if (hasMoreCaptures) {
-                    canJumpAgain = true;
-                    jumpRow = row;
-                    jumpCol = col;
-                    selectedRow = row;
-                    selectedCol = col;
-
-                    clearHighlights();
-                    for (const auto& m : newMoves) {
-                        if (abs(m.first - row) > 1 || abs(m.second - col) > 1) {
-                            highlights.push_back(new Object(
-                                "Highlight",
-                                highlightModel,
-                                cellPosition(m.first, m.second)
-                            ));
-                        }
-                    }
-                    std::cout << "Продолжайте прыжки!\n";
-                    return;
-                }
-            }
+    if (selectedChecker == NO_ENTITY) return;
 
-            // Завершение хода
-            clearHighlights();
-            selectedChecker = nullptr;
-            canJumpAgain = false;
+    nextCandidates.clear();
+    for (const auto* move : candidates)
+        if (move->path[stepsDone + 1] == std::make_pair(row, col))
+            nextCandidates.push_back(move);
 
-            if (capturedCheckers.empty() || !canJumpAgain) {
-                switchPlayer();
-                if (checkWinCondition())
-                    std::cout << "Победа " << ((gameState == WHITE_WIN) ? "белых" : "черных") << std::endl;
-            }
+    if (nextCandidates.empty()) {
+        if (mustCapture() && clickedChecker == NO_ENTITY) std::cout << "Вы должны совершить взятие!\n";
+        else std::cout << "Недопустимый ход!\n";
+        return;
+    }
+    candidates.swap(nextCandidates);
+    const GameRules::PathMove& move = *candidates[0];
+    const bool isJumpMove = !move.taken.empty();
+
+    // Анимация хода начинается после предыдущей анимации этой шашки (серия прыжков)
+    float moveStart = std::max(clock, animations.endTime(0, selectedChecker));
+    float moveTime = isJumpMove ? AnimationSystem::JUMP_TIME : AnimationSystem::SLIDE_TIME;
+
+    // Снятие съеденной шашки (удаляется, когда доиграет анимация исчезновения)
+    if (isJumpMove) {
+        auto [curR, curC] = move.taken[stepsDone];
+        Entity captured = board[curR][curC];
+        animations.remove(0, captured, isWhite(captured) ? ANIM_WHITE : ANIM_BLACK,
+            entities.position[captured], entities.rotation[captured].z, moveStart + moveTime * 0.5f);
+        entities.tweens[captured]++;
+        entities.set(captured, EntityStore::VISIBLE, false);
+        capturedPieces.push_back(captured);
+        dying.push_back(captured);
+        board[curR][curC] = NO_ENTITY;
+        std::cout << "Шашка (" << curR << "," << curC << ") съедена\n";
+    }
 
-            moveProcessed = true;
-        }
-        else {
-            std::cout << "Недопустимый ход!\n";
-        }
+    // Перемещение шашки
+    board[selectedRow][selectedCol] = NO_ENTITY;
+    board[row][col] = selectedChecker;
+    glm::vec3 fromPos = entities.position[selectedChecker];
+    placeChecker(selectedChecker, row, col);
+    selectedRow = row;
+    selectedCol = col;
+    stepsDone++;
+
+    uint8_t batch = isWhite(selectedChecker) ? ANIM_WHITE : ANIM_BLACK;
+    float angle = entities.rotation[selectedChecker].z;
+    const glm::vec3 toPos = entities.position[selectedChecker];
+    if (isJumpMove) animations.jump(0, selectedChecker, batch, fromPos, toPos, angle, moveStart);
+    else animations.slide(0, selectedChecker, batch, fromPos, toPos, angle, moveStart);
+    entities.tweens[selectedChecker]++;
+
+    // Проверка продолжения прыжков: правила уже знают весь путь, ждём следующий щелчок
+    if (int(move.path.size()) > stepsDone + 1) {
+        highlightNextSteps();
+        std::cout << "Продолжайте прыжки!\n";
+        return;
     }
 
-    // ─── Смена выбора шашки ─────────────────────────────────────────
-    if (!moveProcessed && clickedChecker && clickedChecker != selectedChecker) {
-        clearHighlights();
-        selectedChecker = nullptr;
-        onCellClick(row, col);
+    // Превращение в дамку (правила варианта решают, когда оно происходит)
+    const bool promoted = move.promotes && !isKing(selectedChecker);
+    if (promoted) {
+        animations.kingFlip(0, selectedChecker, batch, toPos, kingLift, moveStart + moveTime);
+        entities.tweens[selectedChecker]++;
+        entities.set(selectedChecker, EntityStore::KING, true);
+        placeChecker(selectedChecker, row, col);
+        std::cout << "Шашка стала дамкой!\n";
     }
+
+    // Завершение хода
+    recordPly(move, promoted);
+    clearHighlights();
+    selectedChecker = NO_ENTITY;
+    switchPlayer();
+    refreshMoves();
+    if (checkWinCondition())
+        std::cout << "Победа " << ((gameState == WHITE_WIN) ? "белых" : "черных") << std::endl;
+    else
+        checkDrawCondition();
 }
 
-std::vector<std::pair<int, int>> CheckersBoard::calculateMoves(int row, int col) const {
-    std::vector<std::pair<int, int>> moves;
-    Checker* chk = board[row][col];
-    if (!chk) return moves;
-
-    bool isKing = chk->getKing();
-    bool isWhite = chk->isWhite();
-    int forward = isWhite ? -1 : 1;
-
-    // Обычные шашки
-    if (!isKing) {
-        std::vector<std::pair<int, int>> jumpMoves;
-
-        // Прыжки в любом направлении
-        for (int dr : {-1, 1}) {
-            for (int dc : {-1, 1}) {
-                int jr = row + 2 * dr;
-                int jc = col + 2 * dc;
-                if (isInside(jr, jc) && !board[jr][jc]) {
-                    Checker* mid = board[row + dr][col + dc];
-                    if (mid && mid->isWhite() != isWhite) {
-                        jumpMoves.emplace_back(jr, jc);
-                    }
-                }
-            }
-        }
+void CheckersBoard::update(float now) {
+    clock = now;
+    animated[ANIM_WHITE].clear();
+    animated[ANIM_BLACK].clear();
+    animations.update(now, animated);
 
-        if (!jumpMoves.empty()) return jumpMoves;
+    for (const auto& f : animations.finished()) {
+        const Entity checker = f.key;
+        if (entities.tweens[checker] == 0 || --entities.tweens[checker] > 0) continue;
 
-        // Обычные ходы только вперед
-        for (int dc : {-1, 1}) {
-            int nr = row + forward;
-            int nc = col + dc;
-            if (isInside(nr, nc) && !board[nr][nc]) {
-                moves.emplace_back(nr, nc);
-            }
-        }
+        // Снятая шашка остаётся в запасе capturedPieces до отмены хода или новой партии
+        auto it = std::find(dying.begin(), dying.end(), checker);
+        if (it != dying.end()) dying.erase(it);
     }
-    // Дамки
-    else {
-        // Для дамок: сначала проверяем все возможные прыжки
-        std::vector<std::pair<int, int>> jumpMoves;
-
-        // Поиск прыжков с захватом вражеских шашек
-        for (int dr : {-1, 1}) {
-            for (int dc : {-1, 1}) {
-                bool hasEnemy = false;
-                int enemyR = -1, enemyC = -1;
-
-                for (int step = 1; step < SIZE; ++step) {
-                    int nr = row + dr * step;
-                    int nc = col + dc * step;
-
-                    if (!isInside(nr, nc)) break;
-
-                    if (board[nr][nc]) {
-                        if (board[nr][nc]->isWhite() != isWhite && !hasEnemy) {
-                            hasEnemy = true;
-                            enemyR = nr;
-                            enemyC = nc;
-                        }
-                        else {
-                            break; // Своя шашка или второй враг
-                        }
-                    }
-                    else if (hasEnemy) {
-                        // Добавляем прыжок, если после врага есть свободное место
-                        jumpMoves.emplace_back(nr, nc);
-                    }
-                }
-            }
-        }
+    entities.updateTransforms();
+}
 
-        // Если есть прыжки - возвращаем только их
-        if (!jumpMoves.empty()) {
-            return jumpMoves;
-        }
+void CheckersBoard::clearHighlights() {
+    for (Entity highlight : highlights) entities.destroy(highlight);
+    highlights.clear();
+}
 
-        // Если прыжков нет - возвращаем все обычные ходы
-        for (int dr : {-1, 1}) {
-            for (int dc : {-1, 1}) {
-                for (int step = 1; step < SIZE; ++step) {
-                    int nr = row + dr * step;
-                    int nc = col + dc * step;
-                    if (!isInside(nr, nc) || board[nr][nc]) break;
-                    moves.emplace_back(nr, nc);
-                }
+void CheckersBoard::snapshot(Snapshot& out) {
+    // Один проход по хранилищу: стоящие шашки и подсветка. Снятые шашки невидимы,
+    // шашки в движении до конца анимации рисует система анимаций
+    entities.updateTransforms();
+    out.pieceCount[0] = out.pieceCount[1] = 0;
+    out.highlightCount = 0;
+    for (Entity e = 0; e < entities.size(); ++e) {
+        if (!entities.has(e, EntityStore::ALIVE | EntityStore::VISIBLE) || entities.tweens[e] > 0) continue;
+        if (entities.colour[e] == EntityStore::NEUTRAL) {
+            if (out.highlightCount < Snapshot::MAX_PIECES) {
+                out.highlights[out.highlightCount] = entities.world[e];
+                out.highlightIds[out.highlightCount++] = entities.pickId[e];
             }
+            continue;
+        }
+        const int side = isWhite(e) ? 0 : 1;
+        if (out.pieceCount[side] < Snapshot::MAX_PIECES) {
+            out.pieces[side][out.pieceCount[side]] = entities.world[e];
+            out.pieceIds[side][out.pieceCount[side]++] = entities.pickId[e];
         }
     }
 
-    return moves;
-}
-
-void CheckersBoard::clearHighlights() {
-    for (auto* o : highlights) delete o;
-    highlights.clear();
+    // Шашки в движении — матрицами из системы анимаций
+    const glm::mat4 pieceScaling = glm::scale(glm::mat4(1.0f), glm::vec3(pieceScale));
+    for (int side = 0; side < 2; ++side)
+        for (const auto& m : animated[side == 0 ? ANIM_WHITE : ANIM_BLACK])
+            if (out.pieceCount[side] < Snapshot::MAX_PIECES) {
+                out.pieces[side][out.pieceCount[side]] = m * pieceScaling;
+                out.pieceIds[side][out.pieceCount[side]++] = 0;
+            }
+    out.gameState = gameState;
 }
 
-void CheckersBoard::render(Shader& shader) {
+void CheckersBoard::render(const Snapshot& snapshot, Shader& shader) const {
     // Сначала рисуем все элементы доски
-    for (int r = 0; r < SIZE; ++r)
-        for (int c = 0; c < SIZE; ++c)
-            if (board[r][c])
-                board[r][c]->model.Draw(shader);
-
-    for (auto* h : highlights)
-        h->model.Draw(shader);
+    for (int side = 0; side < 2; ++side)
+        for (int i = 0; i < snapshot.pieceCount[side]; ++i) {
+            shader.setUint("objectId", snapshot.pieceIds[side][i]);
+            (side == 0 ? whiteModel : blackModel).Draw(shader, snapshot.pieces[side][i]);
+        }
+    for (int i = 0; i < snapshot.highlightCount; ++i) {
+        shader.setUint("objectId", snapshot.highlightIds[i]);
+        highlightModel.Draw(shader, snapshot.highlights[i]);
+    }
 
     // Затем рисуем текст поверх всего
-    if (gameState != PLAYING) {
+    if (snapshot.gameState != PLAYING) {
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         glDisable(GL_DEPTH_TEST);
-        string winText;
-
-        if (gameState == WHITE_WIN) winText = "White win";
-        else winText = "Black win";
+        const char* winText = "Draw";
+        if (snapshot.gameState == WHITE_WIN) winText = "White win";
+        else if (snapshot.gameState == BLACK_WIN) winText = "Black win";
 
         font->RenderText(
             winText,
@@ -496,24 +718,3 @@ void CheckersBoard::render(Shader& shader) {
         glDisable(GL_BLEND);
     }
 }
-
-bool CheckersBoard::checkPath(int r1, int c1, int r2, int c2) const {
-    int dr = (r2 > r1) ? 1 : -1;
-    int dc = (c2 > c1) ? 1 : -1;
-    int steps = abs(r2 - r1);
-    int enemyCount = 0;
-
-    for (int i = 1; i < steps; ++i) {
-        int curR = r1 + dr * i;
-        int curC = c1 + dc * i;
-        
-        if (board[curR][curC]) {
-            if (board[curR][curC]->isWhite() == board[r1][c1]->isWhite()) 
-                return false;
-            
-            enemyCount++;
-            if (enemyCount > 1) return false;
-        }
-    }
-    return true;
-}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+//--Счётчик выделений памяти из кучи для профиля кадра. Глобальные operator new/delete заменены здесь
+//  (программа собрана из одной единицы трансляции, так что определения в заголовке встречаются один
+//  раз), в том числе выровненные: ими создаются объекты с alignas(32) — сеть и оценщик NNUE.
+//  Счёт у каждого потока свой: поиск движка и перезагрузка ресурсов в фоне не попадают в кадр
+class AllocationCounter {
+public:
+    // Выделений в вызывающем потоке с начала его работы
+    static uint64_t thisThread() { return count; }
+    static void note() { count++; }
+
+private:
+    static thread_local uint64_t count;
+};
+
+thread_local uint64_t AllocationCounter::count = 0;
+
+void* operator new(std::size_t size) {
+    AllocationCounter::note();
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+// Выровненные версии. У MSVC нет std::aligned_alloc, а память _aligned_malloc освобождается только _aligned_free
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    AllocationCounter::note();
+    const std::size_t align = std::size_t(alignment);
+#ifdef _MSC_VER
+    if (void* p = _aligned_malloc(size ? size : 1, align)) return p;
+#else
+    // aligned_alloc требует размер, кратный выравниванию
+    if (void* p = std::aligned_alloc(align, size ? (size + align - 1) / align * align : align)) return p;
+#endif
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return ::operator new(size, alignment);
+}
+
+// Версии без исключений заменены явно: иначе их выделение зависит от того, чем их подменит библиотека
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try { return ::operator new(size, alignment); }
+    catch (const std::bad_alloc&) { return nullptr; }
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try { return ::operator new(size, alignment); }
+    catch (const std::bad_alloc&) { return nullptr; }
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+#ifdef _MSC_VER
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+void operator delete[](void* p, std::align_val_t alignment) noexcept { ::operator delete(p, alignment); }
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept { ::operator delete(p, alignment); }
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept { ::operator delete(p, alignment); }
+void operator delete(void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept { ::operator delete(p, alignment); }
+void operator delete[](void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept { ::operator delete(p, alignment); }
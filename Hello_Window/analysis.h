@@ -0,0 +1,127 @@
+#pragma once
+#include "engine.h"
+#include "rules.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+//--Поиск движка в фоновом потоке: ход компьютера, обдумывание ожидаемого ответа соперника (ponder)
+//  и бесконечный анализ позиции. Кадр не ждёт поиска: отмена только поднимает флаг движка,
+//  поток доделывает текущие 256 узлов (или одно доигрывание) и выходит сам.
+//  Промежуточные итоги движок шлёт через onProgress, кадр забирает последний под мьютексом
+class BackgroundSearch {
+public:
+    enum class Mode { IDLE, MOVE, PONDER, ANALYSIS };
+
+    // Без ограничения: обдумывание и анализ идут до отмены
+    static constexpr Engine::Limits UNLIMITED{ 64, 0.0 };
+
+    explicit BackgroundSearch(Engine& engine);
+    ~BackgroundSearch();
+
+    // Новый поиск позиции; предыдущий отменяется
+    void start(Mode mode, const GameRules::Cells& cells, bool whiteToMove, const Engine::Limits& limits);
+    void cancel() { engine.stopFlag.store(true, std::memory_order_relaxed); }
+    // Попадание обдумывания: соперник сыграл ожидаемый ход, поиск продолжается уже как ход компьютера
+    void ponderHit();
+
+    // Вызывается из потока поиска при новом промежуточном итоге и по окончании (разбудить кадр)
+    std::function<void()> onWake;
+
+    Mode mode() const { return mode_; }
+    bool finished() const { return done.load(std::memory_order_acquire); }
+    bool isSearching(const GameRules::Cells& cells, bool whiteToMove) const {
+        return mode_ != Mode::IDLE && whiteToMove == white && std::memcmp(cells, position, sizeof(position)) == 0;
+    }
+    // Секунд с начала поиска или с попадания обдумывания
+    double elapsed() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count(); }
+    // Последний промежуточный итог; присваивание поверх out не выделяет память, пока линия не длиннее прежней
+    void progress(Engine::Report& out) const;
+
+    // Итог законченного поиска; поиск переходит в IDLE. false — ходов нет
+    bool finish(GameRules::PathMove& out, Engine::Report& report);
+    // Бросить поиск без результата
+    void reset();
+
+private:
+    Engine& engine;
+    std::thread thread;
+    std::atomic<bool> done{ true };
+    Mode mode_ = Mode::IDLE;
+    GameRules::Cells position = {};
+    bool white = true;
+    std::chrono::steady_clock::time_point started;
+
+    mutable std::mutex mutex;
+    Engine::Report latest;           // Под mutex
+    GameRules::PathMove move;        // Пишет поток поиска до done
+    bool hasMove = false;
+
+    void join() { if (thread.joinable()) thread.join(); }
+};
+
+BackgroundSearch::BackgroundSearch(Engine& engine_) : engine(engine_) {
+    engine.onProgress = [this](const Engine::Report& report) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            latest = report;
+        }
+        if (onWake) onWake();
+    };
+}
+
+BackgroundSearch::~BackgroundSearch() {
+    cancel();
+    join();
+    engine.onProgress = nullptr;
+}
+
+void BackgroundSearch::start(Mode mode, const GameRules::Cells& cells, bool whiteToMove, const Engine::Limits& limits) {
+    cancel();
+    join();
+    engine.stopFlag.store(false, std::memory_order_relaxed);
+    engine.limits = limits;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        latest = {};
+    }
+    std::memcpy(position, cells, sizeof(position));
+    white = whiteToMove;
+    mode_ = mode;
+    hasMove = false;
+    started = std::chrono::steady_clock::now();
+    done.store(false, std::memory_order_relaxed);
+    thread = std::thread([this] {
+        hasMove = engine.chooseMove(position, white, move);
+        done.store(true, std::memory_order_release);
+        if (onWake) onWake();
+    });
+}
+
+void BackgroundSearch::ponderHit() {
+    mode_ = Mode::MOVE;
+    started = std::chrono::steady_clock::now();
+}
+
+void BackgroundSearch::progress(Engine::Report& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    out = latest;
+}
+
+bool BackgroundSearch::finish(GameRules::PathMove& out, Engine::Report& report) {
+    join();
+    mode_ = Mode::IDLE;
+    report = engine.lastReport();
+    if (hasMove) out = move;
+    return hasMove;
+}
+
+void BackgroundSearch::reset() {
+    cancel();
+    join();
+    mode_ = Mode::IDLE;
+}
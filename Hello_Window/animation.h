@@ -0,0 +1,156 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+//--Планировщик анимаций фигур. Твины хранятся структурой массивов и обновляются одним линейным проходом;
+//  результат — готовые матрицы моделей, которые дописываются прямо в массивы экземпляров рендера
+class AnimationSystem {
+public:
+    enum Kind : uint8_t { SLIDE, JUMP, REMOVE, KING_FLIP };
+
+    // Длительности по умолчанию, секунды
+    static constexpr float SLIDE_TIME = 0.25f;
+    static constexpr float JUMP_TIME = 0.4f;
+    static constexpr float REMOVE_TIME = 0.3f;
+    static constexpr float FLIP_TIME = 0.35f;
+
+    struct Finished {
+        uint32_t owner;
+        uint32_t key;
+        Kind kind;
+    };
+
+    // owner — доска (или другой владелец), key — фигура; batch — в какой массив выводить матрицу
+    void slide(uint32_t owner, uint32_t key, uint8_t batch, glm::vec3 from, glm::vec3 to, float angle, float start) {
+        add(SLIDE, owner, key, batch, from, to, 0.0f, angle, angle, 1.0f, 1.0f, start, SLIDE_TIME, false);
+    }
+    void jump(uint32_t owner, uint32_t key, uint8_t batch, glm::vec3 from, glm::vec3 to, float angle, float start) {
+        add(JUMP, owner, key, batch, from, to, 1.5f, angle, angle, 1.0f, 1.0f, start, JUMP_TIME, false);
+    }
+    // Снятая фигура видна на месте до начала анимации, затем приподнимается и исчезает
+    void remove(uint32_t owner, uint32_t key, uint8_t batch, glm::vec3 at, float angle, float start) {
+        add(REMOVE, owner, key, batch, at, at + glm::vec3(0.0f, 0.5f, 0.0f), 0.0f, angle, angle, 1.0f, 0.0f, start, REMOVE_TIME, true);
+    }
+    // Переворот в дамку: подъём на высоту шашки с поворотом на 180° вокруг Z (как в Checker::setKing)
+    void kingFlip(uint32_t owner, uint32_t key, uint8_t batch, glm::vec3 at, float height, float start) {
+        add(KING_FLIP, owner, key, batch, at, at + glm::vec3(0.0f, height, 0.0f), 1.0f, 0.0f, 180.0f, 1.0f, 1.0f, start, FLIP_TIME, false);
+    }
+
+    void add(Kind kind, uint32_t owner, uint32_t key, uint8_t batch,
+        glm::vec3 from, glm::vec3 to, float arc, float angleFrom, float angleTo,
+        float scaleFrom, float scaleTo, float start, float duration, bool visibleBeforeStart);
+
+    // Продвигает все твины к моменту now и дописывает их матрицы в outputs[batch].
+    // Завершённые твины удаляются и попадают в finished() до следующего вызова
+    void update(float now, std::vector<glm::mat4>* outputs);
+
+    // Отмена всех твинов владельца (новое состояние доски пришло раньше конца анимации)
+    void cancelOwner(uint32_t owner);
+    void clear();
+
+    const std::vector<Finished>& finished() const { return finishedList; }
+    size_t size() const { return kinds.size(); }
+    float endTime(uint32_t owner, uint32_t key) const; // Когда закончится последний твин фигуры (или -1)
+
+private:
+    std::vector<uint8_t> kinds, batches, holds;
+    std::vector<uint32_t> owners, keys;
+    std::vector<glm::vec3> from, to;
+    std::vector<float> arcs, angleFrom, angleTo, scaleFrom, scaleTo, starts, invDurations;
+    std::vector<Finished> finishedList;
+
+    void removeAt(size_t i);
+};
+
+void AnimationSystem::add(Kind kind, uint32_t owner, uint32_t key, uint8_t batch,
+    glm::vec3 from_, glm::vec3 to_, float arc, float angleFrom_, float angleTo_,
+    float scaleFrom_, float scaleTo_, float start, float duration, bool visibleBeforeStart) {
+    kinds.push_back(kind);
+    batches.push_back(batch);
+    holds.push_back(visibleBeforeStart);
+    owners.push_back(owner);
+    keys.push_back(key);
+    from.push_back(from_);
+    to.push_back(to_);
+    arcs.push_back(arc);
+    angleFrom.push_back(glm::radians(angleFrom_));
+    angleTo.push_back(glm::radians(angleTo_));
+    scaleFrom.push_back(scaleFrom_);
+    scaleTo.push_back(scaleTo_);
+    starts.push_back(start);
+    invDurations.push_back(1.0f / duration);
+}
+
+void AnimationSystem::update(float now, std::vector<glm::mat4>* outputs) {
+    finishedList.clear();
+
+    size_t i = 0;
+    while (i < kinds.size()) {
+        float t = (now - starts[i]) * invDurations[i];
+        if (t < 0.0f && !holds[i]) { ++i; continue; } // Ещё не началась и не должна быть видна
+        t = std::fmin(std::fmax(t, 0.0f), 1.0f);
+        float e = t * t * (3.0f - 2.0f * t); // smoothstep
+
+        glm::vec3 p = from[i] + (to[i] - from[i]) * e;
+        p.y += arcs[i] * 4.0f * e * (1.0f - e);
+        float a = angleFrom[i] + (angleTo[i] - angleFrom[i]) * e;
+        float s = scaleFrom[i] + (scaleTo[i] - scaleFrom[i]) * e;
+        float c = std::cos(a) * s, sn = std::sin(a) * s;
+
+        // T(p) * Rz(a) * S(s), собранная вручную
+        glm::mat4 m(1.0f);
+        m[0] = glm::vec4(c, sn, 0.0f, 0.0f);
+        m[1] = glm::vec4(-sn, c, 0.0f, 0.0f);
+        m[2] = glm::vec4(0.0f, 0.0f, s, 0.0f);
+        m[3] = glm::vec4(p, 1.0f);
+        if (s > 0.0f) outputs[batches[i]].push_back(m);
+
+        if (t >= 1.0f) {
+            finishedList.push_back({ owners[i], keys[i], Kind(kinds[i]) });
+            removeAt(i); // На место i встаёт последний твин — индекс не двигаем
+        }
+        else ++i;
+    }
+}
+
+void AnimationSystem::removeAt(size_t i) {
+    size_t last = kinds.size() - 1;
+    if (i != last) {
+        kinds[i] = kinds[last]; batches[i] = batches[last]; holds[i] = holds[last];
+        owners[i] = owners[last]; keys[i] = keys[last];
+        from[i] = from[last]; to[i] = to[last];
+        arcs[i] = arcs[last]; angleFrom[i] = angleFrom[last]; angleTo[i] = angleTo[last];
+        scaleFrom[i] = scaleFrom[last]; scaleTo[i] = scaleTo[last];
+        starts[i] = starts[last]; invDurations[i] = invDurations[last];
+    }
+    kinds.pop_back(); batches.pop_back(); holds.pop_back();
+    owners.pop_back(); keys.pop_back();
+    from.pop_back(); to.pop_back();
+    arcs.pop_back(); angleFrom.pop_back(); angleTo.pop_back();
+    scaleFrom.pop_back(); scaleTo.pop_back();
+    starts.pop_back(); invDurations.pop_back();
+}
+
+void AnimationSystem::cancelOwner(uint32_t owner) {
+    size_t i = 0;
+    while (i < owners.size()) {
+        if (owners[i] == owner) removeAt(i);
+        else ++i;
+    }
+}
+
+void AnimationSystem::clear() {
+    while (!kinds.empty()) removeAt(kinds.size() - 1);
+    finishedList.clear();
+}
+
+float AnimationSystem::endTime(uint32_t owner, uint32_t key) const {
+    float end = -1.0f;
+    for (size_t i = 0; i < owners.size(); ++i)
+        if (owners[i] == owner && keys[i] == key)
+            end = std::fmax(end, starts[i] + 1.0f / invDurations[i]);
+    return end;
+}
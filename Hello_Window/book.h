@@ -0,0 +1,242 @@
+#pragma once
+#include "gamedb.h"
+#include "mapped_file.h"
+#include "pdn.h"
+#include "rules.h"
+#include "search.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+//--Дебютная книга: файл .cbk — заголовок и записи «хэш позиции → ход, вес», отсортированные по хэшу.
+//  Ход хранится номером в списке Rules<V>::generate, поля from/to — для проверки при выборе.
+//  Проба — двоичный поиск по отображённому в память файлу, без выделений памяти
+
+struct BookHeader {
+    char magic[4];        // "CKBK"
+    uint32_t version;
+    uint32_t variant;
+    uint32_t reserved;
+    uint64_t entries;
+};
+
+struct BookEntry {
+    uint64_t hash;
+    uint32_t weight;      // Очки хода для сделавшей его стороны (победа 2, ничья 1) плюс 1
+    uint8_t choice;
+    uint8_t from, to;
+    uint8_t reserved;
+};
+static_assert(sizeof(BookEntry) == 16, "запись книги должна быть плотной");
+
+class OpeningBook {
+public:
+    static constexpr uint32_t VERSION = 1;
+
+    bool open(const std::string& path, std::string& error);
+    bool isOpen() const { return file.isOpen(); }
+    // Вариант правил книги; у неоткрытой книги — русские шашки (проба в ней всё равно ничего не найдёт)
+    Variant variant() const {
+        return isOpen() ? Variant(reinterpret_cast<const BookHeader*>(file.data())->variant) : Variant::RUSSIAN;
+    }
+    size_t size() const { return entries.size(); }
+
+    // Ходы книги для позиции (срез файла)
+    std::span<const BookEntry> find(uint64_t hash) const noexcept;
+    // Ход, выбранный с вероятностью по весу; random — любое случайное число. false — позиции нет в книге
+    bool probe(uint64_t hash, uint32_t random, BookEntry& out) const noexcept;
+
+private:
+    MappedFile file;
+    std::span<const BookEntry> entries;
+};
+
+bool OpeningBook::open(const std::string& path, std::string& error) {
+    const BookHeader* header = nullptr;
+    entries = {};
+    if (file.open(path) && file.size() >= sizeof(BookHeader))
+        header = reinterpret_cast<const BookHeader*>(file.data());
+    // Число записей сравнивается с местом в файле делением: произведение на размер записи могло бы переполниться
+    if (!header || std::memcmp(header->magic, "CKBK", 4) != 0 || header->version != VERSION
+        || header->entries > (file.size() - sizeof(BookHeader)) / sizeof(BookEntry)) {
+        file.close();
+        error = "не дебютная книга: " + path;
+        return false;
+    }
+    entries = { reinterpret_cast<const BookEntry*>(file.data() + sizeof(BookHeader)), size_t(header->entries) };
+    return true;
+}
+
+std::span<const BookEntry> OpeningBook::find(uint64_t hash) const noexcept {
+    auto first = std::lower_bound(entries.begin(), entries.end(), hash,
+        [](const BookEntry& e, uint64_t h) { return e.hash < h; });
+    auto last = std::upper_bound(first, entries.end(), hash,
+        [](uint64_t h, const BookEntry& e) { return h < e.hash; });
+    return entries.subspan(size_t(first - entries.begin()), size_t(last - first));
+}
+
+bool OpeningBook::probe(uint64_t hash, uint32_t random, BookEntry& out) const noexcept {
+    std::span<const BookEntry> moves = find(hash);
+    uint64_t total = 0;
+    for (const BookEntry& e : moves) total += e.weight;
+    if (total == 0) return false;
+
+    uint64_t pick = random % total;
+    for (const BookEntry& e : moves) {
+        if (pick < e.weight) { out = e; return true; }
+        pick -= e.weight;
+    }
+    return false;
+}
+
+//--Сборка книги: ходы из партий копятся как образцы, при записи сводятся по позиции и ходу
+class BookBuilder {
+public:
+    void add(uint64_t hash, uint8_t choice, uint8_t from, uint8_t to, uint8_t score) {
+        samples.push_back({ hash, choice, from, to, score });
+    }
+    void merge(BookBuilder&& other) {
+        samples.insert(samples.end(), other.samples.begin(), other.samples.end());
+        other.samples = {};
+    }
+    size_t size() const { return samples.size(); }
+
+    // В книгу попадают ходы, сыгранные не меньше minGames раз. Возвращает число записей или -1
+    long long write(const std::string& path, Variant variant, uint32_t minGames, std::string& error);
+
+private:
+    struct Sample {
+        uint64_t hash;
+        uint8_t choice, from, to, score;
+    };
+    std::vector<Sample> samples;
+};
+
+long long BookBuilder::write(const std::string& path, Variant variant, uint32_t minGames, std::string& error) {
+    std::sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.choice < b.choice;
+        });
+
+    std::vector<BookEntry> entries;
+    for (size_t i = 0; i < samples.size(); ) {
+        size_t j = i;
+        uint32_t score = 0;
+        while (j < samples.size() && samples[j].hash == samples[i].hash && samples[j].choice == samples[i].choice)
+            score += samples[j++].score;
+        if (j - i >= minGames)
+            entries.push_back({ samples[i].hash, score + 1, samples[i].choice, samples[i].from, samples[i].to, 0 });
+        i = j;
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    BookHeader header{ { 'C', 'K', 'B', 'K' }, OpeningBook::VERSION, uint32_t(variant), 0, entries.size() };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), std::streamsize(entries.size() * sizeof(BookEntry)));
+    if (!out) {
+        error = "ошибка записи " + path;
+        return -1;
+    }
+    return (long long)entries.size();
+}
+
+//--Первые maxPly ходов партии в книгу. Очки хода — с точки зрения сходившей стороны
+template<class V>
+void addBookGame(BookBuilder& builder, typename Rules<V>::Position pos, std::span<const typename Rules<V>::Move> line,
+    std::span<const uint8_t> choices, GameResult result, int maxPly) {
+    using Core = Rules<V>;
+    const size_t plies = std::min(line.size(), size_t(maxPly));
+    for (size_t i = 0; i < plies; ++i) {
+        uint8_t score = 1; // Ничья или неизвестный исход
+        if (result == GameResult::WHITE_WIN) score = pos.side == 0 ? 2 : 0;
+        if (result == GameResult::BLACK_WIN) score = pos.side == 1 ? 2 : 0;
+        builder.add(Core::hash(pos), choices[i], uint8_t(line[i].from()), uint8_t(line[i].to()), score);
+        Core::apply(pos, line[i]);
+    }
+}
+
+//--Книга из архива PDN: куски архива разбираются параллельно, у каждого потока свой сборщик
+template<class V>
+size_t addBookFromPdn(BookBuilder& builder, std::string_view pdn, int maxPly) {
+    const std::vector<size_t> bounds = splitPdnArchive(pdn, pdnWorkers(pdn));
+    std::vector<BookBuilder> parts(bounds.size() - 1);
+    std::vector<size_t> games(parts.size());
+
+    auto work = [&](size_t index) {
+        PdnReader reader(pdn.substr(bounds[index], bounds[index + 1] - bounds[index]));
+        PdnReplay<V> replay;
+        PdnGame game;
+        while (reader.next(game)) {
+            Variant variant = V::ID;
+            variantFromGameType(game.tag("GameType"), variant);
+            if (variant != V::ID || game.moves.empty() || !replay.load(game)) continue;
+            addBookGame<V>(parts[index], replay.start(), replay.line(), replay.choices(), parseGameResult(game.result), maxPly);
+            games[index]++;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < parts.size(); ++i) pool.emplace_back(work, i);
+    work(0);
+    for (auto& t : pool) t.join();
+
+    size_t total = 0;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        builder.merge(std::move(parts[i]));
+        total += games[i];
+    }
+    return total;
+}
+
+//--Книга из партий движка с самим собой. Первые randomPlies ходов случайны, дальше играет перебор
+//  глубины depth; партия длиннее maxGamePlies считается ничьей. Партии играются на всех ядрах
+template<class V>
+void addBookFromSelfPlay(BookBuilder& builder, int games, int maxPly, int depth, uint32_t seed,
+    int randomPlies = 4, int maxGamePlies = 200) {
+    using Core = Rules<V>;
+    const int threads = std::max(1, std::min(games, int(std::thread::hardware_concurrency())));
+    std::vector<BookBuilder> parts(threads);
+
+    auto work = [&](int index) {
+        std::mt19937 rng(seed + index);
+        AlphaBeta<V> search;
+        std::vector<typename Core::Move> legal, line;
+        std::vector<uint8_t> choices;
+        for (int g = index; g < games; g += threads) {
+            const typename Core::Position start = Core::initial();
+            typename Core::Position pos = start;
+            line.clear();
+            choices.clear();
+            GameResult result = GameResult::DRAW;
+            for (int ply = 0; ply < maxGamePlies; ++ply) {
+                Core::generate(pos, legal);
+                if (legal.empty()) {
+                    result = pos.side == 0 ? GameResult::BLACK_WIN : GameResult::WHITE_WIN;
+                    break;
+                }
+                size_t pick = rng() % legal.size();
+                if (ply >= randomPlies) {
+                    const auto found = search.search(pos, depth, 0.0);
+                    for (size_t i = 0; i < legal.size(); ++i)
+                        if (legal[i].squares[0] == found.best.squares[0] && legal[i].captured == found.best.captured
+                            && legal[i].to() == found.best.to()) pick = i;
+                }
+                line.push_back(legal[pick]);
+                choices.push_back(uint8_t(pick));
+                Core::apply(pos, legal[pick]);
+            }
+            addBookGame<V>(parts[index], start, line, choices, result, maxPly);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; ++i) pool.emplace_back(work, i);
+    work(0);
+    for (auto& t : pool) t.join();
+    for (auto& part : parts) builder.merge(std::move(part));
+}
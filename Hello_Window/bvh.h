@@ -0,0 +1,255 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+//--Структура луча
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+    glm::vec3 end;
+};
+
+//--Выровненная по осям коробка
+struct AABB {
+    glm::vec3 min{ FLT_MAX };
+    glm::vec3 max{ -FLT_MAX };
+
+    void expand(const glm::vec3& p) { min = glm::min(min, p); max = glm::max(max, p); }
+    void expand(const AABB& b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    float area() const {
+        glm::vec3 e = max - min;
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    // Пересечение луча с коробкой (метод плит). invDir = 1 / direction
+    bool intersect(const glm::vec3& origin, const glm::vec3& invDir, float tMax, float& tEnter) const {
+        glm::vec3 t0 = (min - origin) * invDir;
+        glm::vec3 t1 = (max - origin) * invDir;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        tEnter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+        return tEnter <= tExit;
+    }
+};
+
+//--Иерархия ограничивающих объёмов над произвольными примитивами (объекты сцены, треугольники меша)
+class BVH {
+public:
+    struct Node {
+        AABB box;
+        int32_t first;  // Лист: первый примитив в indices; узел: индекс левого ребёнка (правый = first + 1)
+        int32_t count;  // > 0 — лист
+    };
+
+    // Построение по коробкам примитивов (биннинг SAH)
+    void build(const std::vector<AABB>& bounds);
+    // Перестройка коробок снизу вверх без изменения топологии (примитивы сдвинулись)
+    void refit(const std::vector<AABB>& bounds);
+    bool empty() const { return nodes.empty(); }
+    size_t primitiveCount() const { return indices.size(); }
+
+    // Ближайшее пересечение. hit(index, ray, tMax, t) проверяет примитив и возвращает true, если t < tMax
+    template<class HitFn>
+    bool raycast(const Ray& ray, float& tHit, int& hitIndex, HitFn&& hit) const;
+
+private:
+    static constexpr int LEAF_SIZE = 4;
+    static constexpr int BINS = 12;
+    static constexpr int MAX_DEPTH = 48; // Стек обхода в raycast рассчитан на эту глубину
+
+    std::vector<Node> nodes;
+    std::vector<int32_t> indices;
+    std::vector<glm::vec3> centers; // Только на время построения
+
+    void subdivide(int nodeIndex, const std::vector<AABB>& bounds, int depth);
+};
+
+void BVH::build(const std::vector<AABB>& bounds) {
+    nodes.clear();
+    indices.resize(bounds.size());
+    if (bounds.empty()) return;
+
+    centers.resize(bounds.size());
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        indices[i] = int32_t(i);
+        centers[i] = bounds[i].center();
+    }
+
+    nodes.reserve(bounds.size() * 2);
+    nodes.push_back({ AABB{}, 0, int32_t(bounds.size()) });
+    subdivide(0, bounds, 0);
+    centers.clear();
+    centers.shrink_to_fit();
+}
+
+void BVH::subdivide(int nodeIndex, const std::vector<AABB>& bounds, int depth) {
+    int first = nodes[nodeIndex].first, count = nodes[nodeIndex].count;
+
+    AABB box, centroidBox;
+    for (int i = first; i < first + count; ++i) {
+        box.expand(bounds[indices[i]]);
+        centroidBox.expand(centers[indices[i]]);
+    }
+    nodes[nodeIndex].box = box;
+    if (count <= LEAF_SIZE || depth >= MAX_DEPTH) return;
+
+    // Выбор оси и плоскости разбиения по эвристике площади поверхности
+    int bestAxis = -1, bestSplit = 0;
+    float bestCost = box.area() * count;
+    for (int axis = 0; axis < 3; ++axis) {
+        float lo = centroidBox.min[axis], hi = centroidBox.max[axis];
+        if (hi - lo < 1e-6f) continue;
+
+        AABB binBox[BINS];
+        int binCount[BINS] = {};
+        float scale = BINS / (hi - lo);
+        for (int i = first; i < first + count; ++i) {
+            int b = std::min(BINS - 1, int((centers[indices[i]][axis] - lo) * scale));
+            binBox[b].expand(bounds[indices[i]]);
+            binCount[b]++;
+        }
+
+        // Проходы слева и справа дают стоимость каждой из BINS - 1 плоскостей
+        float leftArea[BINS - 1], rightArea[BINS - 1];
+        int leftCount[BINS - 1], rightCount[BINS - 1];
+        AABB l, r;
+        int lc = 0, rc = 0;
+        for (int b = 0; b < BINS - 1; ++b) {
+            l.expand(binBox[b]); lc += binCount[b];
+            leftArea[b] = lc ? l.area() : 0.0f; leftCount[b] = lc;
+            r.expand(binBox[BINS - 1 - b]); rc += binCount[BINS - 1 - b];
+            rightArea[BINS - 2 - b] = rc ? r.area() : 0.0f; rightCount[BINS - 2 - b] = rc;
+        }
+        for (int b = 0; b < BINS - 1; ++b) {
+            float cost = leftArea[b] * leftCount[b] + rightArea[b] * rightCount[b];
+            if (leftCount[b] && rightCount[b] && cost < bestCost) {
+                bestCost = cost; bestAxis = axis; bestSplit = b;
+            }
+        }
+    }
+    if (bestAxis < 0) return; // Разбиение не выгодно — остаёмся листом
+
+    float lo = centroidBox.min[bestAxis];
+    float scale = BINS / (centroidBox.max[bestAxis] - lo);
+    auto mid = std::partition(indices.begin() + first, indices.begin() + first + count, [&](int32_t idx) {
+        return std::min(BINS - 1, int((centers[idx][bestAxis] - lo) * scale)) <= bestSplit;
+        });
+    int leftCount = int(mid - (indices.begin() + first));
+
+    int left = int(nodes.size());
+    nodes.push_back({ AABB{}, first, leftCount });
+    nodes.push_back({ AABB{}, first + leftCount, count - leftCount });
+    nodes[nodeIndex].first = left;
+    nodes[nodeIndex].count = 0;
+
+    subdivide(left, bounds, depth + 1);
+    subdivide(left + 1, bounds, depth + 1);
+}
+
+void BVH::refit(const std::vector<AABB>& bounds) {
+    // Дети всегда лежат после родителя, поэтому обратный проход идёт снизу вверх
+    for (int i = int(nodes.size()) - 1; i >= 0; --i) {
+        Node& n = nodes[i];
+        AABB box;
+        if (n.count > 0) {
+            for (int k = n.first; k < n.first + n.count; ++k)
+                box.expand(bounds[indices[k]]);
+        }
+        else {
+            box.expand(nodes[n.first].box);
+            box.expand(nodes[n.first + 1].box);
+        }
+        n.box = box;
+    }
+}
+
+template<class HitFn>
+bool BVH::raycast(const Ray& ray, float& tHit, int& hitIndex, HitFn&& hit) const {
+    if (nodes.empty()) return false;
+
+    glm::vec3 invDir(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+    float tEnter;
+    if (!nodes[0].box.intersect(ray.origin, invDir, tHit, tEnter)) return false;
+
+    bool found = false;
+    int stack[64];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const Node& n = nodes[stack[--sp]];
+        if (n.count > 0) {
+            for (int k = n.first; k < n.first + n.count; ++k) {
+                float t;
+                if (hit(indices[k], ray, tHit, t) && t < tHit) {
+                    tHit = t; hitIndex = indices[k]; found = true;
+                }
+            }
+            continue;
+        }
+
+        // Сначала обходим ближнего ребёнка, дальнего — только если он ближе найденного
+        float tl, tr;
+        bool hl = nodes[n.first].box.intersect(ray.origin, invDir, tHit, tl);
+        bool hr = nodes[n.first + 1].box.intersect(ray.origin, invDir, tHit, tr);
+        if (hl && hr) {
+            if (tl <= tr) { stack[sp++] = n.first + 1; stack[sp++] = n.first; }
+            else          { stack[sp++] = n.first;     stack[sp++] = n.first + 1; }
+        }
+        else if (hl) stack[sp++] = n.first;
+        else if (hr) stack[sp++] = n.first + 1;
+    }
+    return found;
+}
+
+//--Треугольники меша в пространстве модели + BVH над ними для точного выбора
+struct MeshBVH {
+    std::vector<glm::vec3> triangles; // По три вершины подряд
+    BVH bvh;
+
+    template<class MeshList>
+    void build(const MeshList& meshes) {
+        triangles.clear();
+        for (const auto& mesh : meshes)
+            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+                for (int k = 0; k < 3; ++k)
+                    triangles.push_back(mesh.vertices[mesh.indices[i + k]].Position);
+
+        std::vector<AABB> bounds(triangles.size() / 3);
+        for (size_t t = 0; t < bounds.size(); ++t)
+            for (int k = 0; k < 3; ++k)
+                bounds[t].expand(triangles[t * 3 + k]);
+        bvh.build(bounds);
+    }
+
+    // Луч в пространстве модели; t измеряется в тех же единицах, что и направление луча
+    bool raycast(const Ray& ray, float& t) const {
+        int index = -1;
+        return bvh.raycast(ray, t, index, [this](int tri, const Ray& r, float tMax, float& tOut) {
+            return intersectTriangle(r, triangles[tri * 3], triangles[tri * 3 + 1], triangles[tri * 3 + 2], tMax, tOut);
+            });
+    }
+
+    // Алгоритм Мёллера — Трумбора
+    static bool intersectTriangle(const Ray& ray, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float tMax, float& t) {
+        glm::vec3 e1 = b - a, e2 = c - a;
+        glm::vec3 p = glm::cross(ray.direction, e2);
+        float det = glm::dot(e1, p);
+        if (std::fabs(det) < 1e-9f) return false;
+        float invDet = 1.0f / det;
+        glm::vec3 s = ray.origin - a;
+        float u = glm::dot(s, p) * invDet;
+        if (u < 0.0f || u > 1.0f) return false;
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(ray.direction, q) * invDet;
+        if (v < 0.0f || u + v > 1.0f) return false;
+        t = glm::dot(e2, q) * invDet;
+        return t > 0.0f && t < tMax;
+    }
+};
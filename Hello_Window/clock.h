@@ -0,0 +1,118 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+//--Шахматные часы: у каждой стороны свой запас, после хода к нему прибавляется добавка (Фишер).
+//  Идёт только время стороны, чей ход; остановленные часы не идут ни у кого
+class GameClock {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void start(double baseSeconds, double incrementSeconds, int sideToMove);
+    // Ход сделан: время пошло у соперника. Просрочившему добавка не полагается
+    void press();
+    // Ход сменился не ходом (отмена, повтор): время пошло у стороны s, добавки нет
+    void setSideToMove(int s);
+    void stop();
+    bool isRunning() const { return running; }
+
+    int sideToMove() const { return side; }
+    double increment() const { return inc; }
+    // Остаток стороны (0 — белые, 1 — чёрные) на этот момент; меньше нуля — время вышло
+    double remaining(int s) const;
+    bool flagged(int s) const { return remaining(s) < 0.0; }
+
+    // "м:сс.д", меньше 10 секунд — с десятыми
+    static std::string format(double seconds);
+
+private:
+    double left[2] = { 0.0, 0.0 };
+    double inc = 0.0;
+    int side = 0;
+    bool running = false;
+    Clock::time_point since;   // Начало хода стороны side
+
+    double elapsed() const { return running ? std::chrono::duration<double>(Clock::now() - since).count() : 0.0; }
+};
+
+void GameClock::start(double baseSeconds, double incrementSeconds, int sideToMove) {
+    left[0] = left[1] = baseSeconds;
+    inc = incrementSeconds;
+    side = sideToMove;
+    running = true;
+    since = Clock::now();
+}
+
+void GameClock::press() {
+    if (!running) return;
+    left[side] -= elapsed();
+    if (left[side] >= 0.0) left[side] += inc;
+    side ^= 1;
+    since = Clock::now();
+}
+
+void GameClock::setSideToMove(int s) {
+    if (!running || s == side) return;
+    left[side] -= elapsed();
+    side = s;
+    since = Clock::now();
+}
+
+void GameClock::stop() {
+    left[side] -= elapsed();
+    running = false;
+}
+
+double GameClock::remaining(int s) const {
+    return s == side ? left[s] - elapsed() : left[s];
+}
+
+std::string GameClock::format(double seconds) {
+    char text[32];
+    const double t = std::max(seconds, 0.0);
+    const int minutes = int(t) / 60;
+    if (t < 10.0) std::snprintf(text, sizeof(text), "%d:%04.1f", minutes, t - minutes * 60);
+    else std::snprintf(text, sizeof(text), "%d:%02d", minutes, int(t) % 60);
+    return text;
+}
+
+//--Распределение времени на ход. Мягкий предел — сколько в среднем можно тратить на ход при
+//  оставшемся запасе; после него перебор не начинает новую итерацию (дольше — если лучший ход
+//  только что сменился, короче — если он стоит несколько итераций подряд). Жёсткий предел прерывает
+//  итерацию посреди перебора и никогда не съедает больше доли запаса
+class TimeManager {
+public:
+    struct Budget {
+        double soft = 0.0;
+        double hard = 0.0;
+    };
+
+    double overhead = 0.05;        // Запас на задержки кадра и потока на каждый ход, секунд
+    double hardFraction = 0.25;    // Жёсткий предел — не больше этой доли остатка
+    int expectedPlies = 100;       // Обычная длина партии в полуходах
+
+    // remaining — остаток своей стороны, increment — добавка за ход, ply — номер полухода партии
+    Budget allocate(double remaining, double increment, int ply) const;
+
+    // Множитель мягкого предела по устойчивости: сколько итераций подряд лучший ход не менялся
+    static double stability(int stableIterations) {
+        if (stableIterations == 0) return 1.6;
+        if (stableIterations >= 4) return 0.5;
+        return 1.0 - 0.1 * stableIterations;
+    }
+};
+
+TimeManager::Budget TimeManager::allocate(double remaining, double increment, int ply) const {
+    // Своих ходов до конца партии — не меньше 15: длинная партия не должна оставить без времени
+    const int movesLeft = std::max(15, (expectedPlies - ply) / 2);
+    const double usable = std::max(0.0, remaining - overhead);
+    Budget b;
+    b.soft = usable / movesLeft + increment * 0.8;
+    b.hard = std::min({ b.soft * 4.0, usable * hardFraction + increment * 0.8, usable * 0.8 });
+    b.soft = std::min(b.soft, b.hard);
+    b.hard = std::max(b.hard, 0.005);
+    b.soft = std::max(b.soft, 0.005);
+    return b;
+}
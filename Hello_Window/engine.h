@@ -0,0 +1,200 @@
+#pragma once
+#include "book.h"
+#include "mcts.h"
+#include "nnue.h"
+#include "rules.h"
+#include "search.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+
+//--Компьютерный игрок: выбирает ход для позиции сцены. Реализации специализированы под вариант,
+//  сцена видит только этот интерфейс
+class Engine {
+public:
+    struct Limits {
+        int depth = 12;
+        double seconds = 1.0;     // На ход; <= 0 — только по глубине
+        double softSeconds = 0.0; // Мягкий предел (см. TimeManager); 0 — весь поиск до seconds или depth
+    };
+    struct Report {
+        int score = 0;
+        int depth = 0;
+        uint64_t nodes = 0;
+        bool fromBook = false;
+        std::vector<GameRules::PathMove> line; // Ожидаемое продолжение, начиная с выбранного хода
+        std::string lineText;                  // Оно же в нотации PDN
+    };
+
+    Limits limits;
+    const OpeningBook* book = nullptr; // Не владеет; книга другого варианта не используется
+    // Поднятый флаг прерывает chooseMove из другого потока: движок вернёт лучший ход, найденный к этому моменту.
+    // Сбрасывает вызывающий перед следующим поиском
+    std::atomic<bool> stopFlag{ false };
+    std::function<void(const Report&)> onProgress; // Промежуточные итоги поиска, в потоке поиска
+
+    virtual ~Engine() = default;
+    virtual const char* name() const = 0;
+    // false — ходов нет
+    virtual bool chooseMove(const GameRules::Cells& cells, bool whiteToMove, GameRules::PathMove& out) = 0;
+    const Report& lastReport() const { return report; }
+    // Счётчики последнего поиска; nullptr — движок их не ведёт. Читать, когда chooseMove вернулся
+    virtual const SearchStats* searchStats() const { return nullptr; }
+
+protected:
+    Report report;
+};
+
+// Ход из книги для позиции pos; legal — рабочий список ходов. false — позиции нет в книге
+template<class V>
+bool probeBook(const OpeningBook* book, const typename Rules<V>::Position& pos, uint32_t random,
+    std::vector<typename Rules<V>::Move>& legal, typename Rules<V>::Move& out) {
+    using Core = Rules<V>;
+    BookEntry entry;
+    if (!book || book->variant() != V::ID || !book->probe(Core::hash(pos), random, entry)) return false;
+
+    Core::generate(pos, legal);
+    if (entry.choice >= legal.size()) return false;
+    const auto& m = legal[entry.choice];
+    if (m.from() != entry.from || m.to() != entry.to) return false; // Книга от другого генератора ходов
+    out = m;
+    return true;
+}
+
+// Главная линия в отчёт: ходы для сцены и текст
+template<class V>
+void describeLine(const std::vector<typename Rules<V>::Move>& line, Engine::Report& report) {
+    report.line.clear();
+    report.lineText.clear();
+    for (const auto& m : line) {
+        report.line.push_back(VariantRules<V>::toPath(m));
+        if (!report.lineText.empty()) report.lineText += ' ';
+        PdnReplay<V>::appendMove(report.lineText, m);
+    }
+}
+
+template<class V, class E = Evaluator<V>>
+class AlphaBetaEngine : public Engine {
+public:
+    using Core = Rules<V>;
+
+    explicit AlphaBetaEngine(const E& eval = E()) : search(eval) {
+        search.abort = &stopFlag;
+        search.onIteration = [this](const typename AlphaBeta<V, E>::Result& result) {
+            if (!onProgress) return;
+            Report progress;
+            progress.score = result.score;
+            progress.depth = result.depth;
+            progress.nodes = result.nodes;
+            describeLine<V>(result.line, progress);
+            onProgress(progress);
+        };
+    }
+    const char* name() const override { return std::is_same_v<E, Evaluator<V>> ? "alphabeta" : "nnue"; }
+    bool chooseMove(const GameRules::Cells& cells, bool whiteToMove, GameRules::PathMove& out) override;
+    const SearchStats* searchStats() const override { return &search.stats(); }
+
+private:
+    AlphaBeta<V, E> search;
+    std::vector<typename Core::Move> legal;
+    std::mt19937 rng{ std::random_device{}() };
+};
+
+template<class V, class E>
+bool AlphaBetaEngine<V, E>::chooseMove(const GameRules::Cells& cells, bool whiteToMove, GameRules::PathMove& out) {
+    const typename Core::Position pos = Core::fromCells(cells, whiteToMove ? 0 : 1);
+    report = {};
+    // Книга спрашивается в начале каждого хода: попадание стоит одного двоичного поиска
+    if (typename Core::Move bookMove; probeBook<V>(book, pos, uint32_t(rng()), legal, bookMove)) {
+        report.fromBook = true;
+        describeLine<V>({ bookMove }, report);
+        out = report.line[0];
+        return true;
+    }
+
+    const auto result = search.search(pos, limits.depth, limits.seconds, limits.softSeconds);
+    report.score = result.score;
+    report.depth = result.depth;
+    report.nodes = result.nodes;
+    describeLine<V>(result.line, report);
+    if (!result.found) return false;
+    out = VariantRules<V>::toPath(result.best);
+    return true;
+}
+
+//--Поиск Монте-Карло за тем же интерфейсом. Без времени на ход (limits.seconds <= 0) и без предела
+//  доигрываний в настройках их число — 10000 на единицу limits.depth
+template<class V>
+class MctsEngine : public Engine {
+public:
+    using Core = Rules<V>;
+
+    explicit MctsEngine(const MctsConfig& config = {}) : search(config) {
+        search.abort = &stopFlag;
+        search.onProgress = [this](const typename Mcts<V>::Result& result) {
+            if (!onProgress) return;
+            Report progress;
+            progress.score = score(result);
+            progress.depth = result.depth;
+            progress.nodes = result.playouts;
+            describeLine<V>(result.line, progress);
+            onProgress(progress);
+        };
+    }
+    const char* name() const override { return "mcts"; }
+    bool chooseMove(const GameRules::Cells& cells, bool whiteToMove, GameRules::PathMove& out) override;
+
+private:
+    Mcts<V> search;
+    std::vector<typename Core::Move> legal;
+    std::mt19937 rng{ std::random_device{}() };
+
+    // Доля очков в условных сотых: ±1000 — верный исход
+    static int score(const typename Mcts<V>::Result& result) { return int((result.winRate - 0.5) * 2000.0); }
+};
+
+template<class V>
+bool MctsEngine<V>::chooseMove(const GameRules::Cells& cells, bool whiteToMove, GameRules::PathMove& out) {
+    const typename Core::Position pos = Core::fromCells(cells, whiteToMove ? 0 : 1);
+    report = {};
+    if (typename Core::Move bookMove; probeBook<V>(book, pos, uint32_t(rng()), legal, bookMove)) {
+        report.fromBook = true;
+        describeLine<V>({ bookMove }, report);
+        out = report.line[0];
+        return true;
+    }
+
+    // Итераций у поиска Монте-Карло нет: по часам он тратит ровно мягкий предел
+    const double seconds = limits.softSeconds > 0.0 ? limits.softSeconds : limits.seconds;
+    uint64_t playouts = search.config().playouts;
+    if (!playouts && seconds <= 0.0) playouts = 10000ull * limits.depth;
+    const auto result = search.search(pos, seconds, playouts);
+    report.score = score(result);
+    report.depth = result.depth;
+    report.nodes = result.playouts;
+    describeLine<V>(result.line, report);
+    if (!result.found) return false;
+    out = VariantRules<V>::toPath(result.best);
+    return true;
+}
+
+//--Всё, что нужно отдельным видам движков
+struct EngineSetup {
+    const NnueNetwork* network = nullptr; // Для "nnue"
+    MctsConfig mcts;                      // Для "mcts"
+};
+
+// kind: "alphabeta", "nnue" (перебор с оценкой сетью setup.network) или "mcts"; nullptr — неизвестный движок
+std::unique_ptr<Engine> makeEngine(Variant variant, const std::string& kind, const EngineSetup& setup = {}) {
+    if (kind != "alphabeta" && kind != "mcts" && (kind != "nnue" || !setup.network)) return nullptr;
+    return dispatchVariant(variant, [&](auto traits) -> std::unique_ptr<Engine> {
+        using V = decltype(traits);
+        if (kind == "nnue") return std::make_unique<AlphaBetaEngine<V, NnueEvaluator<V>>>(NnueEvaluator<V>(setup.network));
+        if (kind == "mcts") return std::make_unique<MctsEngine<V>>(setup.mcts);
+        return std::make_unique<AlphaBetaEngine<V>>();
+        });
+}
@@ -0,0 +1,215 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "model.h"
+#include "bvh.h"
+
+//--Сущность сцены — индекс в массивах компонентов EntityStore
+using Entity = uint32_t;
+constexpr Entity NO_ENTITY = UINT32_MAX;
+
+//--Хранилище сущностей сцены. Каждый компонент (перенос, поворот, масштаб, меш, цвет, флаги, матрица)
+//  лежит своим массивом, и системы — рендер, выбор, анимации — проходят подряд только нужные им
+//  массивы. Места резервируются заранее, удалённые индексы идут в повторное использование, так что
+//  создание и удаление сущностей кучу не трогают. Хранилище принадлежит одному потоку
+class EntityStore {
+public:
+    using MeshHandle = uint16_t;
+    enum Colour : uint8_t { NEUTRAL, WHITE, BLACK };   // Сторона шашки; у остального — NEUTRAL
+    enum Flag : uint8_t {
+        ALIVE = 1,
+        VISIBLE = 2,
+        PICKABLE = 4,   // Выбирается мышью в режиме редактирования
+        KING = 8,       // Шашка-дамка
+        DIRTY = 16,     // Матрица устарела, её пересчитает updateTransforms
+    };
+
+    // Модель-прототип: меши и текстуры (общие для всех копий) и хит-бокс в единицах модели
+    MeshHandle addMesh(const Model& model);
+    const Model& mesh(MeshHandle handle) const { return prototypes[handle].model; }
+
+    void reserve(size_t count);
+    Entity create(MeshHandle mesh, const glm::vec3& position, const glm::vec3& rotation = glm::vec3(0.0f),
+        float scale = 1.0f, Colour colour = NEUTRAL, uint8_t flags = VISIBLE);
+    void destroy(Entity e);
+    size_t size() const { return flags.size(); }                   // Мест, включая свободные
+    size_t alive() const { return flags.size() - freeList.size(); }
+    bool has(Entity e, uint8_t flag) const { return (flags[e] & flag) == flag; }
+    void set(Entity e, uint8_t flag, bool on) { flags[e] = on ? uint8_t(flags[e] | flag) : uint8_t(flags[e] & ~flag); }
+
+    // Преобразование меняется только здесь: матрица помечается и пересчитывается updateTransforms
+    void place(Entity e, const glm::vec3& newPosition, const glm::vec3& newRotation);
+    void move(Entity e, const glm::vec3& delta) { place(e, position[e] + delta, rotation[e]); }
+    void rotate(Entity e, const glm::vec3& angles) { place(e, position[e], rotation[e] + angles); }
+    void rescale(Entity e, float factor) { scale[e] *= factor; flags[e] |= DIRTY; }
+
+    // Системы: проходят массивы компонентов по порядку
+    void updateTransforms();
+    void render(Shader& shader) const;              // Видимые сущности (матрицы должны быть свежими)
+    HitBox hitBox(Entity e) const;                  // Цилиндр прототипа с переносом и масштабом сущности (без поворота)
+    bool rotated(Entity e) const { return rotation[e] != glm::vec3(0.0f); } // Вертикальный hitBox к ней не подходит
+    AABB bounds(Entity e) const;                    // Мировая коробка меша с полным преобразованием (для BVH сцены)
+    // Коробки выбираемых сущностей: ids[i] — владелец bounds[i]
+    void pickBounds(std::vector<AABB>& bounds, std::vector<Entity>& ids) const;
+    // Уточнение выбора по треугольникам меша: луч переводится в пространство модели без нормализации,
+    // поэтому параметр t совпадает с мировым
+    bool raycastMesh(Entity e, const Ray& ray, float& t);
+
+    // Компоненты (индекс — сущность)
+    std::vector<glm::vec3> position;
+    std::vector<glm::vec3> rotation;    // Градусы, порядок X, Y, Z как в Model::getModelMatrix
+    std::vector<float> scale;
+    std::vector<MeshHandle> meshes;
+    std::vector<uint8_t> colour;
+    std::vector<uint8_t> flags;
+    std::vector<uint8_t> tweens;        // Идущих анимаций; пока > 0, сущность рисует система анимаций
+    std::vector<uint32_t> pickId;       // Номер в буфере выбора (IdPicker); 0 — не выбирается
+    std::vector<glm::mat4> world;       // Матрица модели
+
+private:
+    struct Prototype {
+        Model model;
+        std::unique_ptr<MeshBVH> bvh;   // Строится при первом точном выборе, перестраивается после перезагрузки мешей
+        uint32_t bvhVersion = 0;
+    };
+    std::vector<Prototype> prototypes;
+    std::vector<Entity> freeList;
+
+    glm::mat4 transform(Entity e) const; // Матрица из переноса, поворота и масштаба (world[e] может устареть)
+};
+
+EntityStore::MeshHandle EntityStore::addMesh(const Model& model) {
+    prototypes.push_back({ model, nullptr, 0 });
+    return MeshHandle(prototypes.size() - 1);
+}
+
+void EntityStore::reserve(size_t count) {
+    position.reserve(count);
+    rotation.reserve(count);
+    scale.reserve(count);
+    meshes.reserve(count);
+    colour.reserve(count);
+    flags.reserve(count);
+    tweens.reserve(count);
+    pickId.reserve(count);
+    world.reserve(count);
+    freeList.reserve(count);
+}
+
+Entity EntityStore::create(MeshHandle mesh, const glm::vec3& newPosition, const glm::vec3& newRotation,
+    float newScale, Colour newColour, uint8_t newFlags) {
+    Entity e;
+    if (!freeList.empty()) {
+        e = freeList.back();
+        freeList.pop_back();
+    }
+    else {
+        e = Entity(flags.size());
+        position.emplace_back();
+        rotation.emplace_back();
+        scale.emplace_back();
+        meshes.emplace_back();
+        colour.emplace_back();
+        flags.emplace_back();
+        tweens.emplace_back();
+        pickId.emplace_back();
+        world.emplace_back();
+    }
+    position[e] = newPosition;
+    rotation[e] = newRotation;
+    scale[e] = newScale;
+    meshes[e] = mesh;
+    colour[e] = newColour;
+    flags[e] = uint8_t(newFlags | ALIVE | DIRTY);
+    tweens[e] = 0;
+    pickId[e] = 0;
+    return e;
+}
+
+void EntityStore::destroy(Entity e) {
+    if (!(flags[e] & ALIVE)) return;
+    flags[e] = 0;
+    freeList.push_back(e);
+}
+
+void EntityStore::place(Entity e, const glm::vec3& newPosition, const glm::vec3& newRotation) {
+    position[e] = newPosition;
+    rotation[e] = newRotation;
+    flags[e] |= DIRTY;
+}
+
+void EntityStore::updateTransforms() {
+    for (size_t e = 0; e < flags.size(); ++e) {
+        if (!(flags[e] & DIRTY)) continue;
+        world[e] = transform(Entity(e));
+        flags[e] &= ~DIRTY;
+    }
+}
+
+glm::mat4 EntityStore::transform(Entity e) const {
+    glm::mat4 m = glm::translate(glm::mat4(1.0f), position[e]);
+    m = glm::rotate(m, glm::radians(rotation[e].x), glm::vec3(1, 0, 0));
+    m = glm::rotate(m, glm::radians(rotation[e].y), glm::vec3(0, 1, 0));
+    m = glm::rotate(m, glm::radians(rotation[e].z), glm::vec3(0, 0, 1));
+    return glm::scale(m, glm::vec3(scale[e]));
+}
+
+void EntityStore::render(Shader& shader) const {
+    for (size_t e = 0; e < flags.size(); ++e)
+        if ((flags[e] & (ALIVE | VISIBLE)) == (ALIVE | VISIBLE) && tweens[e] == 0) {
+            shader.setUint("objectId", pickId[e]);
+            prototypes[meshes[e]].model.Draw(shader, world[e]);
+        }
+}
+
+HitBox EntityStore::hitBox(Entity e) const {
+    HitBox box = prototypes[meshes[e]].model.checkBox();
+    box.position = position[e] + box.position * scale[e];
+    box.radius *= scale[e];
+    box.height *= scale[e];
+    return box;
+}
+
+AABB EntityStore::bounds(Entity e) const {
+    // Коробка цилиндра в единицах модели; восемь её углов переводятся матрицей сущности,
+    // поэтому повёрнутая сущность (стол) тоже целиком внутри
+    const HitBox box = prototypes[meshes[e]].model.checkBox();
+    const glm::vec3 lo = box.position - glm::vec3(box.radius, 0.0f, box.radius);
+    const glm::vec3 hi = box.position + glm::vec3(box.radius, box.height, box.radius);
+    const glm::mat4 m = (flags[e] & DIRTY) ? transform(e) : world[e];
+    AABB b;
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::vec3 p((corner & 1) ? hi.x : lo.x, (corner & 2) ? hi.y : lo.y, (corner & 4) ? hi.z : lo.z);
+        b.expand(glm::vec3(m * glm::vec4(p, 1.0f)));
+    }
+    return b;
+}
+
+void EntityStore::pickBounds(std::vector<AABB>& bounds, std::vector<Entity>& ids) const {
+    bounds.clear();
+    ids.clear();
+    for (Entity e = 0; e < flags.size(); ++e)
+        if ((flags[e] & (ALIVE | PICKABLE)) == (ALIVE | PICKABLE)) {
+            bounds.push_back(this->bounds(e));
+            ids.push_back(e);
+        }
+}
+
+bool EntityStore::raycastMesh(Entity e, const Ray& ray, float& t) {
+    Prototype& p = prototypes[meshes[e]];
+    if (!p.bvh || p.bvhVersion != p.model.asset->version) {
+        p.bvh = std::make_unique<MeshBVH>();
+        p.bvh->build(p.model.getMeshes());
+        p.bvhVersion = p.model.asset->version;
+    }
+    if (flags[e] & DIRTY) updateTransforms();
+    const glm::mat4 invModel = glm::inverse(world[e]);
+    // end — точка (на дальней плоскости), поэтому переводится как точка, а не как направление
+    Ray local{ glm::vec3(invModel * glm::vec4(ray.origin, 1.0f)), glm::vec3(invModel * glm::vec4(ray.direction, 0.0f)),
+        glm::vec3(invModel * glm::vec4(ray.end, 1.0f)) };
+    return p.bvh->raycast(local, t);
+}
@@ -0,0 +1,225 @@
+#pragma once
+#include "rules.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EVAL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+//--Оценка позиции: материал и таблицы полей ведутся инкрементально (аккумулятор правится на каждом ходе),
+//  признаки структуры и подвижности считаются битовыми операциями над битбордами и сворачиваются
+//  с весами одним SIMD-умножением. Вес признака разный в миттельшпиле и эндшпиле, между ними —
+//  интерполяция по числу простых шашек на доске
+template<class V>
+class Evaluator {
+public:
+    using Core = Rules<V>;
+    using Position = typename Core::Position;
+    using Move = typename Core::Move;
+    using Undo = typename Core::Undo;
+
+    static constexpr int SIZE = V::SIZE;
+    static constexpr int MAN = 100;
+    static constexpr int KING_MG = V::FLYING_KINGS ? 300 : 150;
+    static constexpr int KING_EG = V::FLYING_KINGS ? 350 : 180;
+    static constexpr int MAX_PHASE = 2 * V::ROWS * Core::HALF; // Простых в начальной позиции
+
+    enum Feature { MOBILITY, KING_MOBILITY, BACK_RANK, CENTER, SUPPORTED, ADVANCED, BREAKTHROUGH, HANGING, FEATURES };
+
+    // Материал и поля с точки зрения белых; men — простых на доске (фаза партии)
+    struct Accumulator {
+        int mg = 0, eg = 0;
+        int men = 0;
+    };
+
+    static Accumulator accumulate(const Position& p);
+    // Поправка после Core::make(p, m, u); side — сторона, сделавшая ход
+    static void update(Accumulator& acc, const Move& m, const Undo& u, int side);
+
+    // Оценка с точки зрения стороны, чей ход
+    static int evaluate(const Position& p, const Accumulator& acc);
+    static int evaluate(const Position& p) { return evaluate(p, accumulate(p)); }
+
+    // Признаки белых минус признаки чёрных
+    static void features(const Position& p, int16_t out[FEATURES]);
+    static int dot(const int16_t f[FEATURES], const int16_t w[FEATURES]);
+    static int dotScalar(const int16_t f[FEATURES], const int16_t w[FEATURES]);
+
+    alignas(16) static constexpr int16_t WEIGHTS_MG[FEATURES] = { 2, 1, 12, 8, 4, 3, 10, -12 };
+    alignas(16) static constexpr int16_t WEIGHTS_EG[FEATURES] = { 4, 3, 2, 2, 3, 8, 30, -20 };
+
+private:
+    // Ряд, считая от своего последнего: 0 — исходный, SIZE - 1 — поле превращения
+    static constexpr int advance(int sq, int side) {
+        return side == 0 ? SIZE - 1 - Core::ROW[sq] : Core::ROW[sq];
+    }
+    static constexpr int centrality(int sq) {
+        int r = Core::ROW[sq], c = Core::COL[sq];
+        return (std::min(r, SIZE - 1 - r) + std::min(c, SIZE - 1 - c));
+    }
+
+    // Таблицы полей [сторона][поле], в них же материал
+    using Table = std::array<std::array<int16_t, 64>, 2>;
+    static constexpr Table MAN_MG = [] {
+        Table t{};
+        for (int s = 0; s < 2; ++s)
+            for (int sq = 0; sq < 64; ++sq)
+                if (Core::ROW[sq] >= 0) t[s][sq] = int16_t(MAN + 2 * advance(sq, s) + centrality(sq));
+        return t;
+    }();
+    static constexpr Table MAN_EG = [] {
+        Table t{};
+        for (int s = 0; s < 2; ++s)
+            for (int sq = 0; sq < 64; ++sq)
+                if (Core::ROW[sq] >= 0) t[s][sq] = int16_t(MAN + 6 * advance(sq, s));
+        return t;
+    }();
+    static constexpr Table KING_MG_T = [] {
+        Table t{};
+        for (int s = 0; s < 2; ++s)
+            for (int sq = 0; sq < 64; ++sq)
+                if (Core::ROW[sq] >= 0) t[s][sq] = int16_t(KING_MG + 2 * centrality(sq));
+        return t;
+    }();
+    static constexpr Table KING_EG_T = [] {
+        Table t{};
+        for (int s = 0; s < 2; ++s)
+            for (int sq = 0; sq < 64; ++sq)
+                if (Core::ROW[sq] >= 0) t[s][sq] = int16_t(KING_EG + 3 * centrality(sq));
+        return t;
+    }();
+
+    static constexpr uint64_t rowsMask(int first, int last) {
+        uint64_t m = 0;
+        for (int r = first; r <= last; ++r) m |= Core::rowMask(r);
+        return m;
+    }
+    static constexpr uint64_t CENTER_MASK = [] {
+        uint64_t m = 0;
+        for (int r = SIZE / 2 - 1; r <= SIZE / 2; ++r)
+            for (int c = 2; c < SIZE - 2; ++c)
+                if (Core::square(r, c) >= 0) m |= 1ull << Core::square(r, c);
+        return m;
+    }();
+    // Свои половины доски и два ряда перед превращением
+    static constexpr uint64_t ENEMY_HALF[2] = { rowsMask(0, SIZE / 2 - 1), rowsMask(SIZE / 2, SIZE - 1) };
+    static constexpr uint64_t NEAR_PROMOTION[2] = { rowsMask(1, 2), rowsMask(SIZE - 3, SIZE - 2) };
+
+    static uint64_t shift(uint64_t set, int d) { return d > 0 ? set << d : set >> -d; }
+    static void sideFeatures(const Position& p, int s, int out[FEATURES]);
+};
+
+template<class V>
+typename Evaluator<V>::Accumulator Evaluator<V>::accumulate(const Position& p) {
+    Accumulator acc;
+    for (int s = 0; s < 2; ++s) {
+        const int sign = s == 0 ? 1 : -1;
+        for (uint64_t set = p.men[s]; set; set &= set - 1) {
+            int sq = std::countr_zero(set);
+            acc.mg += sign * MAN_MG[s][sq];
+            acc.eg += sign * MAN_EG[s][sq];
+            acc.men++;
+        }
+        for (uint64_t set = p.kings[s]; set; set &= set - 1) {
+            int sq = std::countr_zero(set);
+            acc.mg += sign * KING_MG_T[s][sq];
+            acc.eg += sign * KING_EG_T[s][sq];
+        }
+    }
+    return acc;
+}
+
+template<class V>
+void Evaluator<V>::update(Accumulator& acc, const Move& m, const Undo& u, int side) {
+    const int sign = side == 0 ? 1 : -1, enemy = side ^ 1;
+    const int from = m.from(), to = m.to();
+    const bool kingAfter = u.wasKing || m.promotes;
+
+    acc.mg -= sign * (u.wasKing ? KING_MG_T[side][from] : MAN_MG[side][from]);
+    acc.eg -= sign * (u.wasKing ? KING_EG_T[side][from] : MAN_EG[side][from]);
+    acc.mg += sign * (kingAfter ? KING_MG_T[side][to] : MAN_MG[side][to]);
+    acc.eg += sign * (kingAfter ? KING_EG_T[side][to] : MAN_EG[side][to]);
+    acc.men -= !u.wasKing && m.promotes;
+
+    for (uint64_t set = u.capturedMen; set; set &= set - 1) {
+        int sq = std::countr_zero(set);
+        acc.mg += sign * MAN_MG[enemy][sq];
+        acc.eg += sign * MAN_EG[enemy][sq];
+        acc.men--;
+    }
+    for (uint64_t set = u.capturedKings; set; set &= set - 1) {
+        int sq = std::countr_zero(set);
+        acc.mg += sign * KING_MG_T[enemy][sq];
+        acc.eg += sign * KING_EG_T[enemy][sq];
+    }
+}
+
+template<class V>
+void Evaluator<V>::sideFeatures(const Position& p, int s, int out[FEATURES]) {
+    const uint64_t empty = Core::BOARD & ~p.occupied();
+    const uint64_t own = p.pieces(s), enemy = p.pieces(s ^ 1);
+    const uint64_t men = p.men[s];
+    // Вперёд для белых — первые два направления, для чёрных — последние два
+    const int f0 = Core::DIRS[s == 0 ? 0 : 2], f1 = Core::DIRS[s == 0 ? 1 : 3];
+    const int b0 = Core::DIRS[s == 0 ? 2 : 0], b1 = Core::DIRS[s == 0 ? 3 : 1];
+
+    const uint64_t forwardEmpty = shift(empty, -f0) | shift(empty, -f1); // Шашки со свободным полем впереди
+    out[MOBILITY] = std::popcount(shift(men, f0) & empty) + std::popcount(shift(men, f1) & empty);
+    int kingMoves = 0;
+    for (int d : Core::DIRS) kingMoves += std::popcount(shift(p.kings[s], d) & empty);
+    out[KING_MOBILITY] = kingMoves;
+    out[BACK_RANK] = std::popcount(men & Core::PROMOTE[s ^ 1]);
+    out[CENTER] = std::popcount(own & CENTER_MASK);
+    out[SUPPORTED] = std::popcount(men & (shift(own, -b0) | shift(own, -b1)));
+    out[ADVANCED] = std::popcount(men & ENEMY_HALF[s]);
+    out[BREAKTHROUGH] = std::popcount(men & NEAR_PROMOTION[s] & forwardEmpty);
+
+    // Под боем: соседняя фигура соперника и пустое поле за нашей по той же диагонали
+    uint64_t hanging = 0;
+    for (int d : Core::DIRS) hanging |= own & shift(enemy, d) & shift(empty, -d);
+    out[HANGING] = std::popcount(hanging);
+}
+
+template<class V>
+void Evaluator<V>::features(const Position& p, int16_t out[FEATURES]) {
+    int white[FEATURES], black[FEATURES];
+    sideFeatures(p, 0, white);
+    sideFeatures(p, 1, black);
+    for (int i = 0; i < FEATURES; ++i) out[i] = int16_t(white[i] - black[i]);
+}
+
+template<class V>
+int Evaluator<V>::dotScalar(const int16_t f[FEATURES], const int16_t w[FEATURES]) {
+    int sum = 0;
+    for (int i = 0; i < FEATURES; ++i) sum += f[i] * w[i];
+    return sum;
+}
+
+template<class V>
+int Evaluator<V>::dot(const int16_t f[FEATURES], const int16_t w[FEATURES]) {
+#ifdef EVAL_SSE2
+    static_assert(FEATURES == 8, "признаки занимают ровно один 128-битный регистр");
+    __m128i products = _mm_madd_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(f)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(w)));
+    products = _mm_add_epi32(products, _mm_shuffle_epi32(products, _MM_SHUFFLE(1, 0, 3, 2)));
+    products = _mm_add_epi32(products, _mm_shuffle_epi32(products, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(products);
+#else
+    return dotScalar(f, w);
+#endif
+}
+
+template<class V>
+int Evaluator<V>::evaluate(const Position& p, const Accumulator& acc) {
+    alignas(16) int16_t f[FEATURES];
+    features(p, f);
+    const int mg = acc.mg + dot(f, WEIGHTS_MG);
+    const int eg = acc.eg + dot(f, WEIGHTS_EG);
+    const int phase = std::min(acc.men, MAX_PHASE);
+    const int score = (mg * phase + eg * (MAX_PHASE - phase)) / MAX_PHASE;
+    return p.side == 0 ? score : -score;
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+//--Наблюдение за файлами в каталогах (без рекурсии). На Linux работает через inotify,
+//  на остальных платформах опрашивает время изменения файлов. Изменения отдаются пачкой
+//  после короткого затишья: редактор, сохраняющий файл в несколько приёмов, даёт одну перезагрузку
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Добавлять каталоги нужно до первого wait()
+    void watchDirectory(const std::filesystem::path& directory);
+    // Ждёт изменений не дольше timeout. true — в changed лежат изменённые файлы (нормализованные пути)
+    bool wait(std::vector<std::filesystem::path>& changed, std::chrono::milliseconds timeout);
+
+    static std::filesystem::path normalize(const std::filesystem::path& path) {
+        std::error_code ec;
+        std::filesystem::path result = std::filesystem::weakly_canonical(path, ec);
+        return ec ? std::filesystem::absolute(path).lexically_normal() : result;
+    }
+
+private:
+    static constexpr std::chrono::milliseconds QUIET{ 100 };
+
+    std::set<std::filesystem::path> directories;
+#ifdef __linux__
+    int fd = -1;
+    std::map<int, std::filesystem::path> descriptors;
+#else
+    std::map<std::filesystem::path, std::filesystem::file_time_type> stamps;
+    void scan(const std::filesystem::path& directory, std::set<std::filesystem::path>* changed);
+#endif
+
+    // Собирает изменения за время timeout; true, если что-то нашлось
+    bool collect(std::chrono::milliseconds timeout, std::set<std::filesystem::path>& changed);
+};
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher() {
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+FileWatcher::~FileWatcher() {
+    if (fd >= 0) close(fd);
+}
+
+void FileWatcher::watchDirectory(const std::filesystem::path& directory) {
+    std::filesystem::path dir = normalize(directory);
+    if (fd < 0 || !directories.insert(dir).second) return;
+    // Редакторы сохраняют либо записью поверх файла, либо переименованием временного
+    int wd = inotify_add_watch(fd, dir.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd >= 0) descriptors[wd] = dir;
+}
+
+bool FileWatcher::collect(std::chrono::milliseconds timeout, std::set<std::filesystem::path>& changed) {
+    if (fd < 0) {
+        std::this_thread::sleep_for(timeout);
+        return false;
+    }
+    pollfd pfd{ fd, POLLIN, 0 };
+    if (poll(&pfd, 1, int(timeout.count())) <= 0) return false;
+
+    bool found = false;
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + length; ) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+            auto dir = descriptors.find(event->wd);
+            if (event->len > 0 && dir != descriptors.end()) {
+                changed.insert(dir->second / event->name);
+                found = true;
+            }
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+    return found;
+}
+
+#else
+
+FileWatcher::FileWatcher() {}
+
+FileWatcher::~FileWatcher() {}
+
+void FileWatcher::watchDirectory(const std::filesystem::path& directory) {
+    std::filesystem::path dir = normalize(directory);
+    if (directories.insert(dir).second)
+        scan(dir, nullptr); // Запоминаем исходные времена изменения
+}
+
+void FileWatcher::scan(const std::filesystem::path& directory, std::set<std::filesystem::path>* changed) {
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        if (!entry.is_regular_file(ec)) continue;
+        auto stamp = entry.last_write_time(ec);
+        if (ec) continue;
+        auto it = stamps.find(entry.path());
+        if (it == stamps.end() || it->second != stamp) {
+            stamps[entry.path()] = stamp;
+            if (changed) changed->insert(entry.path());
+        }
+    }
+}
+
+bool FileWatcher::collect(std::chrono::milliseconds timeout, std::set<std::filesystem::path>& changed) {
+    std::this_thread::sleep_for(timeout);
+    size_t before = changed.size();
+    for (const auto& dir : directories)
+        scan(dir, &changed);
+    return changed.size() > before;
+}
+
+#endif
+
+bool FileWatcher::wait(std::vector<std::filesystem::path>& changed, std::chrono::milliseconds timeout) {
+    std::set<std::filesystem::path> found;
+    if (!collect(timeout, found)) return false;
+    while (collect(QUIET, found)) {} // Дожидаемся, пока запись файлов закончится
+
+    changed.assign(found.begin(), found.end());
+    return true;
+}
@@ -34,6 +34,12 @@ public:
     }
 
     void RenderText(const std::string& text, float x, float y, float scale,
+        const glm::vec3& color, const glm::mat4& projection, Shader& shader) {
+        RenderText(text.c_str(), x, y, scale, color, projection, shader);
+    }
+
+    //    :   std::string
+    void RenderText(const char* text, float x, float y, float scale,
         const glm::vec3& color, const glm::mat4& projection, Shader& shader) {
         GLint prevShader;
         glGetIntegerv(GL_CURRENT_PROGRAM, &prevShader);
@@ -45,7 +51,7 @@ public:
         glBindVertexArray(VAO);
 
         //   Unicode code points  ()
-        const char* str = text.c_str();
+        const char* str = text;
         while (*str) {
             unsigned int codepoint = decodeUTF8(&str);
 
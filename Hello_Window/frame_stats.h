@@ -0,0 +1,62 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+//--Ритм кадров и задержка от щелчка до кадра. Хранит последние WINDOW значений каждого ряда в
+//  кольцах постоянного размера, поэтому замер не выделяет память. Паузы длиннее IDLE_GAP — это
+//  ожидание событий при рисовании по требованию, а не медленный кадр: в ритм они не попадают
+class FrameStats {
+public:
+    static constexpr size_t WINDOW = 240;
+    static constexpr double IDLE_GAP = 0.25;
+
+    struct Summary {
+        size_t count = 0;
+        double mean = 0.0, p99 = 0.0, worst = 0.0, jitter = 0.0; // Секунды; jitter — СКО
+    };
+
+    // Кадр показан в момент now (после glfwSwapBuffers)
+    void frame(double now);
+    // Ввод, пришедший в inputTime, впервые виден в кадре, показанном в now
+    void input(double inputTime, double now) { latencies.add(now - inputTime); }
+    void reset() { intervals = {}; latencies = {}; lastFrame = -1.0; }
+
+    Summary pacing() const { return intervals.summary(); }
+    Summary latency() const { return latencies.summary(); }
+
+private:
+    struct Ring {
+        double values[WINDOW] = {};
+        size_t next = 0, count = 0;
+        void add(double v) { values[next] = v; next = (next + 1) % WINDOW; count = std::min(count + 1, WINDOW); }
+        Summary summary() const;
+    };
+    Ring intervals, latencies;
+    double lastFrame = -1.0;
+};
+
+void FrameStats::frame(double now) {
+    if (lastFrame >= 0.0 && now - lastFrame < IDLE_GAP) intervals.add(now - lastFrame);
+    lastFrame = now;
+}
+
+FrameStats::Summary FrameStats::Ring::summary() const {
+    Summary s;
+    s.count = count;
+    if (count == 0) return s;
+    double sorted[WINDOW];
+    std::copy(values, values + count, sorted);
+    std::sort(sorted, sorted + count);
+    double sum = 0.0, squares = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        sum += sorted[i];
+        squares += sorted[i] * sorted[i];
+    }
+    s.mean = sum / count;
+    s.jitter = std::sqrt(std::max(0.0, squares / count - s.mean * s.mean));
+    s.p99 = sorted[std::min(count - 1, count * 99 / 100)];
+    s.worst = sorted[count - 1];
+    return s;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <glm/glm.hpp>
+
+//--Пирамида видимости камеры (6 плоскостей), извлекается из матрицы projection * view
+struct Frustum {
+    glm::vec4 planes[6]; // ax + by + cz + d >= 0 — точка внутри
+
+    static Frustum fromMatrix(const glm::mat4& vp) {
+        Frustum f;
+        // Строки матрицы (glm хранит столбцы)
+        glm::vec4 row[4];
+        for (int i = 0; i < 4; ++i)
+            row[i] = glm::vec4(vp[0][i], vp[1][i], vp[2][i], vp[3][i]);
+
+        f.planes[0] = row[3] + row[0]; // Левая
+        f.planes[1] = row[3] - row[0]; // Правая
+        f.planes[2] = row[3] + row[1]; // Нижняя
+        f.planes[3] = row[3] - row[1]; // Верхняя
+        f.planes[4] = row[3] + row[2]; // Ближняя
+        f.planes[5] = row[3] - row[2]; // Дальняя
+
+        for (auto& p : f.planes)
+            p /= glm::length(glm::vec3(p));
+        return f;
+    }
+
+    // Проверка AABB: false, только если коробка целиком снаружи хотя бы одной плоскости
+    bool intersectsAABB(const glm::vec3& min, const glm::vec3& max) const {
+        for (const auto& p : planes) {
+            // Самая "положительная" вершина коробки относительно нормали плоскости
+            glm::vec3 v(p.x >= 0 ? max.x : min.x,
+                        p.y >= 0 ? max.y : min.y,
+                        p.z >= 0 ? max.z : min.z);
+            if (p.x * v.x + p.y * v.y + p.z * v.z + p.w < 0)
+                return false;
+        }
+        return true;
+    }
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const {
+        for (const auto& p : planes)
+            if (p.x * center.x + p.y * center.y + p.z * center.z + p.w < -radius)
+                return false;
+        return true;
+    }
+};
@@ -0,0 +1,386 @@
+#pragma once
+#include "mapped_file.h"
+#include "pdn.h"
+#include "rules.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+//--База партий на диске — два файла, оба читаются через отображение в память:
+//  .cdb — заголовок, записи партий и таблица смещений записей в конце файла. Запись партии:
+//         результат, флаги, число ходов, стартовая позиция (если партия не с начальной расстановки)
+//         и по байту на ход — номер хода в списке, который выдаёт Rules<V>::generate;
+//  .cdx — индекс позиций: записи «хэш позиции → партия, полуход, следующий ход», отсортированные по хэшу.
+//  Поиск позиции — двоичный поиск по индексу, без чтения партий
+
+enum class GameResult : uint8_t { WHITE_WIN, BLACK_WIN, DRAW, UNKNOWN };
+
+GameResult parseGameResult(std::string_view token) {
+    if (token == "1-0" || token == "2-0") return GameResult::WHITE_WIN;
+    if (token == "0-1" || token == "0-2") return GameResult::BLACK_WIN;
+    if (token == "1/2-1/2" || token == "1-1") return GameResult::DRAW;
+    return GameResult::UNKNOWN;
+}
+
+struct GameDbHeader {
+    char magic[4];       // "CKDB"
+    uint32_t version;
+    uint32_t variant;
+    uint32_t games;
+    uint64_t offsetsAt;  // Смещение таблицы uint64_t[games]
+};
+
+struct GameIndexHeader {
+    char magic[4];       // "CKIX"
+    uint32_t version;
+    uint64_t entries;
+};
+
+struct PositionEntry {
+    static constexpr uint8_t END = 0xFF; // Позиция последняя в партии
+    uint64_t hash;
+    uint32_t game;
+    uint16_t ply;
+    uint8_t next;        // Номер хода, сделанного из позиции
+    uint8_t result;      // GameResult партии — статистика считается без чтения .cdb
+
+    bool operator<(const PositionEntry& o) const {
+        if (hash != o.hash) return hash < o.hash;
+        if (game != o.game) return game < o.game;
+        return ply < o.ply;
+    }
+};
+static_assert(sizeof(PositionEntry) == 16, "запись индекса должна быть плотной");
+
+//--Партия из базы (срез отображённого файла)
+struct GameRecordView {
+    GameResult result = GameResult::UNKNOWN;
+    bool hasSetup = false;
+    uint64_t men[2] = {}, kings[2] = {};
+    int side = 0;
+    std::span<const uint8_t> choices;
+};
+
+//--Сводка по позиции: сколько партий её достигли, чем они кончились и какие ходы делались дальше
+struct PositionStats {
+    struct MoveStats {
+        uint8_t choice;   // Номер хода в списке генератора для этой позиции
+        uint32_t games = 0, whiteWins = 0, blackWins = 0, draws = 0;
+    };
+    uint32_t games = 0, whiteWins = 0, blackWins = 0, draws = 0;
+    std::vector<MoveStats> moves; // По убыванию числа партий
+};
+
+class GameDatabase {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint8_t FLAG_SETUP = 1;
+
+    static std::string indexPath(const std::string& path) {
+        return std::filesystem::path(path).replace_extension(".cdx").string();
+    }
+
+    bool open(const std::string& path, std::string& error);
+    Variant variant() const { return Variant(header().variant); }
+    uint32_t games() const { return header().games; }
+    size_t positions() const { return index.size(); }
+
+    // Все записи индекса с данным хэшем (по партиям, в каждой — по полуходам)
+    std::span<const PositionEntry> find(uint64_t hash) const;
+    PositionStats stats(uint64_t hash) const;
+    // Номера партий, достигших позиции (каждая один раз)
+    void gamesWith(uint64_t hash, std::vector<uint32_t>& out) const;
+    // false — нет такой партии или её запись выходит за конец файла
+    bool game(uint32_t id, GameRecordView& out) const;
+
+private:
+    MappedFile gamesFile, indexFile;
+    std::span<const PositionEntry> index;
+
+    const GameDbHeader& header() const { return *reinterpret_cast<const GameDbHeader*>(gamesFile.data()); }
+};
+
+bool GameDatabase::open(const std::string& path, std::string& error) {
+    if (!gamesFile.open(path) || gamesFile.size() < sizeof(GameDbHeader)
+        || std::memcmp(header().magic, "CKDB", 4) != 0 || header().version != VERSION) {
+        error = "не база партий: " + path;
+        return false;
+    }
+    const GameDbHeader& h = header();
+    // Размеры сравниваются вычитанием и делением: сумма и произведение из повреждённого заголовка могли бы переполниться
+    if (h.offsetsAt > gamesFile.size() || h.games > (gamesFile.size() - h.offsetsAt) / sizeof(uint64_t)) {
+        error = "база партий повреждена: " + path;
+        return false;
+    }
+
+    const std::string ixPath = indexPath(path);
+    const GameIndexHeader* ix = nullptr;
+    if (indexFile.open(ixPath) && indexFile.size() >= sizeof(GameIndexHeader))
+        ix = reinterpret_cast<const GameIndexHeader*>(indexFile.data());
+    if (!ix || std::memcmp(ix->magic, "CKIX", 4) != 0 || ix->version != VERSION
+        || ix->entries > (indexFile.size() - sizeof(GameIndexHeader)) / sizeof(PositionEntry)) {
+        error = "нет индекса позиций: " + ixPath;
+        return false;
+    }
+    index = { reinterpret_cast<const PositionEntry*>(indexFile.data() + sizeof(GameIndexHeader)), size_t(ix->entries) };
+    return true;
+}
+
+std::span<const PositionEntry> GameDatabase::find(uint64_t hash) const {
+    auto first = std::lower_bound(index.begin(), index.end(), hash,
+        [](const PositionEntry& e, uint64_t h) { return e.hash < h; });
+    auto last = std::upper_bound(first, index.end(), hash,
+        [](uint64_t h, const PositionEntry& e) { return h < e.hash; });
+    return index.subspan(size_t(first - index.begin()), size_t(last - first));
+}
+
+PositionStats GameDatabase::stats(uint64_t hash) const {
+    PositionStats s;
+    uint32_t lastGame = UINT32_MAX;
+    for (const PositionEntry& e : find(hash)) {
+        // Повторение позиции внутри партии считается один раз — по первому приходу в неё
+        if (e.game == lastGame) continue;
+        lastGame = e.game;
+
+        const auto result = GameResult(e.result);
+        s.games++;
+        s.whiteWins += result == GameResult::WHITE_WIN;
+        s.blackWins += result == GameResult::BLACK_WIN;
+        s.draws += result == GameResult::DRAW;
+        if (e.next == PositionEntry::END) continue;
+
+        auto it = std::find_if(s.moves.begin(), s.moves.end(), [&](const auto& m) { return m.choice == e.next; });
+        if (it == s.moves.end()) it = s.moves.insert(s.moves.end(), { e.next });
+        it->games++;
+        it->whiteWins += result == GameResult::WHITE_WIN;
+        it->blackWins += result == GameResult::BLACK_WIN;
+        it->draws += result == GameResult::DRAW;
+    }
+    std::sort(s.moves.begin(), s.moves.end(), [](const auto& a, const auto& b) { return a.games > b.games; });
+    return s;
+}
+
+void GameDatabase::gamesWith(uint64_t hash, std::vector<uint32_t>& out) const {
+    out.clear();
+    for (const PositionEntry& e : find(hash))
+        if (out.empty() || out.back() != e.game) out.push_back(e.game);
+}
+
+bool GameDatabase::game(uint32_t id, GameRecordView& out) const {
+    if (id >= games()) return false;
+    uint64_t offset;
+    std::memcpy(&offset, gamesFile.data() + header().offsetsAt + id * sizeof(uint64_t), sizeof(offset));
+    // Запись целиком внутри файла: заголовок 4 байта, расстановка 33 байта, count выборов хода.
+    // Смещения из таблицы не доверяем: обрезанный или испорченный файл отвергается здесь
+    const uint64_t size = gamesFile.size();
+    if (offset > size || size - offset < 4) return false;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(gamesFile.data()) + offset;
+    uint16_t count;
+    std::memcpy(&count, p + 2, sizeof(count));
+    const uint64_t record = ((p[1] & FLAG_SETUP) ? 4 + 33 : 4) + uint64_t(count);
+    if (size - offset < record) return false;
+
+    out.result = GameResult(p[0]);
+    out.hasSetup = p[1] & FLAG_SETUP;
+    p += 4;
+    if (out.hasSetup) {
+        std::memcpy(out.men, p, sizeof(out.men));
+        std::memcpy(out.kings, p + 16, sizeof(out.kings));
+        out.side = p[32];
+        p += 33;
+    }
+    out.choices = { p, count };
+    return true;
+}
+
+//--Восстановление партии из базы: стартовая позиция и ходы
+template<class V>
+bool decodeGame(const GameDatabase& db, uint32_t id, typename Rules<V>::Position& start, std::vector<typename Rules<V>::Move>& line) {
+    using Core = Rules<V>;
+    GameRecordView record;
+    if (!db.game(id, record)) return false;
+
+    start = Core::initial();
+    if (record.hasSetup) {
+        std::copy(record.men, record.men + 2, start.men);
+        std::copy(record.kings, record.kings + 2, start.kings);
+        start.side = record.side;
+    }
+
+    line.clear();
+    typename Core::Position pos = start;
+    std::vector<typename Core::Move> legal;
+    for (uint8_t choice : record.choices) {
+        Core::generate(pos, legal);
+        if (choice >= legal.size()) return false;
+        line.push_back(legal[choice]);
+        Core::apply(pos, legal[choice]);
+    }
+    return true;
+}
+
+struct GameDbBuildStats {
+    size_t games = 0;
+    size_t positions = 0;
+    size_t skipped = 0; // Партии другого варианта или с недопустимыми ходами
+};
+
+//--Сборка базы из архива PDN. Куски архива разбираются параллельно, каждый поток сортирует свои
+//  записи индекса, затем отсортированные куски попарно сливаются — тоже параллельно
+template<class V>
+bool buildGameDatabase(std::string_view pdn, const std::string& path, GameDbBuildStats& stats, std::string& error) {
+    using Core = Rules<V>;
+    struct Part {
+        std::string records;
+        std::vector<uint64_t> offsets; // Внутри records
+        std::vector<PositionEntry> entries;
+        size_t skipped = 0;
+    };
+
+    const std::vector<size_t> bounds = splitPdnArchive(pdn, pdnWorkers(pdn));
+    std::vector<Part> parts(bounds.size() - 1);
+
+    auto work = [&](size_t index) {
+        Part& part = parts[index];
+        PdnReader reader(pdn.substr(bounds[index], bounds[index + 1] - bounds[index]));
+        PdnReplay<V> replay;
+        PdnGame game;
+        while (reader.next(game)) {
+            if (game.moves.empty() && game.tags.empty()) continue;
+            Variant variant = V::ID;
+            variantFromGameType(game.tag("GameType"), variant);
+            if (variant != V::ID || !replay.load(game) || replay.line().size() > UINT16_MAX) {
+                part.skipped++;
+                continue;
+            }
+
+            const uint32_t id = uint32_t(part.offsets.size());
+            const auto result = uint8_t(parseGameResult(game.result));
+            const bool setup = replay.start() != Core::initial();
+            const auto count = uint16_t(replay.line().size());
+
+            part.offsets.push_back(part.records.size());
+            part.records += char(result);
+            part.records += char(setup ? GameDatabase::FLAG_SETUP : 0);
+            part.records.append(reinterpret_cast<const char*>(&count), sizeof(count));
+            if (setup) {
+                part.records.append(reinterpret_cast<const char*>(replay.start().men), 16);
+                part.records.append(reinterpret_cast<const char*>(replay.start().kings), 16);
+                part.records += char(replay.start().side);
+            }
+            part.records.append(reinterpret_cast<const char*>(replay.choices().data()), count);
+
+            typename Core::Position pos = replay.start();
+            for (uint16_t ply = 0; ; ++ply) {
+                const uint8_t next = ply < count ? replay.choices()[ply] : PositionEntry::END;
+                part.entries.push_back({ Core::hash(pos), id, ply, next, result });
+                if (ply == count) break;
+                Core::apply(pos, replay.line()[ply]);
+            }
+        }
+        std::sort(part.entries.begin(), part.entries.end());
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < parts.size(); ++i) pool.emplace_back(work, i);
+    work(0);
+    for (auto& t : pool) t.join();
+    pool.clear();
+
+    // Сквозные номера партий; порядок внутри куска от сдвига номеров не меняется
+    std::vector<PositionEntry> entries;
+    std::vector<size_t> runs{ 0 };
+    uint32_t gameBase = 0;
+    for (Part& part : parts) {
+        for (PositionEntry& e : part.entries) e.game += gameBase;
+        entries.insert(entries.end(), part.entries.begin(), part.entries.end());
+        runs.push_back(entries.size());
+        gameBase += uint32_t(part.offsets.size());
+        stats.skipped += part.skipped;
+        part.entries = {};
+    }
+    while (runs.size() > 2) {
+        std::vector<size_t> merged{ 0 };
+        for (size_t i = 0; i + 2 < runs.size(); i += 2) {
+            pool.emplace_back([&entries, first = runs[i], middle = runs[i + 1], last = runs[i + 2]] {
+                std::inplace_merge(entries.begin() + first, entries.begin() + middle, entries.begin() + last);
+                });
+            merged.push_back(runs[i + 2]);
+        }
+        if ((runs.size() - 1) % 2) merged.push_back(runs.back());
+        for (auto& t : pool) t.join();
+        pool.clear();
+        runs = std::move(merged);
+    }
+
+    std::ofstream games(path, std::ios::binary);
+    std::ofstream index(GameDatabase::indexPath(path), std::ios::binary);
+    if (!games || !index) {
+        error = "не удалось создать " + path;
+        return false;
+    }
+
+    GameDbHeader header{ { 'C', 'K', 'D', 'B' }, GameDatabase::VERSION, uint32_t(V::ID), gameBase, 0 };
+    games.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    std::vector<uint64_t> offsets;
+    offsets.reserve(gameBase);
+    for (const Part& part : parts) {
+        for (uint64_t offset : part.offsets) offsets.push_back(written + offset);
+        games.write(part.records.data(), std::streamsize(part.records.size()));
+        written += part.records.size();
+    }
+    header.offsetsAt = (written + 7) & ~uint64_t(7);
+    games.write("\0\0\0\0\0\0\0", std::streamsize(header.offsetsAt - written));
+    games.write(reinterpret_cast<const char*>(offsets.data()), std::streamsize(offsets.size() * sizeof(uint64_t)));
+    games.seekp(0);
+    games.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    GameIndexHeader ixHeader{ { 'C', 'K', 'I', 'X' }, GameDatabase::VERSION, entries.size() };
+    index.write(reinterpret_cast<const char*>(&ixHeader), sizeof(ixHeader));
+    index.write(reinterpret_cast<const char*>(entries.data()), std::streamsize(entries.size() * sizeof(PositionEntry)));
+
+    stats.games = gameBase;
+    stats.positions = entries.size();
+    if (!games || !index) {
+        error = "ошибка записи " + path;
+        return false;
+    }
+    return true;
+}
+
+//--Отчёт по позиции: итоги партий и ходы в нотации варианта
+template<class V>
+void reportPosition(const GameDatabase& db, const typename Rules<V>::Position& pos, std::ostream& out) {
+    using Core = Rules<V>;
+    const PositionStats s = db.stats(Core::hash(pos));
+    out << "Партий с позицией: " << s.games << " (белые " << s.whiteWins << ", чёрные " << s.blackWins
+        << ", ничьи " << s.draws << ")\n";
+
+    std::vector<typename Core::Move> legal;
+    Core::generate(pos, legal);
+    for (const auto& m : s.moves) {
+        std::string text;
+        if (m.choice < legal.size()) PdnReplay<V>::appendMove(text, legal[m.choice]);
+        else text = "?";
+        out << "  " << text << ": " << m.games << " (белые " << m.whiteWins << ", чёрные " << m.blackWins
+            << ", ничьи " << m.draws << ")\n";
+    }
+}
+
+//--Запрос из сцены: позиция на доске
+void reportPosition(const GameDatabase& db, const GameRules::Cells& cells, bool whiteToMove, std::ostream& out) {
+    dispatchVariant(db.variant(), [&](auto traits) {
+        using V = decltype(traits);
+        reportPosition<V>(db, Rules<V>::fromCells(cells, whiteToMove ? 0 : 1), out);
+        });
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include "file_watcher.h"
+#include "model.h"
+#include "shader.h"
+
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//--Горячая перезагрузка шейдеров и моделей. Фоновый поток ждёт изменений файлов, читает исходники
+//  шейдеров и разбирает модели (Assimp и декодирование текстур). GL-часть — компиляция программ и
+//  загрузка буферов — выполняется в apply() между кадрами, поэтому рендер всегда видит либо
+//  старый, либо полностью новый ресурс
+class HotReloader {
+public:
+    HotReloader() = default;
+    ~HotReloader() { stop(); }
+    HotReloader(const HotReloader&) = delete;
+    HotReloader& operator=(const HotReloader&) = delete;
+
+    // onReload вызывается после успешной пересборки (например, чтобы заново выставить uniform'ы)
+    void watchShader(Shader* shader, std::function<void(Shader&)> onReload = {});
+    // Следит за каталогом модели: меняется OBJ, MTL или текстура — модель перезагружается целиком
+    void watchModel(const Model& model);
+
+    void start();
+    void stop();
+    // Применяет готовые перезагрузки; вызывается из потока с GL-контекстом. Возвращает их число
+    int apply();
+
+private:
+    struct ShaderEntry {
+        Shader* shader;
+        std::vector<std::filesystem::path> files;
+        std::function<void(Shader&)> onReload;
+    };
+    struct ModelEntry {
+        std::shared_ptr<ModelAsset> asset;
+        std::filesystem::path directory;
+    };
+    struct ShaderResult { size_t entry; Shader::Sources sources; };
+    struct ModelResult { size_t entry; ModelSource source; };
+
+    FileWatcher watcher;
+    std::vector<ShaderEntry> shaders;
+    std::vector<ModelEntry> models;
+
+    std::thread worker;
+    std::atomic<bool> running{ false };
+    std::mutex mutex; // Защищает готовые результаты
+    std::vector<ShaderResult> readyShaders;
+    std::vector<ModelResult> readyModels;
+
+    void run();
+};
+
+void HotReloader::watchShader(Shader* shader, std::function<void(Shader&)> onReload) {
+    ShaderEntry entry{ shader, {}, std::move(onReload) };
+    for (const std::string* path : { &shader->getVertexPath(), &shader->getFragmentPath(), &shader->getGeometryPath() }) {
+        if (path->empty()) continue;
+        entry.files.push_back(FileWatcher::normalize(*path));
+        watcher.watchDirectory(entry.files.back().parent_path());
+    }
+    shaders.push_back(std::move(entry));
+}
+
+void HotReloader::watchModel(const Model& model) {
+    for (const ModelEntry& entry : models)
+        if (entry.asset == model.asset) return; // Копии одной модели делят один ассет
+
+    std::filesystem::path directory = FileWatcher::normalize(model.asset->path).parent_path();
+    watcher.watchDirectory(directory);
+    models.push_back({ model.asset, directory });
+}
+
+void HotReloader::start() {
+    if (running) return;
+    running = true;
+    worker = std::thread(&HotReloader::run, this);
+}
+
+void HotReloader::stop() {
+    running = false;
+    if (worker.joinable()) worker.join();
+}
+
+void HotReloader::run() {
+    std::vector<std::filesystem::path> changed;
+    while (running) {
+        if (!watcher.wait(changed, std::chrono::milliseconds(250))) continue;
+
+        // Пути в записях не меняются после start(), поэтому читать их здесь безопасно
+        for (size_t i = 0; i < shaders.size(); ++i) {
+            bool touched = false;
+            for (const auto& file : changed)
+                for (const auto& own : shaders[i].files)
+                    touched |= file == own;
+            if (!touched) continue;
+
+            Shader::Sources sources = shaders[i].shader->readSources();
+            std::lock_guard<std::mutex> lock(mutex);
+            readyShaders.push_back({ i, std::move(sources) });
+        }
+        for (size_t i = 0; i < models.size(); ++i) {
+            bool touched = false;
+            for (const auto& file : changed)
+                touched |= file.parent_path() == models[i].directory;
+            if (!touched) continue;
+
+            ModelSource source = ModelSource::parse(models[i].asset->path);
+            std::lock_guard<std::mutex> lock(mutex);
+            readyModels.push_back({ i, std::move(source) });
+        }
+    }
+}
+
+int HotReloader::apply() {
+    std::vector<ShaderResult> shaderResults;
+    std::vector<ModelResult> modelResults;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (readyShaders.empty() && readyModels.empty()) return 0;
+        shaderResults.swap(readyShaders);
+        modelResults.swap(readyModels);
+    }
+
+    int applied = 0;
+    for (ShaderResult& result : shaderResults) {
+        ShaderEntry& entry = shaders[result.entry];
+        if (entry.shader->reload(result.sources)) {
+            if (entry.onReload) entry.onReload(*entry.shader);
+            std::cout << "HOT_RELOAD: шейдер " << entry.shader->getFragmentPath() << " пересобран\n";
+            applied++;
+        }
+        else
+            std::cout << "HOT_RELOAD: ошибка в " << entry.shader->getFragmentPath() << ", оставлена прежняя программа\n";
+    }
+    for (ModelResult& result : modelResults) {
+        ModelEntry& entry = models[result.entry];
+        if (!result.source.ok) {
+            std::cout << "HOT_RELOAD: не удалось разобрать " << entry.asset->path << ", модель не изменена\n";
+            continue;
+        }
+        // Вместе с мешами ассет пересчитывает хит-бокс: Model::checkBox у всех копий строится из него
+        entry.asset->upload(std::move(result.source));
+        std::cout << "HOT_RELOAD: модель " << entry.asset->path << " перезагружена\n";
+        applied++;
+    }
+    return applied;
+}
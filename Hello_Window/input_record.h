@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//--Событие ввода сеанса: время от начала записи и параметры обработчика GLFW
+struct RecordedInput {
+    enum Kind : char { CURSOR = 'C', SCROLL = 'S', KEY = 'K', BUTTON = 'B', RESIZE = 'R' };
+    double time = 0.0;
+    Kind kind = CURSOR;
+    int a = 0, b = 0, c = 0;     // Клавиша: код, действие, модификаторы; кнопка: номер, действие; размер: ш, в
+    double x = 0.0, y = 0.0;     // Курсор (у кнопки — где был щелчок); прокрутка — y
+};
+
+//--Запись ввода в текстовый файл: строка заголовка с размером окна, затем событие на строку.
+//  Текст, а не двоичный формат: записи сеансов сравниваются и правятся руками
+class InputRecorder {
+public:
+    ~InputRecorder() { close(); }
+    bool open(const std::string& path, int width, int height, std::string& error);
+    void add(const RecordedInput& event);
+    void close();
+    size_t count() const { return written; }
+
+private:
+    FILE* file = nullptr;
+    size_t written = 0;
+};
+
+//--Воспроизведение записи: события отдаются по виртуальному времени, которое двигает вызывающий
+//  (фиксированный шаг кадра), поэтому прогон не зависит от скорости машины
+class InputReplay {
+public:
+    bool load(const std::string& path, std::string& error);
+    int width() const { return windowWidth; }
+    int height() const { return windowHeight; }
+    double duration() const { return events.empty() ? 0.0 : events.back().time; }
+    size_t size() const { return events.size(); }
+    bool done() const { return next == events.size(); }
+
+    // Все события со временем не позже time, по порядку записи
+    template<class Handler>
+    void dispatchUntil(double time, Handler&& handler);
+
+private:
+    std::vector<RecordedInput> events;
+    size_t next = 0;
+    int windowWidth = 0, windowHeight = 0;
+};
+
+bool InputRecorder::open(const std::string& path, int width, int height, std::string& error) {
+    close();
+    file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        error = "не удалось открыть " + path + " для записи";
+        return false;
+    }
+    std::fprintf(file, "# input v1 %d %d\n", width, height);
+    written = 0;
+    return true;
+}
+
+void InputRecorder::add(const RecordedInput& event) {
+    if (!file) return;
+    // %.17g — время читается обратно без потерь, и события попадают в те же кадры
+    std::fprintf(file, "%.17g %c %d %d %d %.17g %.17g\n", event.time, char(event.kind), event.a, event.b, event.c,
+        event.x, event.y);
+    written++;
+}
+
+void InputRecorder::close() {
+    if (file) std::fclose(file);
+    file = nullptr;
+}
+
+bool InputReplay::load(const std::string& path, std::string& error) {
+    FILE* file = std::fopen(path.c_str(), "r");
+    if (!file) {
+        error = "не удалось открыть " + path;
+        return false;
+    }
+    events.clear();
+    next = 0;
+    bool ok = std::fscanf(file, "# input v1 %d %d", &windowWidth, &windowHeight) == 2;
+    if (!ok) error = path + ": нет заголовка записи ввода";
+    int line = 1;
+    while (ok) {
+        RecordedInput event;
+        char kind = 0;
+        const int fields = std::fscanf(file, "%lf %c %d %d %d %lf %lf", &event.time, &kind, &event.a, &event.b,
+            &event.c, &event.x, &event.y);
+        line++;
+        if (fields == EOF) break;
+        const std::string known = "CSKBR";
+        if (fields != 7 || known.find(kind) == std::string::npos || (!events.empty() && event.time < events.back().time)) {
+            error = path + ":" + std::to_string(line) + ": неверное событие";
+            ok = false;
+            break;
+        }
+        event.kind = RecordedInput::Kind(kind);
+        events.push_back(event);
+    }
+    std::fclose(file);
+    return ok;
+}
+
+template<class Handler>
+void InputReplay::dispatchUntil(double time, Handler&& handler) {
+    while (next < events.size() && events[next].time <= time)
+        handler(events[next++]);
+}
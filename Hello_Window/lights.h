@@ -0,0 +1,308 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "shader.h"
+
+//--Точечный источник или прожектор. Свет гаснет к range плавно, поэтому источник освещает только
+//  кластеры, которые задевает его сфера
+struct Light {
+    glm::vec3 position{ 0.0f };
+    float range = 20.0f;
+    glm::vec3 color{ 1.0f };                      // Диффузный и бликовый цвет
+    float linear = 0.09f, quadratic = 0.032f;     // Затухание 1 / (1 + linear·d + quadratic·d²)
+    glm::vec3 direction{ 0.0f, -1.0f, 0.0f };     // Только у прожектора
+    float cutOff = -1.0f, outerCutOff = -1.0f;    // Косинусы конуса; outerCutOff = -1 — точечный свет
+};
+
+//--Кластерное освещение: пирамида вида делится на плитки экрана и логарифмические слои глубины,
+//  источники раскладываются по кластерам на CPU (слои делятся между потоками), а фрагментный шейдер
+//  перебирает только источники своего кластера. Списки лежат в текстурных буферах (GL 3.3 без SSBO):
+//  данные источников, (смещение, число) на кластер и общий массив индексов.
+//  Память выделяется в конструкторе; build и upload в кадре кучу не трогают
+class ClusteredLights {
+public:
+    static constexpr int TILES_X = 16, TILES_Y = 9, SLICES = 24;
+    static constexpr int CLUSTERS = TILES_X * TILES_Y * SLICES;
+    static constexpr int MAX_LIGHTS = 1024;
+    static constexpr int MAX_PER_CLUSTER = 128;  // Лишние источники кластера отбрасываются (overflow)
+    // Текстурные юниты буферов — выше тех, что занимают материалы мешей
+    static constexpr int UNIT_LIGHTS = 13, UNIT_GRID = 14, UNIT_INDICES = 15;
+
+    // threads = 0 — по числу ядер (не больше 4); вызывающий поток считается одним из них
+    explicit ClusteredLights(int threads = 0);
+    ~ClusteredLights();
+    ClusteredLights(const ClusteredLights&) = delete;
+    ClusteredLights& operator=(const ClusteredLights&) = delete;
+
+    // Коробки кластеров пересчитываются, только если проекция или размер кадра изменились
+    void setProjection(const glm::mat4& projection, float nearPlane, float farPlane, int width, int height);
+    // Раскладка источников (первые MAX_LIGHTS) по кластерам для камеры view
+    void build(std::span<const Light> lights, const glm::mat4& view);
+
+    // GL: буферы создаются при первой выгрузке (нужен контекст)
+    void upload();
+    // Привязка буферов и параметров сетки к шейдеру 6.multiple_lights.fs
+    void apply(Shader& shader) const;
+    static void bindUnits(Shader& shader);
+
+    // Статистика последнего build
+    int lightCount() const { return count; }
+    size_t references() const { return packedCount; }
+    int busiestCluster() const { return busiest; }
+    int overflow() const { return overflowed; }
+    int threads() const { return int(workers.size()) + 1; }
+
+private:
+    // Сетка кластеров (пространство вида)
+    glm::vec3 clusterMin[CLUSTERS], clusterMax[CLUSTERS];
+    glm::mat4 cachedProjection{ 0.0f };
+    int cachedWidth = 0, cachedHeight = 0;
+    float nearZ = 0.1f, farZ = 100.0f;
+    float sliceScale = 0.0f, sliceBias = 0.0f;   // Слой = log(глубина)·scale − bias
+
+    // Источники кадра в пространстве вида и слои, которые задевает их сфера
+    std::vector<glm::vec4> viewSpheres;
+    std::vector<int> firstSlice, lastSlice;
+    std::vector<glm::vec4> gpuLights;  // 4 texel на источник, см. upload
+    int count = 0;
+
+    // Раскладка: у каждого кластера MAX_PER_CLUSTER мест, после — упаковка в один массив
+    std::vector<uint16_t> slots;
+    uint16_t slotCount[CLUSTERS];
+    uint32_t grid[CLUSTERS * 2];       // Смещение и число источников кластера
+    std::vector<uint32_t> packed;
+    size_t packedCount = 0;
+    int busiest = 0, overflowed = 0;
+
+    // Потоки раскладки: слой s обрабатывает поток s % threads()
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    uint64_t generation = 0;
+    int pending = 0;
+    bool stopping = false;
+
+    unsigned int lightBuffer = 0, gridBuffer = 0, indexBuffer = 0;
+    unsigned int lightTexture = 0, gridTexture = 0, indexTexture = 0;
+
+    int slice(float depth) const {
+        return std::clamp(int(std::log(depth) * sliceScale - sliceBias), 0, SLICES - 1);
+    }
+    void assignSlices(int first, int step);
+    void workerLoop(int index);
+};
+
+ClusteredLights::ClusteredLights(int threadCount) {
+    viewSpheres.resize(MAX_LIGHTS);
+    firstSlice.resize(MAX_LIGHTS);
+    lastSlice.resize(MAX_LIGHTS);
+    gpuLights.resize(size_t(MAX_LIGHTS) * 4);
+    slots.resize(size_t(CLUSTERS) * MAX_PER_CLUSTER);
+    packed.resize(size_t(CLUSTERS) * MAX_PER_CLUSTER);
+    std::memset(slotCount, 0, sizeof(slotCount));
+    std::memset(grid, 0, sizeof(grid));
+
+    if (threadCount <= 0) threadCount = std::clamp(int(std::thread::hardware_concurrency()), 1, 4);
+    for (int i = 1; i < threadCount; ++i)
+        workers.emplace_back(&ClusteredLights::workerLoop, this, i);
+}
+
+ClusteredLights::~ClusteredLights() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+    if (!lightBuffer) return; // Без выгрузки (замер на CPU) GL не трогаем
+    glDeleteTextures(1, &lightTexture);
+    glDeleteTextures(1, &gridTexture);
+    glDeleteTextures(1, &indexTexture);
+    glDeleteBuffers(1, &lightBuffer);
+    glDeleteBuffers(1, &gridBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+}
+
+void ClusteredLights::setProjection(const glm::mat4& projection, float nearPlane, float farPlane, int width, int height) {
+    if (projection == cachedProjection && width == cachedWidth && height == cachedHeight) return;
+    cachedProjection = projection;
+    cachedWidth = width;
+    cachedHeight = height;
+    nearZ = nearPlane;
+    farZ = farPlane;
+    sliceScale = SLICES / std::log(farZ / nearZ);
+    sliceBias = SLICES * std::log(nearZ) / std::log(farZ / nearZ);
+
+    // Углы плитки — лучи из камеры через плоскость z = -1; на глубине d точка луча равна ray·d
+    const glm::mat4 inverse = glm::inverse(projection);
+    auto ray = [&](float ndcX, float ndcY) {
+        glm::vec4 p = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+        glm::vec3 v = glm::vec3(p) / p.w;
+        return v / -v.z;
+    };
+    for (int z = 0; z < SLICES; ++z) {
+        const float d0 = nearZ * std::pow(farZ / nearZ, float(z) / SLICES);
+        const float d1 = nearZ * std::pow(farZ / nearZ, float(z + 1) / SLICES);
+        for (int y = 0; y < TILES_Y; ++y)
+            for (int x = 0; x < TILES_X; ++x) {
+                const float x0 = -1.0f + 2.0f * x / TILES_X, x1 = -1.0f + 2.0f * (x + 1) / TILES_X;
+                const float y0 = -1.0f + 2.0f * y / TILES_Y, y1 = -1.0f + 2.0f * (y + 1) / TILES_Y;
+                const glm::vec3 corners[4] = { ray(x0, y0), ray(x1, y0), ray(x0, y1), ray(x1, y1) };
+                glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+                for (const auto& c : corners)
+                    for (float d : { d0, d1 }) {
+                        lo = glm::min(lo, c * d);
+                        hi = glm::max(hi, c * d);
+                    }
+                const int cluster = x + TILES_X * (y + TILES_Y * z);
+                clusterMin[cluster] = lo;
+                clusterMax[cluster] = hi;
+            }
+    }
+}
+
+void ClusteredLights::build(std::span<const Light> lights, const glm::mat4& view) {
+    count = int(std::min(lights.size(), size_t(MAX_LIGHTS)));
+    for (int i = 0; i < count; ++i) {
+        const Light& light = lights[i];
+        const glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        viewSpheres[i] = glm::vec4(center, light.range);
+        // Сфера целиком за камерой или дальше дальней плоскости не задевает ни одного слоя
+        const float nearest = -center.z - light.range, farthest = -center.z + light.range;
+        if (farthest < nearZ || nearest > farZ) {
+            firstSlice[i] = 1;
+            lastSlice[i] = 0;
+        }
+        else {
+            firstSlice[i] = slice(std::max(nearest, nearZ));
+            lastSlice[i] = slice(std::min(farthest, farZ));
+        }
+
+        gpuLights[i * 4 + 0] = glm::vec4(light.position, light.range);
+        gpuLights[i * 4 + 1] = glm::vec4(light.color, light.linear);
+        gpuLights[i * 4 + 2] = glm::vec4(light.direction, light.quadratic);
+        gpuLights[i * 4 + 3] = glm::vec4(light.cutOff, light.outerCutOff, 0.0f, 0.0f);
+    }
+
+    overflowed = 0;
+    if (workers.empty()) assignSlices(0, 1);
+    else {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            generation++;
+            pending = int(workers.size());
+        }
+        wake.notify_all();
+        assignSlices(0, threads());
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+    }
+
+    // Упаковка списков кластеров подряд
+    packedCount = 0;
+    busiest = 0;
+    for (int c = 0; c < CLUSTERS; ++c) {
+        const int n = slotCount[c];
+        grid[c * 2] = uint32_t(packedCount);
+        grid[c * 2 + 1] = uint32_t(n);
+        const uint16_t* from = &slots[size_t(c) * MAX_PER_CLUSTER];
+        for (int k = 0; k < n; ++k) packed[packedCount++] = from[k];
+        busiest = std::max(busiest, n);
+    }
+}
+
+// Кластеры слоёв first, first + step, ...: источник проверяется только в слоях, которые задевает
+void ClusteredLights::assignSlices(int first, int step) {
+    int dropped = 0;
+    for (int z = first; z < SLICES; z += step) {
+        const int base = TILES_X * TILES_Y * z;
+        for (int c = base; c < base + TILES_X * TILES_Y; ++c) slotCount[c] = 0;
+        for (int i = 0; i < count; ++i) {
+            if (z < firstSlice[i] || z > lastSlice[i]) continue;
+            const glm::vec3 center = glm::vec3(viewSpheres[i]);
+            const float radius2 = viewSpheres[i].w * viewSpheres[i].w;
+            for (int c = base; c < base + TILES_X * TILES_Y; ++c) {
+                // Квадрат расстояния от центра сферы до коробки кластера
+                const glm::vec3 nearest = glm::clamp(center, clusterMin[c], clusterMax[c]);
+                const glm::vec3 d = center - nearest;
+                if (glm::dot(d, d) > radius2) continue;
+                if (slotCount[c] == MAX_PER_CLUSTER) { dropped++; continue; }
+                slots[size_t(c) * MAX_PER_CLUSTER + slotCount[c]++] = uint16_t(i);
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    overflowed += dropped;
+}
+
+void ClusteredLights::workerLoop(int index) {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        assignSlices(index, threads());
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) done.notify_one();
+    }
+}
+
+void ClusteredLights::upload() {
+    if (!lightBuffer) {
+        // Буферы на наибольший размер: дальше только перезапись, без перевыделения
+        auto create = [](unsigned int& buffer, unsigned int& texture, GLenum format, size_t bytes) {
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            glBufferData(GL_TEXTURE_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_BUFFER, texture);
+            glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+        };
+        create(lightBuffer, lightTexture, GL_RGBA32F, gpuLights.size() * sizeof(glm::vec4));
+        create(gridBuffer, gridTexture, GL_RG32UI, sizeof(grid));
+        create(indexBuffer, indexTexture, GL_R32UI, packed.size() * sizeof(uint32_t));
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, size_t(count) * 4 * sizeof(glm::vec4), gpuLights.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(grid), grid);
+    glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, packedCount * sizeof(uint32_t), packed.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLights::apply(Shader& shader) const {
+    glActiveTexture(GL_TEXTURE0 + UNIT_LIGHTS);
+    glBindTexture(GL_TEXTURE_BUFFER, lightTexture);
+    glActiveTexture(GL_TEXTURE0 + UNIT_GRID);
+    glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+    glActiveTexture(GL_TEXTURE0 + UNIT_INDICES);
+    glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader.setIVec3("clusterCount", TILES_X, TILES_Y, SLICES);
+    shader.setVec2("clusterTile", float(cachedWidth) / TILES_X, float(cachedHeight) / TILES_Y);
+    shader.setVec2("clusterDepth", sliceScale, sliceBias);
+}
+
+// Юниты сэмплеров не меняются, их достаточно задать после сборки программы
+void ClusteredLights::bindUnits(Shader& shader) {
+    shader.setInt("lightData", UNIT_LIGHTS);
+    shader.setInt("clusterGrid", UNIT_GRID);
+    shader.setInt("lightIndices", UNIT_INDICES);
+}
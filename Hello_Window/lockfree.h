@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//--Очередь с одним писателем и одним читателем на кольце постоянной ёмкости (степень двойки).
+//  Писатель двигает только tail, читатель — только head: блокировок и выделений памяти нет
+template<class T, size_t N>
+class SpscQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "ёмкость очереди должна быть степенью двойки");
+public:
+    // false — очередь полна, элемент не записан
+    bool push(const T& value);
+    bool pop(T& out);
+    bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+private:
+    T items[N];
+    alignas(64) std::atomic<size_t> head{ 0 }; // Следующий для чтения
+    alignas(64) std::atomic<size_t> tail{ 0 }; // Следующий для записи
+};
+
+template<class T, size_t N>
+bool SpscQueue<T, N>::push(const T& value) {
+    const size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == N) return false;
+    items[t & (N - 1)] = value;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T, size_t N>
+bool SpscQueue<T, N>::pop(T& out) {
+    const size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return false;
+    out = items[h & (N - 1)];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+//--Тройной буфер снимков состояния. Писатель заполняет back() и публикует его обменом с промежуточным
+//  буфером, читатель забирает промежуточный в front(). Никто никого не ждёт: снимки, которые читатель
+//  не успел забрать, перезаписываются следующими, а читатель всегда видит целый последний снимок
+template<class T>
+class TripleBuffer {
+public:
+    // Писатель
+    T& back() { return slots[backIndex]; }
+    void publish() { backIndex = middle.exchange(uint8_t(backIndex | FRESH), std::memory_order_acq_rel) & INDEX; }
+
+    // Читатель: true — пришёл новый снимок, он теперь в front()
+    bool update();
+    const T& front() const { return slots[frontIndex]; }
+
+private:
+    static constexpr uint8_t INDEX = 3, FRESH = 4;
+    T slots[3];
+    std::atomic<uint8_t> middle{ 1 }; // Индекс промежуточного буфера; FRESH — опубликован и не прочитан
+    uint8_t backIndex = 0;            // Только писатель
+    uint8_t frontIndex = 2;           // Только читатель
+};
+
+template<class T>
+bool TripleBuffer<T>::update() {
+    if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+    frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+    return true;
+}
@@ -8,34 +8,111 @@
 #include "shader.h"
 #include "camera.h"
 #include "model.h"
-#include "checker.h"
-#include "Object.h"
+#include "entity.h"
 #include "CheckerBoard.h"
 #include "font.h"
+#include "spectator.h"
+#include "hot_reload.h"
+#include "mapped_file.h"
+#include "gamedb.h"
+#include "engine.h"
+#include "analysis.h"
+#include "proof.h"
+#include "clock.h"
+#include "alloc_counter.h"
+#include "lockfree.h"
+#include "frame_stats.h"
+#include "lights.h"
+#include "picking.h"
+#include "input_record.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 #include <iostream>
 #include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 
 //--Переменные размера окна
 static unsigned int SCR_WIDTH = 1600;
 static unsigned int SCR_HEIGHT = 900;
 
-//--Структура луча
-struct Ray {
-    glm::vec3 origin;
-    glm::vec3 direction;
-    glm::vec3 end;
+//--Параметры запуска из командной строки
+struct AppOptions {
+    int spectatorBoards = 0;      // --spectator N: зрительский режим с N досками
+    bool spectatorBench = false;  // --bench-spectator: стресс-тест зрительского режима
+    bool hotReload = false;       // --hot-reload: пересборка изменённых шейдеров и моделей на лету
+    bool continuous = false;      // --continuous: кадр каждый цикл (для замеров), иначе только при изменениях
+    int lamps = 0;                // --lamps N: N ламп над сценой (кластерное освещение)
+    bool lightsBench = false;     // --bench-lights: раскладка источников по кластерам на 1..4 потоках
+    bool idPicking = false;       // --id-picking: выбор по буферу номеров объектов вместо луча
+    bool pickingBench = false;    // --bench-picking: кадр и задержка выбора лучом и буфером номеров
+    std::string record;           // --record FILE: запись ввода сеанса
+    std::string replay;           // --replay FILE: прогон записанного сеанса с фиксированным шагом
+    std::string replayTrace;      // --replay-trace FILE: времена кадров прогона (CSV) для сравнения сборок
+    int replayFps = 60;           // --replay-fps N: шаг виртуального времени прогона
+    Variant variant = Variant::RUSSIAN; // --variant russian|english|international|brazilian
+    std::string pdnCheck;         // --pdn-check FILE: проверка архива PDN без открытия окна
+    std::string pdnLoad;          // --pdn-load FILE: партия для пошагового просмотра (клавиша N)
+    int pdnGame = 1;              // --pdn-game N: номер партии в файле, с 1
+    std::string dbBuildPdn, dbBuild; // --db-build PDN DB: сборка базы партий и индекса позиций
+    std::string dbQuery, dbQueryFen; // --db-query DB [FEN]: статистика позиции (по умолчанию начальной)
+    std::string database;         // --db DB: статистика позиции на доске по клавише I
+    std::string engineSide;       // --engine white|black|both: за кого играет компьютер
+    std::string engineKind = "alphabeta"; // --engine-kind alphabeta|nnue|mcts
+    Engine::Limits engineLimits;  // --depth N, --movetime SECONDS
+    std::string book;             // --book FILE: дебютная книга для движка
+    std::string bookBuildPdn, bookBuild; // --book-build PDN BOOK: книга из архива партий
+    int bookSelfPlay = 0;         // --book-selfplay GAMES BOOK: книга из партий движка с самим собой
+    int bookPlies = 16;           // --book-plies N: сколько первых полуходов партии попадает в книгу
+    int bookMinGames = 2;         // --book-min N: ход попадает в книгу, если сыгран не меньше N раз
+    std::string bookProbe;        // --book-probe BOOK: замер стоимости пробы книги
+    bool evalBench = false;       // --bench-eval: замер оценочной функции (оценок в секунду)
+    int tacticsDepth = 0;         // --bench-tactics [DEPTH]: тактический набор с тихим поиском и без (эталон — глубина DEPTH, 9)
+    std::string nnue;             // --nnue FILE: веса сети для --engine-kind nnue и --bench-nnue
+    std::string nnueInit;         // --nnue-init FILE: записать стартовую (материальную) сеть
+    bool nnueBench = false;       // --bench-nnue: сеть против ручной оценки (позиций в секунду)
+    MctsConfig mcts;              // --mcts-threads N, --mcts-playout random|greedy, --mcts-playouts N (на ход)
+    bool mctsBench = false;       // --bench-mcts: доигрываний в секунду на 1..N потоках
+    bool ponder = false;          // --ponder: компьютер думает над ожидаемым ответом в ход соперника (F3)
+    bool analysis = false;        // --analysis: бесконечный анализ позиции на доске (F2)
+    double clockBase = 0.0, clockIncrement = 0.0; // --clock MIN+INC: часы (минуты на партию + секунды за ход)
+    int clockMatch = 0;           // --clock-match GAMES: партии движка с самим собой по часам
+    bool headless = false;        // --headless: движок без окна, команды построчно из stdin
+    std::string solve;            // --solve FEN|start: доказательство выигрыша решателем df-pn
+    double solveTime = 60.0;      // --solve-time SECONDS: предел времени решателя (0 — без предела)
+    int solveMemory = 64;         // --solve-memory MB: размер таблицы решателя
 };
 
 
+//--Веса сети из файла; без файла или при ошибке — материальная сеть
+static void loadNetwork(const std::string& path, Variant variant, NnueNetwork& network) {
+    std::string error;
+    if (!path.empty() && network.load(path, error)) {
+        if (network.variant != variant) std::cout << "Сеть " << path << " обучена для другого варианта правил\n";
+        return;
+    }
+    if (!path.empty()) std::cout << "Сеть: " << error << "\n";
+    std::cout << "Сеть: материальные веса (--nnue FILE — обученные)\n";
+    network.initMaterial(variant);
+}
+
+
 //--Класс приложения
 class Application {
 public:
-    Application();
+    Application(const AppOptions& options = {});
     ~Application();
     int run();
 
@@ -44,6 +121,9 @@ private:
     GLFWwindow* window_ = nullptr;
     double deltaTime_ = 0.0f;
     double lastFrame_ = 0.0f;
+    // Кадр по требованию: рисуем, только когда сцена изменилась, иначе спим в ожидании событий
+    bool redraw_ = true;
+    bool cameraKeys_ = false;    // Зажата клавиша движения камеры: кадры нужны подряд
 
     // Camera & view/projection
     Camera camera_{ glm::vec3(0.0f, 30.0f, 0.0f) };
@@ -52,32 +132,173 @@ private:
     float lastX_ = SCR_WIDTH / 2.0f;
     float lastY_ = SCR_HEIGHT / 2.0f;
     bool firstMouse_ = true;
+    bool keysDown_[GLFW_KEY_LAST + 1] = {}; // По событиям onKey, а не glfwGetKey: так же работает и при воспроизведении
+
+    // Запись и воспроизведение ввода: обработчики GLFW пишут события в файл, прогон подаёт их обратно
+    // в те же обработчики по виртуальному времени. Живой ввод во время прогона не учитывается
+    InputRecorder* recorder_ = nullptr;
+    InputReplay* replay_ = nullptr;
+    double recordStart_ = 0.0;
+    glm::dvec2 replayCursor_{ 0.0 };        // Курсор последнего воспроизведённого щелчка
 
     // Selection & input state
     CheckersBoard* board;
-    std::vector<Object*> objects_;
-    Object* selectedObject_ = nullptr;
+    // Реквизит сцены (стол) — сущности потока кадра: их двигают и выбирают в режиме редактирования
+    EntityStore scene_;
+    Entity table_ = NO_ENTITY;
+    Entity selectedObject_ = NO_ENTITY;
     bool modelSelected_ = false;
     bool cursorLocked_ = true;
     bool altPressed_ = false;
     bool editMode = false;
+    bool refinePicking_ = false;
     glm::dvec2 preLockPos_;
 
+    // BVH объектов сцены для выбора в режиме редактирования
+    BVH sceneBVH_;
+    std::vector<AABB> objectBounds_;
+    std::vector<Entity> pickIds_;   // Сущность каждой коробки objectBounds_
+    bool sceneBVHStale_ = false;
+
+    // Выбор по буферу номеров (--id-picking): ответ приходит кадром позже, конвейер не ждёт.
+    // Номера: поле доски — CheckersBoard::cellPickId, сущность сцены — SCENE_PICK_BASE + индекс.
+    // Луч на CPU считается и здесь — для сравнения в профиле (F4)
+    static constexpr uint32_t SCENE_PICK_BASE = 1u << 16;
+    enum PickTag : uint32_t { PICK_BOARD, PICK_EDIT };
+    IdPicker* picker_ = nullptr;
+    glm::mat4 pickInverseViewProjection_{ 1.0f }; // Камера щелчка: глубина ответа переводится в мир
+    uint32_t rayAnswer_ = 0;                      // Ответ луча на последний щелчок
+    uint64_t rayPicks_ = 0, picks_ = 0, pickAgreements_ = 0;
+    double rayPickTime_ = 0.0, pickLatency_ = 0.0, pickFrames_ = 0.0; // Суммы по rayPicks_ и picks_
+
     // Shader
     Shader* shader_ = nullptr;
     Shader* shaderFont = nullptr;
+    Shader* shaderInstanced_ = nullptr;
+    ShaderCache* shaderCache_ = nullptr;
+    HotReloader* hotReload_ = nullptr;
+
+    // Spectator mode
+    AppOptions options_;
+    SpectatorScene* spectator_ = nullptr;
+    SpectatorFeed feed_{ 12345 };
+    double feedAccumulator_ = 0.0;
+    float nearPlane_ = 0.1f;
+    float farPlane_ = 100.0f;
+
+    // Освещение: солнце — uniform шейдера, фонарик камеры (lights_[0]) и лампы — через кластеры
+    ClusteredLights* clusters_ = nullptr;
+    std::vector<Light> lights_;
+    double lightBuildTime_ = 0.0;
 
     Font* mainFont = nullptr;
 
+    // Просмотр партии из PDN: ходы проигрываются по одному
+    std::vector<GameRules::PathMove> replayMoves_;
+    size_t replayNext_ = 0;
+
+    GameDatabase* database_ = nullptr;
+
+    // Компьютерный игрок
+    std::unique_ptr<Engine> engine_;
+    OpeningBook* book_ = nullptr;
+    NnueNetwork* network_ = nullptr;
+    bool engineWhite_ = false, engineBlack_ = false;
+    // Поиск идёт в фоне: ход компьютера, обдумывание ответа соперника, анализ
+    BackgroundSearch* search_ = nullptr;
+    bool analysis_ = false, ponder_ = false;
+    bool ponderHit_ = false;                 // Текущий ход компьютера — продолжение обдумывания
+    GameRules::Cells ponderFrom_ = {};       // Позиция, в которой обдумывается ответ соперника
+    Engine::Limits moveLimits_;              // Пределы текущего хода компьютера
+
+    // Часы: время хода компьютера распределяет TimeManager
+    GameClock clock_;
+    TimeManager timeManager_;
+    size_t clockPlies_ = 0;                  // Ходов партии на момент последнего переключения часов
+    Engine::Report searchReport_;            // Последний итог фонового поиска (панель, пределы хода)
+
+    // Профиль кадра (F4): выделения памяти за кадр и за такт симуляции, занятость пулов доски,
+    // ритм кадров и задержка от ввода до кадра. Пики и окна замеров сбрасываются по F4
+    bool showProfile_ = false;
+    uint64_t frameAllocations_ = 0;
+    uint64_t allocationPeak_ = 0;
+    uint64_t allocatingFrames_ = 0, profiledFrames_ = 0;
+    uint64_t simAllocations_ = 0, simAllocationPeak_ = 0, simAllocationsSeen_ = 0;
+    FrameStats frameStats_;
+    uint64_t presentedInput_ = 0;            // Последнее событие ввода, уже показанное на экране
+
+    // Поток симуляции: доска, движок, часы, запись партии и всё выше в разделе «Компьютерный игрок»
+    // живут в нём. Главный поток (GLFW и GL) только кладёт ввод в очередь и рисует последний снимок.
+    // Очередь и снимки без блокировок; мьютекс нужен лишь условной переменной, на которой спит симуляция
+    struct InputEvent {
+        enum Kind : uint8_t { CLICK, KEY };
+        Kind kind = CLICK;
+        int a = 0, b = 0;        // Щелчок: ряд и столбец; клавиша: код GLFW
+        double time = 0.0;       // glfwGetTime() в обработчике GLFW
+    };
+    struct GameSnapshot {
+        CheckersBoard::Snapshot board;
+        bool clockShown = false;
+        int clockActive = -1;                // Чьи часы идут; -1 — стоят
+        char clock[2][48] = {};
+        bool panelShown = false;
+        char panelStats[160] = {}, panelLine[96] = {};
+        size_t checkersInUse = 0, checkerCapacity = 0, highlightsInUse = 0, highlightCapacity = 0;
+        uint64_t simAllocations = 0;         // Всего выделений потока симуляции
+        double simStep = 0.0;                // Длительность такта, секунд
+        uint64_t inputSeq = 0;               // Сколько событий ввода учтено в снимке
+        double inputTime = 0.0;              // Когда пришло последнее из них
+    };
+    std::thread simThread_;
+    std::atomic<bool> simRunning_{ false };
+    std::mutex simMutex_;
+    std::condition_variable simWake_;
+    bool simPending_ = false;                // Под simMutex_: есть ввод или поиск просит такт
+    SpscQueue<InputEvent, 256> input_;
+    TripleBuffer<GameSnapshot> snapshots_;
+    uint64_t inputSeq_ = 0;                  // Поток симуляции: учтено событий ввода
+    double lastInputTime_ = 0.0;
+
     // Initialization helpers
     bool initWindow();
     void setupCallbacks();
     void loadResources();
+    void setupLighting(Shader& shader);
+    void setupLights(float extent);
+    void updateLights(Shader& shader);
 
     // Main loop
     void processInput();
     void update();
     void render();
+    void waitForEvents();
+    void presentFrame();
+    void startSimulation();
+    void stopSimulation();
+    void wakeSimulation();
+    void queueInput(InputEvent::Kind kind, int a, int b, double time = -1.0);
+    void simulate();
+    double simulationStep(double now);
+    void handleInput(const InputEvent& event);
+    void publishSnapshot(double stepStart);
+    void renderSpectator();
+    int runSpectatorBenchmark();
+    int runPickingBenchmark();
+    int runReplay();
+    void record(RecordedInput event);
+    void replayEvent(const RecordedInput& event);
+    void loadReplay();
+    void playReplayMove();
+    void saveGame() const;
+    bool createEngine();
+    bool isEngineTurn() const;
+    void updateSearch();
+    void playSearchMove();
+    void renderAnalysisPanel();
+    Engine::Limits engineMoveLimits() const;
+    void updateClock();
+    void renderClock();
+    void renderProfile();
 
     // Callbacks handlers
     void onFramebufferSize(int width, int height);
@@ -90,8 +311,17 @@ private:
     // Helpers
     Ray generateRay(int x, int y) const;
     bool testIntersection(const Ray& ray, const HitBox& box, float& t) const;
+    Entity pickObject(const Ray& ray);
+    void rebuildSceneBVH();
+    void objectMoved(Entity object);
     void toggleCursorLock();
+    void cursorPosition(double& x, double& y) const;
     bool screenToBoardCoords(double mx, double my, int& outR, int& outC);
+    bool boardCellAt(const glm::vec3& p, int& outR, int& outC) const;
+    uint32_t rayPick(double x, double y, bool edit);
+    uint32_t resolvePick(const IdPicker::Result& result, bool edit) const;
+    void applyPick(uint32_t id, bool edit, double time);
+    void pollPicks();
     void moveSelected(int key);
     void printSelected() const;
 };
@@ -105,37 +335,209 @@ private:
 //================================================
 
 
-Application::Application() {
+Application::Application(const AppOptions& options) : options_(options) {
     if (!initWindow()) std::exit(EXIT_FAILURE);
     setupCallbacks();
     loadResources();
 } 
 
 Application::~Application() {
+    stopSimulation();
+    delete hotReload_; // Останавливаем фоновый поток до удаления шейдеров
     delete shader_;
-    delete selectedObject_;
+    delete clusters_;
+    delete picker_;
+    delete recorder_;
+    delete replay_;
+    delete shaderInstanced_;
+    delete shaderCache_;
+    delete spectator_;
+    delete search_; // Останавливаем поиск до удаления доски и движка
     delete board;
+    delete database_;
+    delete book_;
+    delete network_;
     delete mainFont;
     glfwTerminate();
 }
 
 //--Основной цикл
 int Application::run() {
+    if (options_.spectatorBench) return runSpectatorBenchmark();
+    if (options_.pickingBench) return runPickingBenchmark();
+    if (replay_) return runReplay();
+
+    startSimulation();
     while (!glfwWindowShouldClose(window_)) {
+        const uint64_t allocations = AllocationCounter::thisThread();
         double current = glfwGetTime();
         deltaTime_ = current - lastFrame_;
         lastFrame_ = current;
 
         processInput();
         update();
-        render();
+        if (picker_) pollPicks();
+        if (redraw_ || options_.continuous) {
+            render();
+            glfwSwapBuffers(window_);
+            redraw_ = false;
+            presentFrame();
+        }
+        waitForEvents(); // Щелчки и клавиши ставятся здесь в очередь симуляции
 
-        glfwSwapBuffers(window_);
-        glfwPollEvents();
+        frameAllocations_ = AllocationCounter::thisThread() - allocations;
+        allocationPeak_ = std::max(allocationPeak_, frameAllocations_);
+        allocatingFrames_ += frameAllocations_ > 0;
+        profiledFrames_++;
     }
+    stopSimulation();
+
+    const FrameStats::Summary pacing = frameStats_.pacing(), latency = frameStats_.latency();
+    if (pacing.count > 0)
+        std::cout << "Кадры: " << pacing.mean * 1000.0 << " мс в среднем, 99% за " << pacing.p99 * 1000.0
+            << " мс, худший " << pacing.worst * 1000.0 << " мс, разброс " << pacing.jitter * 1000.0 << " мс\n";
+    if (latency.count > 0)
+        std::cout << "Ввод до кадра: " << latency.mean * 1000.0 << " мс в среднем, 99% за " << latency.p99 * 1000.0
+            << " мс, худшая " << latency.worst * 1000.0 << " мс\n";
     return 0;
 }
 
+//--Кадр показан: ритм кадров и задержка от ввода. «Показан» — возврат из glfwSwapBuffers;
+//  с вертикальной синхронизацией это момент смены кадра, без неё — нижняя оценка
+void Application::presentFrame() {
+    const double shown = glfwGetTime();
+    frameStats_.frame(shown);
+    const GameSnapshot& game = snapshots_.front();
+    if (game.inputSeq != presentedInput_) {
+        frameStats_.input(game.inputTime, shown);
+        presentedInput_ = game.inputSeq;
+    }
+}
+
+//--Запуск и остановка потока симуляции. Первый снимок публикуется до первого кадра
+void Application::startSimulation() {
+    if (simThread_.joinable()) return;
+    board->setTime(float(glfwGetTime()));
+    publishSnapshot(glfwGetTime());
+    simRunning_.store(true, std::memory_order_release);
+    simThread_ = std::thread([this] { simulate(); });
+}
+
+void Application::stopSimulation() {
+    if (!simThread_.joinable()) return;
+    simRunning_.store(false, std::memory_order_release);
+    wakeSimulation();
+    simThread_.join();
+}
+
+void Application::wakeSimulation() {
+    {
+        std::lock_guard<std::mutex> lock(simMutex_);
+        simPending_ = true;
+    }
+    simWake_.notify_one();
+}
+
+//--Из обработчиков GLFW: событие с отметкой времени уходит в поток симуляции
+//  (time — когда событие случилось на самом деле, если оно обрабатывается позже: ответ буфера номеров)
+void Application::queueInput(InputEvent::Kind kind, int a, int b, double time) {
+    InputEvent event;
+    event.kind = kind;
+    event.a = a;
+    event.b = b;
+    event.time = time >= 0.0 ? time : glfwGetTime();
+    if (!input_.push(event)) std::cout << "Очередь ввода переполнена, событие пропущено\n";
+    wakeSimulation();
+}
+
+//--Поток симуляции. Такт: ввод из очереди, часы, фоновый поиск, анимации доски, публикация снимка.
+//  Пока идёт анимация, такты идут 120 раз в секунду, пока идут часы или поиск — 10 раз в секунду
+//  (поиск ещё и будит по готовности); в покое поток спит до следующего события
+void Application::simulate() {
+    while (simRunning_.load(std::memory_order_acquire)) {
+        const double wait = simulationStep(glfwGetTime());
+        std::unique_lock<std::mutex> lock(simMutex_);
+        auto pending = [this] { return simPending_; };
+        if (wait < 0.0) simWake_.wait(lock, pending);
+        else simWake_.wait_for(lock, std::chrono::duration<double>(wait), pending);
+        simPending_ = false;
+    }
+}
+
+//--Такт симуляции в момент now (при воспроизведении — виртуальное время кадра). Возвращает, через
+//  сколько секунд нужен следующий такт; -1 — только по событию
+double Application::simulationStep(double now) {
+    const double start = glfwGetTime();
+    board->setTime(float(now)); // Ходы этого такта начинают анимацию сейчас, а не с прошлого такта
+    InputEvent event;
+    while (input_.pop(event)) handleInput(event);
+    if (options_.clockBase > 0.0) updateClock();
+    if (search_) updateSearch();
+    board->update(float(now));
+    publishSnapshot(start);
+
+    if (board->isAnimating()) return 1.0 / 120.0;
+    if (clock_.isRunning() || (search_ && search_->mode() != BackgroundSearch::Mode::IDLE)) return 0.1;
+    return -1.0;
+}
+
+//--Снимок для кадра: доска, строки часов и панели поиска, счётчики профиля. Строки собираются
+//  в массивах снимка, поэтому такт без ввода не выделяет память
+void Application::publishSnapshot(double stepStart) {
+    GameSnapshot& game = snapshots_.back();
+    board->snapshot(game.board);
+
+    game.clockShown = options_.clockBase > 0.0;
+    game.clockActive = clock_.isRunning() ? clock_.sideToMove() : -1;
+    if (game.clockShown) {
+        const char* names[2] = { "Белые ", "Черные " };
+        for (int side = 0; side < 2; ++side)
+            std::snprintf(game.clock[side], sizeof(game.clock[side]), "%s%s", names[side],
+                GameClock::format(clock_.remaining(side)).c_str());
+    }
+
+    game.panelShown = search_ && (analysis_ || search_->mode() != BackgroundSearch::Mode::IDLE);
+    if (game.panelShown) {
+        search_->progress(searchReport_);
+        const Engine::Report& report = searchReport_;
+        const char* title = "Анализ";
+        if (search_->mode() == BackgroundSearch::Mode::MOVE) title = "Компьютер думает";
+        if (search_->mode() == BackgroundSearch::Mode::PONDER) title = "Обдумывание ответа";
+        if (report.fromBook) std::snprintf(game.panelStats, sizeof(game.panelStats), "%s: ход из книги", title);
+        else std::snprintf(game.panelStats, sizeof(game.panelStats), "%s: глубина %d, оценка %d, узлов %llu", title,
+            report.depth, report.score, (unsigned long long)report.nodes);
+        const std::string& text = report.lineText;
+        if (text.size() > 72) std::snprintf(game.panelLine, sizeof(game.panelLine), "%.*s ...",
+            int(std::min(text.rfind(' ', 72), text.size())), text.c_str());
+        else std::snprintf(game.panelLine, sizeof(game.panelLine), "%s", text.c_str());
+    }
+
+    game.checkersInUse = board->checkersInUse();
+    game.checkerCapacity = board->checkerCapacity();
+    game.highlightsInUse = board->highlightsInUse();
+    game.highlightCapacity = board->highlightCapacity();
+    game.simAllocations = AllocationCounter::thisThread();
+    game.simStep = glfwGetTime() - stepStart;
+    game.inputSeq = inputSeq_;
+    game.inputTime = lastInputTime_;
+    snapshots_.publish();
+    glfwPostEmptyEvent(); // Разбудить кадр
+}
+
+//--Ожидание событий. Пока ничего не меняется, поток спит в glfwWaitEvents: его будят обработчики ввода
+//  и окна, а поток симуляции — после каждого опубликованного снимка (glfwPostEmptyEvent).
+//  Перезагрузка ресурсов проверяется раз в 0.25 с, ответ буфера номеров — раз в миллисекунду
+void Application::waitForEvents() {
+    if (options_.continuous || spectator_ || cameraKeys_) {
+        glfwPollEvents();
+        return;
+    }
+    if (picker_ && picker_->pending()) glfwWaitEventsTimeout(0.001);
+    else if (hotReload_) glfwWaitEventsTimeout(0.25);
+    else glfwWaitEvents();
+    lastFrame_ = glfwGetTime(); // Время сна не двигает камеру
+}
+
 //--Инициализацию нужных переменных и глобальная настройка
 bool Application::initWindow() {
     glfwInit();
@@ -166,22 +568,39 @@ bool Application::initWindow() {
 }
 
 //--Установка CALLBACK's
+//  Во время воспроизведения живой ввод и размер окна берутся только из записи
 void Application::setupCallbacks() {
     glfwSetWindowUserPointer(window_, this);
     glfwSetFramebufferSizeCallback(window_, [](GLFWwindow* w, int width, int height) {
-        static_cast<Application*>(glfwGetWindowUserPointer(w))->onFramebufferSize(width, height); 
+        Application* app = static_cast<Application*>(glfwGetWindowUserPointer(w));
+        if (app->replay_) return;
+        app->record({ 0.0, RecordedInput::RESIZE, width, height });
+        app->onFramebufferSize(width, height); 
         });
     glfwSetCursorPosCallback(window_, [](GLFWwindow* w, double x, double y) {
-        static_cast<Application*>(glfwGetWindowUserPointer(w))->onCursorMove(x, y);
+        Application* app = static_cast<Application*>(glfwGetWindowUserPointer(w));
+        if (app->replay_) return;
+        app->record({ 0.0, RecordedInput::CURSOR, 0, 0, 0, x, y });
+        app->onCursorMove(x, y);
         });
     glfwSetScrollCallback(window_, [](GLFWwindow* w, double, double y) {
-        static_cast<Application*>(glfwGetWindowUserPointer(w))->onScroll(y);
+        Application* app = static_cast<Application*>(glfwGetWindowUserPointer(w));
+        if (app->replay_) return;
+        app->record({ 0.0, RecordedInput::SCROLL, 0, 0, 0, 0.0, y });
+        app->onScroll(y);
         });
     glfwSetKeyCallback(window_, [](GLFWwindow* w, int k, int s, int a, int m) {
-        static_cast<Application*>(glfwGetWindowUserPointer(w))->onKey(k, s, a, m);
+        Application* app = static_cast<Application*>(glfwGetWindowUserPointer(w));
+        if (app->replay_) return;
+        app->record({ 0.0, RecordedInput::KEY, k, a, m });
+        app->onKey(k, s, a, m);
         });
     glfwSetMouseButtonCallback(window_, [](GLFWwindow* w, int b, int a, int) {
-        static_cast<Application*>(glfwGetWindowUserPointer(w))->onMouseButton(b, a);
+        Application* app = static_cast<Application*>(glfwGetWindowUserPointer(w));
+        if (app->replay_) return;
+        double x, y; glfwGetCursorPos(w, &x, &y);
+        app->record({ 0.0, RecordedInput::BUTTON, b, a, 0, x, y });
+        app->onMouseButton(b, a);
         });
     glfwSetInputMode(window_, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 }
@@ -189,28 +608,20 @@ void Application::setupCallbacks() {
 //--Загрузка ресурсов
 void Application::loadResources() {
 
-    shader_ = new Shader("../Shaders/6.multiple_lights.vs", "../Shaders/6.multiple_lights.fs");
-
-    shader_->use();
-    shader_->setFloat("material.shininess", 32.0f);
-
-    //Глобальное освещение(Солнечное)
-    shader_->setVec3("dirLight.direction", -0.3f, -1.0f, 0.2f);
-    shader_->setVec3("dirLight.ambient", glm::vec3(0.3f));
-    shader_->setVec3("dirLight.diffuse", glm::vec3(0.8f));
-    shader_->setVec3("dirLight.specular", glm::vec3(0.5f));
-
-    //Локальное освещение (фонарик)
-    shader_->setVec3("spotLight.ambient", glm::vec3(0.0f));
-    shader_->setVec3("spotLight.diffuse", glm::vec3(1.0f));
-    shader_->setVec3("spotLight.specular", glm::vec3(1.0f));
-    shader_->setFloat("spotLight.constant", 1.0f);
-    shader_->setFloat("spotLight.linear", 0.09f);
-    shader_->setFloat("spotLight.quadratic", 0.032f);
-    shader_->setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-    shader_->setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
+    //Шейдеры (через кэш бинарников программ)
+    shaderCache_ = new ShaderCache("../cache/shaders");
+    double shaderTime = 0.0;
+    auto loadShader = [&](const char* vertexPath, const char* fragmentPath) {
+        double start = glfwGetTime();
+        Shader* shader = new Shader(vertexPath, fragmentPath, nullptr, shaderCache_);
+        shaderTime += glfwGetTime() - start;
+        return shader;
+    };
+
+    shader_ = loadShader("../Shaders/6.multiple_lights.vs", "../Shaders/6.multiple_lights.fs");
+    setupLighting(*shader_);
     
-    shaderFont = new Shader("../Shaders/text.vs", "../Shaders/text.fs");
+    shaderFont = loadShader("../Shaders/text.vs", "../Shaders/text.fs");
 
     mainFont = new Font("../resources/objects/Fonts/a_AlternaSw.TTF", 48);
 
@@ -223,31 +634,205 @@ void Application::loadResources() {
 
     Model hlM("../resources/objects/highlight/info.obj");
 
-    objects_.push_back(new Object("table", table, { 0.25,0.25,0.0 }, { 90.0f, 0.0f, 0.0f }, 0.479881f));
+    table_ = scene_.create(scene_.addMesh(table), { 0.25,0.25,0.0 }, { 90.0f, 0.0f, 0.0f }, 0.479881f,
+        EntityStore::NEUTRAL, EntityStore::VISIBLE | EntityStore::PICKABLE);
+    scene_.pickId[table_] = SCENE_PICK_BASE + table_;
+    scene_.updateTransforms();
+
+    //Клетки вписываются в игровое поле стола (8 клеток по 2.0), сколько бы их ни было у варианта
+    std::unique_ptr<GameRules> rules = makeRules(options_.variant);
+    float cellSize = 16.0f / rules->size();
+    float originXZ = -0.5f * cellSize * (rules->size() - 1);
+    std::cout << "Правила: " << rules->name() << " (" << rules->size() << "x" << rules->size() << ")\n";
     board = new CheckersBoard(
         white_checker, black_checker, hlM, mainFont, shaderFont,
-        glm::vec3(-7.0f, 0.1f, -7.0f), 
-        2.0f, 0.1f);
+        glm::vec3(originXZ, 0.1f, originXZ), 
+        cellSize, 0.1f, std::move(rules));
+
+    rebuildSceneBVH();
+    if (!options_.pdnLoad.empty()) loadReplay();
+    if (!options_.database.empty()) {
+        std::string error;
+        database_ = new GameDatabase();
+        if (database_->open(options_.database, error))
+            std::cout << "База: " << database_->games() << " партий, I - статистика позиции\n";
+        else {
+            std::cout << "База: " << error << "\n";
+            delete database_;
+            database_ = nullptr;
+        }
+    }
+
+    ponder_ = options_.ponder;
+    analysis_ = options_.analysis;
+    if (options_.clockBase > 0.0)
+        clock_.start(options_.clockBase, options_.clockIncrement, board->currentPlayer == CheckersBoard::Player::WHITE ? 0 : 1);
+    if ((!options_.engineSide.empty() || analysis_) && createEngine() && !options_.engineSide.empty()) {
+        engineWhite_ = options_.engineSide == "white" || options_.engineSide == "both";
+        engineBlack_ = options_.engineSide == "black" || options_.engineSide == "both";
+        std::cout << "Движок " << engine_->name() << " играет за " << options_.engineSide
+            << (ponder_ ? ", думает в ход соперника" : "") << "\n";
+    }
+
+    //Зрительский режим: много досок с общей геометрией
+    if (options_.spectatorBoards > 0 || options_.spectatorBench) {
+        shaderInstanced_ = loadShader("../Shaders/6.multiple_lights_instanced.vs", "../Shaders/6.multiple_lights.fs");
+        setupLighting(*shaderInstanced_);
+
+        // Лента зрителей транслирует партии 8x8, поэтому раскладка клеток своя, а не от варианта
+        spectator_ = new SpectatorScene(table, white_checker, black_checker,
+            scene_.world[table_], glm::vec3(-7.0f, 0.1f, -7.0f), 2.0f, board->height,
+            std::max(1, options_.spectatorBoards));
+
+        float extent = spectator_->gridExtent();
+        camera_.Position = glm::vec3(0.0f, extent * 1.2f + 20.0f, 0.0f);
+        farPlane_ = std::max(100.0f, extent * 4.0f);
+    }
+    clusters_ = new ClusteredLights();
+    setupLights(spectator_ ? spectator_->gridExtent() : 12.0f);
+    if ((options_.idPicking || options_.pickingBench) && !spectator_)
+        picker_ = new IdPicker(int(SCR_WIDTH), int(SCR_HEIGHT));
+
+    //Запись и воспроизведение ввода
+    std::string error;
+    if (!options_.replay.empty()) {
+        replay_ = new InputReplay();
+        if (!replay_->load(options_.replay, error)) {
+            std::cerr << "Воспроизведение: " << error << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+        std::cout << "Воспроизведение: " << replay_->size() << " событий, " << replay_->duration() << " с\n";
+    }
+    if (!options_.record.empty()) {
+        recorder_ = new InputRecorder();
+        if (recorder_->open(options_.record, int(SCR_WIDTH), int(SCR_HEIGHT), error)) recordStart_ = glfwGetTime();
+        else {
+            std::cout << "Запись ввода: " << error << "\n";
+            delete recorder_;
+            recorder_ = nullptr;
+        }
+    }
+
+    //Горячая перезагрузка: следим за исходниками шейдеров и каталогами моделей
+    if (options_.hotReload) {
+        hotReload_ = new HotReloader();
+        auto relight = [this](Shader& shader) { setupLighting(shader); };
+        hotReload_->watchShader(shader_, relight);
+        hotReload_->watchShader(shaderFont);
+        if (shaderInstanced_) hotReload_->watchShader(shaderInstanced_, relight);
+        for (const Model* model : { &table, &white_checker, &black_checker, &hlM })
+            hotReload_->watchModel(*model);
+        hotReload_->start();
+    }
+
+    std::cout << "Шейдеры: " << shaderCache_->hits << " из кэша, " << shaderCache_->misses << " собрано за "
+        << shaderTime * 1000.0 << " мс\n";
 } 
 
+//--Настройка освещения (общая для обычного и инстансного шейдера)
+void Application::setupLighting(Shader& shader) {
+    shader.use();
+    shader.setFloat("material.shininess", 32.0f);
+
+    //Глобальное освещение(Солнечное)
+    shader.setVec3("dirLight.direction", -0.3f, -1.0f, 0.2f);
+    shader.setVec3("dirLight.ambient", glm::vec3(0.3f));
+    shader.setVec3("dirLight.diffuse", glm::vec3(0.8f));
+    shader.setVec3("dirLight.specular", glm::vec3(0.5f));
+
+    //Локальное освещение (фонарик и лампы) — списки кластеров в текстурных буферах
+    ClusteredLights::bindUnits(shader);
+}
+
+//--Лампы сеткой над площадкой [-extent, extent]² на высоте 6, тёплые и холодные вперемешку
+static void placeLamps(std::vector<Light>& lights, int count, float extent) {
+    const int side = int(std::ceil(std::sqrt(double(count))));
+    for (int i = 0; i < count; ++i) {
+        Light lamp;
+        const float u = side > 1 ? float(i % side) / (side - 1) : 0.5f;
+        const float v = side > 1 ? float(i / side) / (side - 1) : 0.5f;
+        lamp.position = glm::vec3((u * 2.0f - 1.0f) * extent, 6.0f, (v * 2.0f - 1.0f) * extent);
+        lamp.range = 12.0f;
+        lamp.color = i % 2 ? glm::vec3(1.0f, 0.8f, 0.55f) : glm::vec3(0.6f, 0.75f, 1.0f);
+        lamp.linear = 0.14f;
+        lamp.quadratic = 0.07f;
+        lights.push_back(lamp);
+    }
+}
+
+//--Источники сцены: фонарик камеры (прежний прожектор) и options_.lamps ламп над столом или залом досок
+void Application::setupLights(float extent) {
+    Light flashlight;
+    flashlight.range = 40.0f;
+    flashlight.cutOff = glm::cos(glm::radians(12.5f));
+    flashlight.outerCutOff = glm::cos(glm::radians(15.0f));
+    lights_.assign(1, flashlight);
+    placeLamps(lights_, options_.lamps, extent);
+    std::cout << "Свет: " << lights_.size() << " источников, раскладка на " << clusters_->threads() << " потоках\n";
+}
+
+//--Фонарик следует за камерой; источники раскладываются по кластерам и выгружаются раз за кадр
+void Application::updateLights(Shader& shader) {
+    lights_[0].position = camera_.Position;
+    lights_[0].direction = camera_.Front;
+    const auto start = std::chrono::steady_clock::now();
+    clusters_->setProjection(projection_, nearPlane_, farPlane_, int(SCR_WIDTH), int(SCR_HEIGHT));
+    clusters_->build(lights_, view_);
+    lightBuildTime_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    clusters_->upload();
+    clusters_->apply(shader);
+}
+
 //--Передвижение камеры на WASD
 void Application::processInput() {
-    if (glfwGetKey(window_, GLFW_KEY_W) == GLFW_PRESS) camera_.ProcessKeyboard(FORWARD, deltaTime_);
-    if (glfwGetKey(window_, GLFW_KEY_S) == GLFW_PRESS) camera_.ProcessKeyboard(BACKWARD, deltaTime_);
-    if (glfwGetKey(window_, GLFW_KEY_A) == GLFW_PRESS) camera_.ProcessKeyboard(LEFT, deltaTime_);
-    if (glfwGetKey(window_, GLFW_KEY_D) == GLFW_PRESS) camera_.ProcessKeyboard(RIGHT, deltaTime_);
+    cameraKeys_ = false;
+    auto held = [this](int key) { return keysDown_[key]; };
+    if (held(GLFW_KEY_W)) { camera_.ProcessKeyboard(FORWARD, deltaTime_); cameraKeys_ = true; }
+    if (held(GLFW_KEY_S)) { camera_.ProcessKeyboard(BACKWARD, deltaTime_); cameraKeys_ = true; }
+    if (held(GLFW_KEY_A)) { camera_.ProcessKeyboard(LEFT, deltaTime_); cameraKeys_ = true; }
+    if (held(GLFW_KEY_D)) { camera_.ProcessKeyboard(RIGHT, deltaTime_); cameraKeys_ = true; }
+    if (cameraKeys_) redraw_ = true;
 }
 
 //--Обновление переменных на каждый кадр
 void Application::update() {
+    // Перезагруженная модель могла сменить размеры: коробки BVH сцены строятся заново из новых хит-боксов
+    if (hotReload_ && hotReload_->apply() > 0) {
+        redraw_ = true;
+        rebuildSceneBVH();
+    }
+
+    // Новый снимок игры: ввод обработан, анимация продвинулась, идут часы или поиск
+    if (snapshots_.update()) {
+        redraw_ = true;
+        const uint64_t total = snapshots_.front().simAllocations;
+        simAllocations_ = total - simAllocationsSeen_;
+        simAllocationPeak_ = std::max(simAllocationPeak_, simAllocations_);
+        simAllocationsSeen_ = total;
+    }
+
     view_ = camera_.GetViewMatrix();
-    projection_ = glm::perspective(glm::radians(camera_.Zoom), float(SCR_WIDTH) / SCR_HEIGHT, 0.1f, 100.0f);
+    projection_ = glm::perspective(glm::radians(camera_.Zoom), float(SCR_WIDTH) / SCR_HEIGHT, nearPlane_, farPlane_);
+
+    // В зрительском режиме каждая доска в среднем получает один ход в секунду
+    if (spectator_) {
+        feedAccumulator_ += deltaTime_ * spectator_->size();
+        int updates = int(feedAccumulator_);
+        feedAccumulator_ -= updates;
+        feed_.update(*spectator_, updates);
+    }
 }
 
 //--Основной рендер
 void Application::render() {
     glClearColor(0.5f, 0.55f, 0.5f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (picker_) picker_->begin(); // Сцена рисуется в буфер выбора: цвет и номера объектов
+    else glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    if (spectator_) {
+        renderSpectator();
+        return;
+    }
 
     shader_->use();
     shader_->setVec3("viewPos", camera_.Position);
@@ -256,14 +841,286 @@ void Application::render() {
     shader_->setMat4("view", view_);
     shader_->setMat4("projection", projection_);
 
-    shader_->setVec3("spotLight.position", camera_.Position);
-    shader_->setVec3("spotLight.direction", camera_.Front);
+    updateLights(*shader_);
+
+    scene_.updateTransforms();
+    scene_.render(*shader_);
+
+    const GameSnapshot& game = snapshots_.front();
+    board->render(game.board, *shader_);
+    if (picker_) picker_->end(); // Надписи — поверх, прямо в окно: номеров у них нет
+    if (game.panelShown) renderAnalysisPanel();
+    if (game.clockShown) renderClock();
+    if (showProfile_) renderProfile();
+}
 
-    for (auto object : objects_) {
-        object->model.Draw(*shader_);
+//--Часы в правом верхнем углу; у стороны, чей ход, — жёлтым
+void Application::renderClock() {
+    const glm::mat4 projection = glm::ortho(0.0f, float(SCR_WIDTH), 0.0f, float(SCR_HEIGHT));
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DEPTH_TEST);
+    const GameSnapshot& game = snapshots_.front();
+    for (int side = 0; side < 2; ++side) {
+        const bool active = game.clockActive == side;
+        mainFont->RenderText(game.clock[side], SCR_WIDTH - 300.0f, SCR_HEIGHT - 40.0f - 35.0f * side, 0.5f,
+            active ? glm::vec3(1.0f, 1.0f, 0.0f) : glm::vec3(1.0f), projection, *shaderFont);
     }
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+}
 
-    board->render(*shader_);
+//--Профиль: выделения памяти кадра и такта симуляции, ритм кадров, задержка ввода, пулы доски
+void Application::renderProfile() {
+    const GameSnapshot& game = snapshots_.front();
+    const FrameStats::Summary pacing = frameStats_.pacing(), latency = frameStats_.latency();
+    char lines[6][192];
+    std::snprintf(lines[0], sizeof(lines[0]), "Выделений за кадр: %llu, пик %llu, кадров с выделениями %llu из %llu",
+        (unsigned long long)frameAllocations_, (unsigned long long)allocationPeak_,
+        (unsigned long long)allocatingFrames_, (unsigned long long)profiledFrames_);
+    std::snprintf(lines[1], sizeof(lines[1]), "Симуляция: такт %.2f мс, выделений %llu, пик %llu",
+        game.simStep * 1000.0, (unsigned long long)simAllocations_, (unsigned long long)simAllocationPeak_);
+    std::snprintf(lines[2], sizeof(lines[2]), "Кадр %.1f мс (99%% %.1f, разброс %.2f), ввод до кадра %.1f мс (худшая %.1f)",
+        pacing.mean * 1000.0, pacing.p99 * 1000.0, pacing.jitter * 1000.0, latency.mean * 1000.0, latency.worst * 1000.0);
+    std::snprintf(lines[3], sizeof(lines[3]), "Сущности доски: шашки %zu/%zu, подсветка %zu/%zu", game.checkersInUse,
+        game.checkerCapacity, game.highlightsInUse, game.highlightCapacity);
+    std::snprintf(lines[4], sizeof(lines[4]), "Свет: %d источников, %zu ссылок в кластерах, в кластере до %d, раскладка %.2f мс",
+        clusters_->lightCount(), clusters_->references(), clusters_->busiestCluster(), lightBuildTime_ * 1000.0);
+    std::snprintf(lines[5], sizeof(lines[5]), "Выбор: луч %.1f мкс, буфер номеров %.1f мс (%.1f кадра), совпало %llu из %llu",
+        rayPicks_ ? rayPickTime_ / rayPicks_ * 1e6 : 0.0, picks_ ? pickLatency_ / picks_ * 1000.0 : 0.0,
+        picks_ ? pickFrames_ / picks_ : 0.0, (unsigned long long)pickAgreements_, (unsigned long long)picks_);
+    const int lineCount = picker_ ? 6 : 5;
+
+    const glm::mat4 projection = glm::ortho(0.0f, float(SCR_WIDTH), 0.0f, float(SCR_HEIGHT));
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DEPTH_TEST);
+    const bool allocating = frameAllocations_ > 0 || simAllocations_ > 0;
+    const glm::vec3 color = allocating ? glm::vec3(1.0f, 0.5f, 0.4f) : glm::vec3(0.7f, 1.0f, 0.7f);
+    for (int i = 0; i < lineCount; ++i)
+        mainFont->RenderText(lines[i], 20.0f, 20.0f + 30.0f * (lineCount - 1 - i), 0.4f, i < 2 ? color : glm::vec3(0.9f), projection, *shaderFont);
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+}
+
+//--Панель поиска: что считает движок, глубина, оценка и главная линия (строки собраны в снимке)
+void Application::renderAnalysisPanel() {
+    const GameSnapshot& game = snapshots_.front();
+    const glm::mat4 projection = glm::ortho(0.0f, float(SCR_WIDTH), 0.0f, float(SCR_HEIGHT));
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DEPTH_TEST);
+    mainFont->RenderText(game.panelStats, 20.0f, SCR_HEIGHT - 40.0f, 0.45f, { 1.0f, 1.0f, 1.0f }, projection, *shaderFont);
+    mainFont->RenderText(game.panelLine, 20.0f, SCR_HEIGHT - 75.0f, 0.4f, { 0.9f, 0.9f, 0.6f }, projection, *shaderFont);
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+}
+
+//--Рендер зрительского режима (все доски инстансингом)
+void Application::renderSpectator() {
+    shaderInstanced_->use();
+    shaderInstanced_->setVec3("viewPos", camera_.Position);
+    shaderInstanced_->setMat4("view", view_);
+    shaderInstanced_->setMat4("projection", projection_);
+    updateLights(*shaderInstanced_);
+
+    spectator_->render(*shaderInstanced_, projection_ * view_, float(glfwGetTime()));
+}
+
+//--Стресс-тест зрительского режима: время кадра в зависимости от числа досок
+int Application::runSpectatorBenchmark() {
+    using Clock = std::chrono::steady_clock;
+    const int counts[] = { 1, 16, 64, 100, 144, 256, 400, 625 };
+    const int warmupFrames = 30, measuredFrames = 300;
+
+    glfwSwapInterval(0); // Без вертикальной синхронизации, иначе время кадра упрётся в частоту монитора
+    std::cout << "boards\tview\tvisible\tavg ms\tp95 ms\tfps\n";
+
+    for (int n : counts) {
+        spectator_->resize(n);
+        float extent = spectator_->gridExtent();
+
+        // Обзор всей сетки сверху и близкий вид, где большая часть досок отсекается
+        const struct { const char* name; float height; } views[] = {
+            { "full", extent * 2.5f + 20.0f },
+            { "close", 40.0f }
+        };
+        for (const auto& v : views) {
+            camera_.Position = glm::vec3(0.0f, v.height, 0.0f);
+            farPlane_ = std::max(100.0f, v.height * 2.0f);
+
+            std::vector<double> times;
+            times.reserve(measuredFrames);
+            for (int frame = 0; frame < warmupFrames + measuredFrames; ++frame) {
+                auto start = Clock::now();
+
+                deltaTime_ = 1.0 / 60.0;
+                update();
+                render();
+                glfwSwapBuffers(window_);
+                glfwPollEvents();
+                glFinish(); // Учитываем время GPU, а не только постановку команд
+
+                if (frame >= warmupFrames)
+                    times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+                if (glfwWindowShouldClose(window_)) return 0;
+            }
+
+            std::sort(times.begin(), times.end());
+            double avg = 0.0;
+            for (double t : times) avg += t;
+            avg /= times.size();
+            double p95 = times[size_t(times.size() * 0.95)];
+
+            std::cout << n << "\t" << v.name << "\t" << spectator_->visibleBoards() << "\t"
+                << avg << "\t" << p95 << "\t" << 1000.0 / avg << "\n";
+        }
+    }
+    return 0;
+}
+
+//--Замер выбора: кадр без буфера номеров и с ним, стоимость луча на CPU, задержка ответа буфера
+//  (мс и кадры) и совпадение с лучом. Каждый кадр — щелчок в центр случайного поля доски
+int Application::runPickingBenchmark() {
+    using Clock = std::chrono::steady_clock;
+    const int warmupFrames = 30, measuredFrames = 600;
+    const int ANSWERS = 8;                   // Кольцо ответов луча по номеру кадра щелчка
+
+    glfwSwapInterval(0);
+    startSimulation();
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> cell(0, board->size() - 1);
+    IdPicker* picker = picker_;
+    std::cout << "mode\tframe ms\tray us\tid ms\tid frames\tagree %\n";
+
+    for (int pass = 0; pass < 2; ++pass) {
+        picker_ = pass == 1 ? picker : nullptr;
+        double frameTime = 0.0, rayTime = 0.0, latency = 0.0, frames = 0.0;
+        int rays = 0, answers = 0, agreed = 0;
+        uint32_t expected[ANSWERS] = {};
+        for (int frame = 0; frame < warmupFrames + measuredFrames; ++frame) {
+            const bool measured = frame >= warmupFrames;
+            const auto start = Clock::now();
+            deltaTime_ = 1.0 / 60.0;
+            update();
+
+            // Центр поля на экране (y сверху, как у курсора)
+            const glm::vec4 clip = projection_ * view_ * glm::vec4(board->cellPosition(cell(rng), cell(rng)), 1.0f);
+            const double x = (clip.x / clip.w * 0.5 + 0.5) * SCR_WIDTH;
+            const double y = (0.5 - clip.y / clip.w * 0.5) * SCR_HEIGHT;
+            const auto rayStart = Clock::now();
+            const uint32_t answer = rayPick(x, y, false);
+            if (measured) {
+                rayTime += std::chrono::duration<double, std::micro>(Clock::now() - rayStart).count();
+                rays++;
+            }
+            if (picker_) {
+                expected[frame % ANSWERS] = answer;
+                pickInverseViewProjection_ = glm::inverse(projection_ * view_);
+                picker_->request(int(x), int(SCR_HEIGHT) - 1 - int(y), glfwGetTime(), uint32_t(frame));
+            }
+
+            render();
+            glfwSwapBuffers(window_);
+            IdPicker::Result result;
+            while (picker_ && picker_->poll(result)) {
+                if (int(result.tag) < warmupFrames) continue;
+                answers++;
+                latency += (glfwGetTime() - result.requested) * 1000.0;
+                frames += result.frames;
+                agreed += resolvePick(result, false) == expected[result.tag % ANSWERS];
+            }
+            glfwPollEvents();
+            glFinish(); // Учитываем время GPU, а не только постановку команд
+
+            if (measured) frameTime += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            if (glfwWindowShouldClose(window_)) return 0;
+        }
+        std::cout << (pass == 1 ? "id" : "ray") << "\t" << frameTime / measuredFrames << "\t" << rayTime / rays;
+        if (answers > 0)
+            std::cout << "\t" << latency / answers << "\t" << frames / answers << "\t" << 100.0 * agreed / answers;
+        std::cout << "\n";
+    }
+    picker_ = picker;
+    return 0;
+}
+
+//--Прогон записанного сеанса. Виртуальное время идёт шагом 1/replayFps на кадр, события подаются в тот
+//  кадр, где наступило их время, а такт симуляции идёт в этом же потоке со временем кадра: на любой
+//  машине прогон проходит те же состояния. Меряется настоящее время кадра (с glFinish) — его ряды
+//  и сравниваются между сборками
+int Application::runReplay() {
+    using Clock = std::chrono::steady_clock;
+    const double step = 1.0 / options_.replayFps;
+    const double tail = 1.0; // После последнего события — секунда на анимации
+
+    glfwSwapInterval(0); // Без вертикальной синхронизации, иначе время кадра упрётся в частоту монитора
+    glfwSetWindowSize(window_, replay_->width(), replay_->height());
+    onFramebufferSize(replay_->width(), replay_->height());
+    board->setTime(0.0f);
+    publishSnapshot(glfwGetTime());
+
+    std::vector<double> times;
+    times.reserve(size_t((replay_->duration() + tail) / step) + 1);
+    for (int frame = 0; !glfwWindowShouldClose(window_); ++frame) {
+        const double now = frame * step;
+        if (replay_->done() && now > replay_->duration() + tail) break;
+        const auto start = Clock::now();
+
+        deltaTime_ = step;
+        replay_->dispatchUntil(now, [this](const RecordedInput& event) { replayEvent(event); });
+        simulationStep(now);
+        processInput();
+        update();
+        if (picker_) pollPicks();
+        render();
+        glfwSwapBuffers(window_);
+        glfwPollEvents();
+        glFinish(); // Учитываем время GPU, а не только постановку команд
+
+        times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    if (times.empty()) return 0;
+
+    if (!options_.replayTrace.empty()) {
+        std::ofstream trace(options_.replayTrace);
+        trace << "frame,time,ms\n";
+        for (size_t i = 0; i < times.size(); ++i) trace << i << "," << i * step << "," << times[i] << "\n";
+        if (!trace) std::cout << "Ошибка записи " << options_.replayTrace << "\n";
+    }
+    std::vector<double> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    double avg = 0.0;
+    for (double t : sorted) avg += t;
+    avg /= sorted.size();
+    std::cout << "Прогон: " << sorted.size() << " кадров, " << avg << " мс в среднем, медиана "
+        << sorted[sorted.size() / 2] << " мс, 99% за " << sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)]
+        << " мс, худший " << sorted.back() << " мс\n";
+    return 0;
+}
+
+//--Событие живого ввода — в запись (время от её начала)
+void Application::record(RecordedInput event) {
+    if (!recorder_) return;
+    event.time = glfwGetTime() - recordStart_;
+    recorder_->add(event);
+}
+
+//--Событие записи — в тот же обработчик, что и живое
+void Application::replayEvent(const RecordedInput& event) {
+    switch (event.kind) {
+    case RecordedInput::CURSOR: onCursorMove(event.x, event.y); break;
+    case RecordedInput::SCROLL: onScroll(event.y); break;
+    case RecordedInput::KEY: onKey(event.a, 0, event.b, event.c); break;
+    case RecordedInput::BUTTON:
+        replayCursor_ = { event.x, event.y };
+        onMouseButton(event.a, event.b);
+        break;
+    case RecordedInput::RESIZE:
+        glfwSetWindowSize(window_, event.a, event.b);
+        onFramebufferSize(event.a, event.b);
+        break;
+    }
 }
 
 //==================================================================================================
@@ -273,6 +1130,8 @@ void Application::onFramebufferSize(int w, int h) {
     SCR_WIDTH = w;
     SCR_HEIGHT = h;
     glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    if (picker_ && w > 0 && h > 0) picker_->resize(w, h);
+    redraw_ = true;
 }
 
 //--CALLBACK-- Изменение положения курсора
@@ -286,15 +1145,19 @@ void Application::onCursorMove(double xpos, double ypos) {
     float dy = lastY_ - float(ypos);
     lastX_ = float(xpos); lastY_ = float(ypos);
     camera_.ProcessMouseMovement(dx, dy);
+    redraw_ = true;
 }
 
 //--CALLBACK-- Скроллинг
 void Application::onScroll(double yoffset) {
     camera_.ProcessMouseScroll(float(yoffset));
+    redraw_ = true;
 }
 
 //--CALLBACK-- Нажатие на клавиши клавиатуры
 void Application::onKey(int key, int, int action, int) {
+    redraw_ = true; // Клавиши меняют доску, камеру или выделенный объект
+    if (key >= 0 && key <= GLFW_KEY_LAST) keysDown_[key] = action != GLFW_RELEASE;
     if (action == GLFW_PRESS)
     {
         switch (key) {
@@ -304,7 +1167,7 @@ void Application::onKey(int key, int, int action, int) {
 
             case GLFW_KEY_ESCAPE: // Escape
                 if (modelSelected_) {
-                    modelSelected_ = false; selectedObject_ = nullptr;
+                    modelSelected_ = false; selectedObject_ = NO_ENTITY;
                 }
                 else
                     glfwSetWindowShouldClose(window_, true);
@@ -318,42 +1181,57 @@ void Application::onKey(int key, int, int action, int) {
                 printSelected();
                 break;
 
-            case GLFW_KEY_R:
-                board->resetGame();
+            case GLFW_KEY_R: case GLFW_KEY_N: case GLFW_KEY_Z: case GLFW_KEY_Y:
+            case GLFW_KEY_F2: case GLFW_KEY_F3: case GLFW_KEY_F5: case GLFW_KEY_I:
+                queueInput(InputEvent::KEY, key, 0); // Партия и движок — в потоке симуляции
+                break;
+            case GLFW_KEY_F4: // Профиль: выделения памяти, ритм кадров, задержка ввода, пулы
+                showProfile_ = !showProfile_;
+                allocationPeak_ = allocatingFrames_ = profiledFrames_ = simAllocationPeak_ = 0;
+                frameStats_.reset();
                 break;
             case GLFW_KEY_P:
                 editMode = !editMode;
                 std::cout << "Режим переключен на "<<(editMode ? "Редактирования":"Игры") <<"\n";
                 break;
 
+            case GLFW_KEY_T: // Точный выбор по треугольникам меша
+                refinePicking_ = !refinePicking_;
+                std::cout << "Точный выбор " << (refinePicking_ ? "включен" : "выключен") << "\n";
+                break;
+
             case GLFW_KEY_EQUAL: // Увеличение
-                if (selectedObject_)
-                    selectedObject_->scaleModel(1.025f);
+                if (selectedObject_ != NO_ENTITY) {
+                    scene_.rescale(selectedObject_, 1.025f);
+                    objectMoved(selectedObject_);
+                }
                 break;
 
             case GLFW_KEY_MINUS: // Уменьшение
-                if (selectedObject_)
-                    selectedObject_->scaleModel(0.975f);
+                if (selectedObject_ != NO_ENTITY) {
+                    scene_.rescale(selectedObject_, 0.975f);
+                    objectMoved(selectedObject_);
+                }
                 break;
 
             case GLFW_KEY_Q: // Вращение по оси Y
-                if (selectedObject_)
-                    selectedObject_->rotateModel(glm::vec3(0, 5.0f, 0));
+                if (selectedObject_ != NO_ENTITY)
+                    scene_.rotate(selectedObject_, glm::vec3(0, 5.0f, 0));
                 break;
 
             case GLFW_KEY_E:
-                if (selectedObject_)
-                    selectedObject_->rotateModel(glm::vec3(0, -5.0f, 0));
+                if (selectedObject_ != NO_ENTITY)
+                    scene_.rotate(selectedObject_, glm::vec3(0, -5.0f, 0));
                 break;
 
             case GLFW_KEY_U: // Вращение по оси X
-                if (selectedObject_)
-                    selectedObject_->rotateModel(glm::vec3(5.0f, 0, 0));
+                if (selectedObject_ != NO_ENTITY)
+                    scene_.rotate(selectedObject_, glm::vec3(5.0f, 0, 0));
                 break;
 
             case GLFW_KEY_O:
-                if (selectedObject_)
-                    selectedObject_->rotateModel(glm::vec3(5.0f, 0, 0));
+                if (selectedObject_ != NO_ENTITY)
+                    scene_.rotate(selectedObject_, glm::vec3(5.0f, 0, 0));
                 break;
         }
     }
@@ -367,27 +1245,123 @@ void Application::onKey(int key, int, int action, int) {
     }
 }
 
+//--Поток симуляции: событие ввода из очереди
+void Application::handleInput(const InputEvent& event) {
+    inputSeq_++;
+    lastInputTime_ = event.time;
+    if (event.kind == InputEvent::CLICK) {
+        if (!isEngineTurn()) board->onCellClick(event.a, event.b); // В ход компьютера щелчки не принимаются
+        return;
+    }
+    switch (event.a) {
+    case GLFW_KEY_R:
+        board->resetGame();
+        break;
+    case GLFW_KEY_N: // Следующий ход загруженной партии
+        playReplayMove();
+        break;
+    case GLFW_KEY_Z: // Отмена хода; против компьютера — до своего хода
+        if (board->undoMove() && engine_) {
+            bool white = board->currentPlayer == CheckersBoard::Player::WHITE;
+            if (white ? engineWhite_ : engineBlack_) board->undoMove();
+        }
+        break;
+    case GLFW_KEY_Y: // Повтор отменённого хода
+        board->redoMove();
+        break;
+    case GLFW_KEY_F5: // Сохранение партии в PDN
+        saveGame();
+        break;
+    case GLFW_KEY_F2: // Бесконечный анализ позиции
+        if (createEngine()) {
+            analysis_ = !analysis_;
+            std::cout << "Анализ " << (analysis_ ? "включен" : "выключен") << "\n";
+        }
+        break;
+    case GLFW_KEY_F3: // Обдумывание в ход соперника
+        if (search_ && search_->mode() == BackgroundSearch::Mode::PONDER) search_->reset();
+        ponder_ = !ponder_;
+        std::cout << "Обдумывание в ход соперника " << (ponder_ ? "включено" : "выключено") << "\n";
+        break;
+    case GLFW_KEY_I: // Статистика позиции по базе партий
+        if (database_) {
+            GameRules::Cells cells;
+            bool whiteToMove;
+            board->getPosition(cells, whiteToMove);
+            reportPosition(*database_, cells, whiteToMove, std::cout);
+        }
+        break;
+    }
+}
+
 //--CALLBACK-- Нажатие кнопок мыши
 void Application::onMouseButton(int button, int action) {
+    if (spectator_) return; // В зрительском режиме игровой доски на сцене нет
+    redraw_ = true;
     if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && !cursorLocked_) {
-        double x, y; glfwGetCursorPos(window_, &x, &y);
-        int row, col;
-        if (editMode) {
-            Ray click = generateRay(x, y);
-            for (auto model : objects_) {
-                float t;
-                if (testIntersection(click, model->model.checkBox, t)) {
-                    modelSelected_ = true;
-                    selectedObject_ = model;
-                    std::cout << "Модель выбрана \n";
-                    break;
-                }
-            }
-        }
-        else {
-            if (screenToBoardCoords(x, y, row, col))
-                board->onCellClick(row, col);
+        double x, y; cursorPosition(x, y);
+        const auto start = std::chrono::steady_clock::now();
+        rayAnswer_ = rayPick(x, y, editMode);
+        rayPickTime_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        rayPicks_++;
+        if (!picker_) {
+            applyPick(rayAnswer_, editMode, glfwGetTime());
+            return;
         }
+        // Пиксель прочитается в конце ближайшего кадра, ответ применит pollPicks
+        pickInverseViewProjection_ = glm::inverse(projection_ * view_);
+        picker_->request(int(x), int(SCR_HEIGHT) - 1 - int(y), glfwGetTime(), editMode ? PICK_EDIT : PICK_BOARD);
+    }
+}
+
+//--Выбор лучом на CPU в номерах буфера выбора: в режиме редактирования — объект сцены, иначе поле доски
+uint32_t Application::rayPick(double x, double y, bool edit) {
+    if (edit) {
+        const Entity hit = pickObject(generateRay(int(x), int(y)));
+        return hit == NO_ENTITY ? IdPicker::NONE : SCENE_PICK_BASE + hit;
+    }
+    int row, col;
+    return screenToBoardCoords(x, y, row, col) ? CheckersBoard::cellPickId(row, col) : IdPicker::NONE;
+}
+
+//--Ответ буфера номеров в тех же номерах. Шашки и подсветка пишут номер своего поля; под курсором
+//  пустое поле (стол) — точка восстанавливается по глубине пикселя и камере щелчка
+uint32_t Application::resolvePick(const IdPicker::Result& result, bool edit) const {
+    if (edit) return result.id >= SCENE_PICK_BASE ? result.id : IdPicker::NONE;
+    int row, col;
+    if (CheckersBoard::pickedCell(result.id, row, col)) return result.id;
+    if (result.depth >= 1.0f) return IdPicker::NONE;
+    const glm::vec4 ndc((result.x + 0.5f) / SCR_WIDTH * 2.0f - 1.0f, (result.y + 0.5f) / SCR_HEIGHT * 2.0f - 1.0f,
+        result.depth * 2.0f - 1.0f, 1.0f);
+    const glm::vec4 p = pickInverseViewProjection_ * ndc;
+    return boardCellAt(glm::vec3(p) / p.w, row, col) ? CheckersBoard::cellPickId(row, col) : IdPicker::NONE;
+}
+
+//--Щелчок по найденному: выбор объекта сцены или ход на поле (time — момент самого щелчка)
+void Application::applyPick(uint32_t id, bool edit, double time) {
+    int row, col;
+    if (edit) {
+        if (id < SCENE_PICK_BASE) return;
+        modelSelected_ = true;
+        selectedObject_ = Entity(id - SCENE_PICK_BASE);
+        std::cout << "Модель выбрана \n";
+    }
+    else if (CheckersBoard::pickedCell(id, row, col))
+        queueInput(InputEvent::CLICK, row, col, time); // Такт симуляции сразу отменит и анализ старой позиции
+}
+
+//--Готовые ответы буфера номеров: применяются и идут в статистику сравнения с лучом
+void Application::pollPicks() {
+    IdPicker::Result result;
+    while (picker_->poll(result)) {
+        const bool edit = result.tag == PICK_EDIT;
+        const uint32_t id = resolvePick(result, edit);
+        picks_++;
+        pickLatency_ += glfwGetTime() - result.requested;
+        pickFrames_ += result.frames;
+        pickAgreements_ += id == rayAnswer_;
+        applyPick(id, edit, result.requested);
+        redraw_ = true;
     }
 }
 
@@ -407,13 +1381,9 @@ Ray Application::generateRay(int mouseX, int mouseY) const {
 //--Обработка пересечений Хитбокса(цилиндр) с лучём
 bool Application::testIntersection(const Ray& ray, const HitBox& box, float& t) const {
 
-    glm::mat4 invModel = glm::translate(glm::mat4(1.0f), -box.position);
-
-    //invModel = glm::scale(invModel, 1.0f / selectedObject_->model.scale); // Учет масштаба
-
-    glm::vec3 o = invModel * glm::vec4(ray.origin, 1.0f);
-
-    glm::vec3 d = invModel * glm::vec4(ray.direction, 0.0f);
+    // Цилиндр только смещён, поэтому луч переводим в его систему простым вычитанием
+    glm::vec3 o = ray.origin - box.position;
+    glm::vec3 d = ray.direction;
 
     float a = d.x * d.x + d.z * d.z;
     float b = 2.0f * (o.x * d.x + o.z * d.z);
@@ -435,6 +1405,54 @@ bool Application::testIntersection(const Ray& ray, const HitBox& box, float& t)
     return hit;
 }
 
+//--Ближайший объект под лучом: обход BVH, цилиндр и (по желанию) треугольники меша
+Entity Application::pickObject(const Ray& ray) {
+    if (sceneBVHStale_) {
+        sceneBVH_.refit(objectBounds_);
+        sceneBVHStale_ = false;
+    }
+
+    float tHit = FLT_MAX;
+    int index = -1;
+    sceneBVH_.raycast(ray, tHit, index, [this](int i, const Ray& r, float tMax, float& t) {
+        const Entity object = pickIds_[i];
+        // Цилиндр стоит вертикально: у повёрнутой сущности грубой проверкой служит её коробка из BVH
+        if (scene_.rotated(object)) {
+            const glm::vec3 invDir(1.0f / r.direction.x, 1.0f / r.direction.y, 1.0f / r.direction.z);
+            if (!objectBounds_[i].intersect(r.origin, invDir, tMax, t)) return false;
+        }
+        else if (!testIntersection(r, scene_.hitBox(object), t) || t >= tMax) return false;
+        if (!refinePicking_) return true;
+        t = tMax;
+        return scene_.raycastMesh(object, r, t);
+        });
+    return index >= 0 ? pickIds_[index] : NO_ENTITY;
+}
+
+//--Полная перестройка BVH сцены (после добавления/удаления объектов)
+void Application::rebuildSceneBVH() {
+    scene_.pickBounds(objectBounds_, pickIds_);
+    sceneBVH_.build(objectBounds_);
+    sceneBVHStale_ = false;
+}
+
+//--Объект сдвинулся: обновляем его коробку, дерево перестраивается лениво при следующем выборе
+void Application::objectMoved(Entity object) {
+    auto it = std::find(pickIds_.begin(), pickIds_.end(), object);
+    if (it == pickIds_.end()) return;
+    objectBounds_[it - pickIds_.begin()] = scene_.bounds(object);
+    sceneBVHStale_ = true;
+}
+
+//--Курсор для щелчка: живой или из записи
+void Application::cursorPosition(double& x, double& y) const {
+    if (replay_) {
+        x = replayCursor_.x;
+        y = replayCursor_.y;
+    }
+    else glfwGetCursorPos(window_, &x, &y);
+}
+
 //--Блокировка/Разблокировка курсора--
 void Application::toggleCursorLock() {
     cursorLocked_ = !cursorLocked_;
@@ -457,8 +1475,11 @@ bool Application::screenToBoardCoords(double mx, double my, int& outR, int& outC
     if (t < 0) return false;
 
     // 2. Вычисление точки пересечения
-    glm::vec3 p = ray.origin + ray.direction * t;
+    return boardCellAt(ray.origin + ray.direction * t, outR, outC);
+}
 
+//--Поле доски под точкой мира (высота точки не важна)
+bool Application::boardCellAt(const glm::vec3& p, int& outR, int& outC) const {
     // 3. Коррекция координат с учетом центра клетки
     float localX = p.x - board->origin.x;
     float localZ = p.z - board->origin.z;
@@ -468,7 +1489,7 @@ bool Application::screenToBoardCoords(double mx, double my, int& outR, int& outC
     outR = static_cast<int>((localZ + board->cellSize * 0.5f) / board->cellSize);
 
     // 5. Проверка границ доски
-    return (outR >= 0 && outR < CheckersBoard::SIZE && outC >= 0 && outC < CheckersBoard::SIZE);
+    return (outR >= 0 && outR < board->size() && outC >= 0 && outC < board->size());
 }
 
 //--Движение выбранной фигуры
@@ -485,19 +1506,984 @@ void Application::moveSelected(int key) {
     case GLFW_KEY_LEFT_CONTROL: d.y = -speed; break;
     default: return;
     }
-    selectedObject_->move(d);
+    scene_.move(selectedObject_, d);
+    objectMoved(selectedObject_);
+}
+
+//--Загрузка партии options_.pdnGame из файла options_.pdnLoad
+void Application::loadReplay() {
+    MappedFile file;
+    if (!file.open(options_.pdnLoad)) {
+        std::cout << "PDN: не удалось открыть " << options_.pdnLoad << "\n";
+        return;
+    }
+    PdnReader reader(file.view());
+    PdnGame game;
+    for (int i = 0; i < options_.pdnGame; ++i) {
+        if (!reader.next(game)) {
+            std::cout << "PDN: в файле нет партии " << options_.pdnGame << "\n";
+            return;
+        }
+    }
+
+    std::string error;
+    replayNext_ = 0;
+    if (!board->loadPdn(game, replayMoves_, error)) {
+        replayMoves_.clear();
+        std::cout << "PDN: партия " << options_.pdnGame << " (строка " << game.line << "): " << error << "\n";
+        return;
+    }
+    std::cout << "PDN: загружено ходов " << replayMoves_.size() << ", N - следующий ход\n";
+}
+
+void Application::playReplayMove() {
+    if (replayNext_ >= replayMoves_.size()) {
+        std::cout << "PDN: партия закончилась\n";
+        return;
+    }
+    // Ход не встанет, если доску успели изменить вручную
+    if (board->playMove(replayMoves_[replayNext_])) replayNext_++;
+    else std::cout << "PDN: ход " << replayNext_ + 1 << " недопустим в текущей позиции\n";
+}
+
+//--Движок для игры и анализа (один на приложение) и его фоновый поиск. false — движка нет
+bool Application::createEngine() {
+    if (engine_) return true;
+    if (options_.engineKind == "nnue") {
+        network_ = new NnueNetwork();
+        loadNetwork(options_.nnue, options_.variant, *network_);
+    }
+    EngineSetup setup;
+    setup.network = network_;
+    setup.mcts = options_.mcts;
+    engine_ = makeEngine(options_.variant, options_.engineKind, setup);
+    if (!engine_) {
+        std::cout << "Неизвестный движок: " << options_.engineKind << "\n";
+        return false;
+    }
+    engine_->limits = options_.engineLimits;
+    if (!options_.book.empty()) {
+        std::string error;
+        book_ = new OpeningBook();
+        if (book_->open(options_.book, error)) engine_->book = book_;
+        else std::cout << "Книга: " << error << "\n";
+    }
+    search_ = new BackgroundSearch(*engine_);
+    search_->onWake = [this] { wakeSimulation(); };
+    return true;
+}
+
+bool Application::isEngineTurn() const {
+    if (!engine_ || board->gameState != CheckersBoard::PLAYING) return false;
+    return board->currentPlayer == CheckersBoard::Player::WHITE ? engineWhite_ : engineBlack_;
+}
+
+//--Фоновый поиск под текущую позицию: поиск устаревшей позиции отменяется, нужный — запускается.
+//  Кадр не ждёт поиска, только забирает итог законченного
+void Application::updateSearch() {
+    GameRules::Cells cells;
+    bool whiteToMove;
+    board->getPosition(cells, whiteToMove);
+    const bool engineTurn = isEngineTurn();
+
+    switch (search_->mode()) {
+    case BackgroundSearch::Mode::MOVE:
+        if (!engineTurn || !search_->isSearching(cells, whiteToMove)) {
+            search_->reset(); // Позицию сменили (отмена хода, новая партия) или партия кончилась по времени
+            break;
+        }
+        // Обдумывание шло без ограничений, после попадания время и глубина — как у обычного хода
+        search_->progress(searchReport_);
+        if (ponderHit_ && ((moveLimits_.seconds > 0.0 && search_->elapsed() >= moveLimits_.seconds)
+            || (moveLimits_.softSeconds > 0.0 && search_->elapsed() >= moveLimits_.softSeconds)
+            || searchReport_.depth >= moveLimits_.depth)) search_->cancel();
+        if (search_->finished() && !board->isAnimating()) playSearchMove();
+        return;
+    case BackgroundSearch::Mode::PONDER:
+        if (search_->isSearching(cells, whiteToMove)) {
+            search_->ponderHit(); // Соперник сыграл ожидаемый ход
+            ponderHit_ = true;
+            moveLimits_ = engineMoveLimits();
+            return;
+        }
+        if (std::memcmp(cells, ponderFrom_, sizeof(cells)) == 0 && !engineTurn) return; // Соперник ещё думает
+        search_->reset();
+        break;
+    case BackgroundSearch::Mode::ANALYSIS:
+        if (analysis_ && !engineTurn && search_->isSearching(cells, whiteToMove)) return;
+        search_->reset();
+        break;
+    case BackgroundSearch::Mode::IDLE:
+        break;
+    }
+
+    if (engineTurn) {
+        ponderHit_ = false;
+        moveLimits_ = engineMoveLimits();
+        search_->start(BackgroundSearch::Mode::MOVE, cells, whiteToMove, moveLimits_);
+    }
+    else if (analysis_)
+        search_->start(BackgroundSearch::Mode::ANALYSIS, cells, whiteToMove, BackgroundSearch::UNLIMITED);
+}
+
+//--Пределы хода компьютера: с часами — от остатка времени, иначе из параметров запуска
+Engine::Limits Application::engineMoveLimits() const {
+    if (!clock_.isRunning()) return options_.engineLimits;
+    const TimeManager::Budget budget = timeManager_.allocate(clock_.remaining(clock_.sideToMove()),
+        clock_.increment(), int(board->movesPlayed()));
+    return { BackgroundSearch::UNLIMITED.depth, budget.hard, budget.soft };
+}
+
+//--Часы идут за доской: ход переключает их, отмена и повтор — только передают ход,
+//  новая партия запускает заново. Просрочка — поражение
+void Application::updateClock() {
+    const size_t played = board->movesPlayed();
+    const int side = board->currentPlayer == CheckersBoard::Player::WHITE ? 0 : 1;
+    if (board->gameState != CheckersBoard::PLAYING) {
+        if (clock_.isRunning()) clock_.stop();
+        clockPlies_ = played;
+        return;
+    }
+    if (!clock_.isRunning() || (played == 0 && clockPlies_ != 0)) clock_.start(options_.clockBase, options_.clockIncrement, side);
+    else if (played == clockPlies_ + 1) clock_.press();
+    else if (played != clockPlies_) clock_.setSideToMove(side);
+    clockPlies_ = played;
+
+    if (clock_.flagged(side)) {
+        board->loseOnTime();
+        clock_.stop();
+    }
+}
+
+//--Ход компьютера по итогам фонового поиска; с обдумыванием — сразу поиск ответа на ожидаемый ход соперника
+void Application::playSearchMove() {
+    GameRules::PathMove move;
+    Engine::Report report;
+    if (!search_->finish(move, report)) return;
+    if (report.fromBook) std::cout << "Компьютер: ход из книги\n";
+    else std::cout << "Компьютер: оценка " << report.score << ", глубина " << report.depth << ", узлов " << report.nodes
+        << (ponderHit_ ? " (обдумано заранее)" : "") << "\n";
+    if (!board->playMove(move)) return;
+
+    if (ponder_ && report.line.size() >= 2 && board->gameState == CheckersBoard::PLAYING) {
+        bool whiteToMove;
+        board->getPosition(ponderFrom_, whiteToMove);
+        GameRules::Cells expected;
+        std::memcpy(expected, ponderFrom_, sizeof(expected));
+        GameRules::applyPath(expected, report.line[1]);
+        search_->start(BackgroundSearch::Mode::PONDER, expected, !whiteToMove, BackgroundSearch::UNLIMITED);
+    }
+}
+
+//--Сохранение текущей партии в ../saves/game.pdn
+void Application::saveGame() const {
+    std::error_code ec;
+    std::filesystem::create_directories("../saves", ec);
+    std::ofstream out("../saves/game.pdn");
+    if (!out) {
+        std::cout << "PDN: не удалось записать ../saves/game.pdn\n";
+        return;
+    }
+    board->savePdn(out);
+    std::cout << "PDN: партия сохранена (" << board->movesPlayed() << " ходов)\n";
+}
+
+//--Проверка архива PDN: разбор всех партий и сверка каждого хода с правилами
+static int checkPdnFile(const std::string& path, Variant variant) {
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cout << "PDN: не удалось открыть " << path << "\n";
+        return EXIT_FAILURE;
+    }
+    auto start = std::chrono::steady_clock::now();
+    PdnCheckStats stats = checkPdnArchive(file.view(), variant);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const std::string& error : stats.errors)
+        std::cout << "PDN: " << error << "\n";
+    std::cout << "PDN: партий " << stats.games << ", ходов " << stats.moves << ", с ошибками " << stats.invalid
+        << "; " << file.size() / 1e6 / std::max(seconds, 1e-9) << " МБ/с\n";
+    return stats.invalid == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//--Сборка базы партий из архива PDN
+static int buildDatabaseFile(const std::string& pdnPath, const std::string& dbPath, Variant variant) {
+    MappedFile file;
+    if (!file.open(pdnPath)) {
+        std::cout << "База: не удалось открыть " << pdnPath << "\n";
+        return EXIT_FAILURE;
+    }
+    auto start = std::chrono::steady_clock::now();
+    GameDbBuildStats stats;
+    std::string error;
+    bool ok = dispatchVariant(variant, [&](auto traits) {
+        return buildGameDatabase<decltype(traits)>(file.view(), dbPath, stats, error);
+        });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!ok) {
+        std::cout << "База: " << error << "\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "База: партий " << stats.games << ", позиций " << stats.positions << ", пропущено " << stats.skipped
+        << "; " << seconds << " с\n";
+    return EXIT_SUCCESS;
+}
+
+//--Запрос к базе: позиция из FEN (или начальная), итоги партий и продолжения
+static int queryDatabaseFile(const std::string& dbPath, const std::string& fen) {
+    GameDatabase db;
+    std::string error;
+    if (!db.open(dbPath, error)) {
+        std::cout << "База: " << error << "\n";
+        return EXIT_FAILURE;
+    }
+    return dispatchVariant(db.variant(), [&](auto traits) {
+        using V = decltype(traits);
+        typename Rules<V>::Position pos = Rules<V>::initial();
+        if (!fen.empty() && !PdnReplay<V>::parseFen(fen, pos)) {
+            std::cout << "База: неверный FEN " << fen << "\n";
+            return EXIT_FAILURE;
+        }
+        auto start = std::chrono::steady_clock::now();
+        reportPosition<V>(db, pos, std::cout);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Поиск среди " << db.positions() << " позиций: " << ms << " мс\n";
+        return EXIT_SUCCESS;
+        });
+}
+
+//--Сборка дебютной книги: из архива PDN (pdnPath) или партий движка с самим собой (selfPlayGames)
+static int buildBookFile(const AppOptions& options) {
+    MappedFile file;
+    if (!options.bookBuildPdn.empty() && !file.open(options.bookBuildPdn)) {
+        std::cout << "Книга: не удалось открыть " << options.bookBuildPdn << "\n";
+        return EXIT_FAILURE;
+    }
+    auto start = std::chrono::steady_clock::now();
+    BookBuilder builder;
+    dispatchVariant(options.variant, [&](auto traits) {
+        using V = decltype(traits);
+        if (file.isOpen())
+            std::cout << "Книга: партий " << addBookFromPdn<V>(builder, file.view(), options.bookPlies) << "\n";
+        else
+            addBookFromSelfPlay<V>(builder, options.bookSelfPlay, options.bookPlies, std::min(options.engineLimits.depth, 6), 12345);
+        });
+
+    std::string error;
+    long long entries = builder.write(options.bookBuild, options.variant, options.bookMinGames, error);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (entries < 0) {
+        std::cout << "Книга: " << error << "\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "Книга: записей " << entries << " из " << builder.size() << " ходов; " << seconds << " с\n";
+    return EXIT_SUCCESS;
+}
+
+//--Замер пробы книги: позиции из случайных дебютов, часть из которых есть в книге
+static int benchmarkBookProbe(const std::string& path) {
+    OpeningBook book;
+    std::string error;
+    if (!book.open(path, error)) {
+        std::cout << "Книга: " << error << "\n";
+        return EXIT_FAILURE;
+    }
+    return dispatchVariant(book.variant(), [&](auto traits) {
+        using Core = Rules<decltype(traits)>;
+        std::mt19937 rng(7);
+        std::vector<uint64_t> hashes;
+        std::vector<typename Core::Move> legal;
+        while (hashes.size() < 100000) {
+            typename Core::Position pos = Core::initial();
+            for (int ply = 0; ply < 12; ++ply) {
+                hashes.push_back(Core::hash(pos));
+                Core::generate(pos, legal);
+                if (legal.empty()) break;
+                Core::apply(pos, legal[rng() % legal.size()]);
+            }
+        }
+
+        size_t hits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < 10; ++round)
+            for (uint64_t hash : hashes) {
+                BookEntry entry;
+                hits += book.probe(hash, uint32_t(hash), entry);
+            }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Книга: " << book.size() << " записей, проб " << hashes.size() * 10 << ", попаданий " << hits
+            << ", " << ns / (hashes.size() * 10) << " нс на пробу\n";
+        return EXIT_SUCCESS;
+        });
+}
+
+//--Ходы случайных партий для замеров оценки: позиция после хода и запись для инкрементальной поправки.
+//  gameStarts — начала партий в steps и конец последней
+template<class V>
+struct BenchStep {
+    typename Rules<V>::Position after;
+    typename Rules<V>::Move move;
+    typename Rules<V>::Undo undo;
+    int side;
+};
+
+template<class V>
+static void randomGames(size_t count, std::vector<BenchStep<V>>& steps, std::vector<size_t>& gameStarts) {
+    using Core = Rules<V>;
+    std::mt19937 rng(11);
+    std::vector<typename Core::Move> legal;
+    while (steps.size() < count) {
+        gameStarts.push_back(steps.size());
+        typename Core::Position pos = Core::initial();
+        for (int ply = 0; ply < 150; ++ply) {
+            Core::generate(pos, legal);
+            if (legal.empty()) break;
+            BenchStep<V> step{ {}, legal[rng() % legal.size()], {}, pos.side };
+            Core::make(pos, step.move, step.undo);
+            step.after = pos;
+            steps.push_back(step);
+        }
+    }
+    gameStarts.push_back(steps.size());
+}
+
+// Время работы body в секундах и её контрольная сумма
+template<class F>
+static std::pair<long long, double> timedSum(F&& body) {
+    auto start = std::chrono::steady_clock::now();
+    long long sum = body();
+    return { sum, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+}
+
+//--Замер оценки на позициях из случайных партий: полный пересчёт против инкрементального
+//  и скалярная свёртка признаков против SIMD
+static int benchmarkEvaluation(Variant variant) {
+    return dispatchVariant(variant, [&](auto traits) {
+        using V = decltype(traits);
+        using Core = Rules<V>;
+        using Eval = Evaluator<V>;
+
+        std::vector<BenchStep<V>> steps;
+        std::vector<size_t> gameStarts;
+        randomGames<V>(500000, steps, gameStarts);
+        const double n = double(steps.size());
+
+        auto [fullSum, fullTime] = timedSum([&] {
+            long long sum = 0;
+            for (const auto& step : steps) sum += Eval::evaluate(step.after);
+            return sum;
+            });
+        auto [incSum, incTime] = timedSum([&] {
+            long long sum = 0;
+            for (size_t g = 0; g + 1 < gameStarts.size(); ++g) {
+                auto acc = Eval::accumulate(Core::initial());
+                for (size_t i = gameStarts[g]; i < gameStarts[g + 1]; ++i) {
+                    Eval::update(acc, steps[i].move, steps[i].undo, steps[i].side);
+                    sum += Eval::evaluate(steps[i].after, acc);
+                }
+            }
+            return sum;
+            });
+
+        std::vector<std::array<int16_t, Eval::FEATURES>> features(steps.size());
+        for (size_t i = 0; i < steps.size(); ++i) Eval::features(steps[i].after, features[i].data());
+        auto [scalarSum, scalarTime] = timedSum([&] {
+            long long sum = 0;
+            for (const auto& f : features) sum += Eval::dotScalar(f.data(), Eval::WEIGHTS_MG) + Eval::dotScalar(f.data(), Eval::WEIGHTS_EG);
+            return sum;
+            });
+        auto [simdSum, simdTime] = timedSum([&] {
+            long long sum = 0;
+            for (const auto& f : features) sum += Eval::dot(f.data(), Eval::WEIGHTS_MG) + Eval::dot(f.data(), Eval::WEIGHTS_EG);
+            return sum;
+            });
+
+        std::cout << "Оценка (" << V::NAME << ", " << steps.size() << " позиций):\n"
+            << "  полная:          " << n / fullTime / 1e6 << " млн/с\n"
+            << "  инкрементальная: " << n / incTime / 1e6 << " млн/с" << (incSum == fullSum ? "" : " (РАСХОЖДЕНИЕ!)") << "\n"
+            << "  свёртка скалярно: " << n / scalarTime / 1e6 << " млн/с, SIMD: " << n / simdTime / 1e6 << " млн/с"
+            << (simdSum == scalarSum ? "" : " (РАСХОЖДЕНИЕ!)") << "\n";
+        return incSum == fullSum && simdSum == scalarSum ? EXIT_SUCCESS : EXIT_FAILURE;
+        });
+}
+
+//--Тактический набор: тихие позиции из случайных партий с равным материалом, где эталонный поиск
+//  (глубина refDepth) выигрывает не меньше шашки, а лучший ход единственный (остальные — на полшашки
+//  хуже). Затем поиск с тихим поиском и без него решает их до глубины refDepth - 4: решено — итоговый
+//  ход совпал с эталоном, узлов до решения — с начала поиска до итерации, с которой ход больше не менялся
+static int benchmarkTactics(Variant variant, int refDepth) {
+    return dispatchVariant(variant, [&](auto traits) {
+        using V = decltype(traits);
+        using Core = Rules<V>;
+        using Search = AlphaBeta<V>;
+        using Eval = Evaluator<V>;
+        constexpr int POSITIONS = 40;
+        const int solveDepth = std::max(2, refDepth - 4);
+
+        std::vector<BenchStep<V>> steps;
+        std::vector<size_t> gameStarts;
+        randomGames<V>(40000, steps, gameStarts);
+
+        // Эталон: ход и его оценка; единственность — каждый другой ход досчитывается отдельно
+        struct Tactic { typename Core::Position pos; typename Core::Move best; int score; };
+        std::vector<Tactic> tactics;
+        std::vector<typename Core::Move> legal;
+        Search reference;
+        const auto started = std::chrono::steady_clock::now();
+        size_t examined = 0;
+        for (size_t g = 0; g + 1 < gameStarts.size() && int(tactics.size()) < POSITIONS; ++g)
+            for (size_t i = gameStarts[g] + 10; i < std::min(gameStarts[g + 1], gameStarts[g] + 50); i += 3) {
+                const auto& pos = steps[i].after;
+                Core::captures(pos, legal);
+                if (!legal.empty()) continue;
+                if (std::popcount(pos.pieces(0)) != std::popcount(pos.pieces(1)) || pos.kings[0] || pos.kings[1]) continue;
+                examined++;
+                const auto result = reference.search(pos, refDepth, 0.0);
+                if (!result.found || result.score < Eval::MAN || result.score >= Search::WIN - Search::MAX_PLY) continue;
+                Core::generate(pos, legal);
+                int second = -Search::WIN;
+                const auto moves = legal;
+                for (const auto& m : moves) {
+                    if (m.from() == result.best.from() && m.to() == result.best.to() && m.captured == result.best.captured) continue;
+                    auto child = pos;
+                    Core::apply(child, m);
+                    const auto reply = reference.search(child, refDepth - 1, 0.0);
+                    second = std::max(second, reply.found ? -reply.score : Search::WIN);
+                }
+                if (second > result.score - Eval::MAN / 2) continue;
+                tactics.push_back({ pos, result.best, result.score });
+                break; // Из партии — одна позиция, чтобы набор не состоял из соседних ходов
+            }
+        std::cout << "Тактика (" << V::NAME << "): " << tactics.size() << " позиций из " << examined
+            << ", эталон — глубина " << refDepth << " (" << std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count()
+            << " с), решение до глубины " << solveDepth << "\n";
+        if (tactics.empty()) return EXIT_FAILURE;
+
+        // Узлы до решения сравниваются на позициях, решённых в обоих режимах
+        constexpr uint64_t UNSOLVED = ~0ull;
+        std::vector<uint64_t> settledNodes[2];
+        uint64_t totalNodes[2] = {};
+        double seconds[2] = {};
+        for (int mode = 0; mode < 2; ++mode) {
+            Search search;
+            search.quiescence = mode == 1;
+            for (const Tactic& t : tactics) {
+                uint64_t settled = UNSOLVED; // Узлов на конец итерации, с которой ход стал эталонным
+                search.onIteration = [&](const typename Search::Result& r) {
+                    const bool match = r.best.from() == t.best.from() && r.best.to() == t.best.to()
+                        && r.best.captured == t.best.captured;
+                    if (!match) settled = UNSOLVED;
+                    else if (settled == UNSOLVED) settled = r.nodes;
+                };
+                totalNodes[mode] += search.search(t.pos, solveDepth, 0.0).nodes;
+                seconds[mode] += search.stats().seconds;
+                settledNodes[mode].push_back(settled);
+            }
+        }
+        uint64_t commonNodes[2] = {};
+        int solved[2] = {}, common = 0;
+        for (size_t i = 0; i < tactics.size(); ++i) {
+            for (int mode = 0; mode < 2; ++mode) solved[mode] += settledNodes[mode][i] != UNSOLVED;
+            if (settledNodes[0][i] == UNSOLVED || settledNodes[1][i] == UNSOLVED) continue;
+            common++;
+            for (int mode = 0; mode < 2; ++mode) commonNodes[mode] += settledNodes[mode][i];
+        }
+        std::cout << "режим\tрешено\tузлов до решения*\tузлов на позицию\tвремя, с\n";
+        for (int mode = 0; mode < 2; ++mode)
+            std::cout << (mode ? "тихий поиск" : "без него") << "\t" << solved[mode] << "/" << tactics.size() << "\t"
+                << (common ? commonNodes[mode] / common : 0) << "\t" << totalNodes[mode] / tactics.size() << "\t"
+                << seconds[mode] << "\n";
+        std::cout << "* среднее по " << common << " позициям, решённым в обоих режимах\n";
+        return EXIT_SUCCESS;
+        });
+}
+
+//--Замер сети против ручной оценки: полный пересчёт аккумулятора (ядра AVX2 и скалярные)
+//  и инкрементальная поправка по ходу
+static int benchmarkNnue(const AppOptions& options) {
+    auto network = std::make_unique<NnueNetwork>();
+    loadNetwork(options.nnue, options.variant, *network);
+    return dispatchVariant(options.variant, [&](auto traits) {
+        using V = decltype(traits);
+        using Core = Rules<V>;
+        using Eval = Evaluator<V>;
+        const NnueEvaluator<V> nnue(network.get());
+
+        std::vector<BenchStep<V>> steps;
+        std::vector<size_t> gameStarts;
+        randomGames<V>(500000, steps, gameStarts);
+        std::vector<typename Core::Position> positions(steps.size());
+        for (size_t i = 0; i < steps.size(); ++i) positions[i] = steps[i].after;
+        const double n = double(steps.size());
+
+        auto [handSum, handTime] = timedSum([&] {
+            long long sum = 0;
+            for (const auto& p : positions) sum += Eval::evaluate(p);
+            return sum;
+            });
+        auto [fullSum, fullTime] = timedSum([&] {
+            long long sum = 0;
+            for (const auto& p : positions) sum += nnue.evaluate(p);
+            return sum;
+            });
+        auto [incSum, incTime] = timedSum([&] {
+            long long sum = 0;
+            for (size_t g = 0; g + 1 < gameStarts.size(); ++g) {
+                auto acc = nnue.accumulate(Core::initial());
+                for (size_t i = gameStarts[g]; i < gameStarts[g + 1]; ++i) {
+                    nnue.update(acc, steps[i].move, steps[i].undo, steps[i].side);
+                    sum += nnue.evaluate(steps[i].after, acc);
+                }
+            }
+            return sum;
+            });
+        std::vector<int> scores(positions.size());
+        const bool avx2 = NnueNetwork::useAvx2;
+        NnueNetwork::useAvx2 = false;
+        auto [scalarSum, scalarTime] = timedSum([&] {
+            nnue.evaluateAll(positions.data(), positions.size(), scores.data());
+            long long sum = 0;
+            for (int s : scores) sum += s;
+            return sum;
+            });
+        NnueNetwork::useAvx2 = avx2;
+
+        const bool same = incSum == fullSum && scalarSum == fullSum;
+        std::cout << "Сеть против ручной оценки (" << V::NAME << ", " << steps.size() << " позиций, AVX2 "
+            << (avx2 ? "есть" : "нет") << "):\n"
+            << "  ручная оценка:          " << n / handTime / 1e6 << " млн/с\n"
+            << "  сеть, полный пересчёт:  " << n / fullTime / 1e6 << " млн/с, скалярные ядра: "
+            << n / scalarTime / 1e6 << " млн/с\n"
+            << "  сеть, инкрементально:   " << n / incTime / 1e6 << " млн/с" << (same ? "" : " (РАСХОЖДЕНИЕ!)") << "\n";
+        return same ? EXIT_SUCCESS : EXIT_FAILURE;
+        });
+}
+
+//--Масштабирование поиска Монте-Карло: доигрываний в секунду из начальной позиции на 1, 2, 4... потоках
+static int benchmarkMcts(const AppOptions& options) {
+    return dispatchVariant(options.variant, [&](auto traits) {
+        using V = decltype(traits);
+        const int maxThreads = std::max(1, int(std::thread::hardware_concurrency()));
+        std::cout << "Монте-Карло (" << V::NAME << ", 2 с на замер):\n";
+        double single = 0.0;
+        for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+            MctsConfig config = options.mcts;
+            config.threads = threads;
+            Mcts<V> mcts(config);
+            const auto result = mcts.search(Rules<V>::initial(), 2.0, 0);
+            const double rate = result.playouts / 2.0;
+            if (threads == 1) single = rate;
+            std::cout << "  потоков " << threads << ": " << rate / 1e3 << " тыс. доигрываний/с (x" << rate / single
+                << "), узлов " << result.nodes << ", глубина " << result.depth
+                << ", очки лучшего хода " << result.winRate << "\n";
+            if (threads == maxThreads) break;
+        }
+        return EXIT_SUCCESS;
+        });
+}
+
+//--Раскладка источников по кластерам: время на кадр в зависимости от числа ламп и потоков. Ссылок
+//  на кластер в среднем — сколько источников в среднем перебирает фрагмент
+static int benchmarkLights() {
+    using Clock = std::chrono::steady_clock;
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1600.0f / 900.0f, 0.1f, 100.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 30.0f, 30.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const int maxThreads = std::clamp(int(std::thread::hardware_concurrency()), 1, 4);
+    const int frames = 200;
+    std::cout << "lights\tthreads\tms\trefs\tper cluster\tbusiest\toverflow\n";
+    for (int lamps : { 16, 64, 256, 1024 }) {
+        std::vector<Light> lights;
+        placeLamps(lights, lamps, 40.0f);
+        for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+            ClusteredLights clusters(threads);
+            clusters.setProjection(projection, 0.1f, 100.0f, 1600, 900);
+            clusters.build(lights, view);
+            const auto start = Clock::now();
+            for (int frame = 0; frame < frames; ++frame)
+                clusters.build(lights, view);
+            const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+            std::cout << lamps << "\t" << threads << "\t" << ms << "\t" << clusters.references() << "\t"
+                << double(clusters.references()) / ClusteredLights::CLUSTERS << "\t" << clusters.busiestCluster()
+                << "\t" << clusters.overflow() << "\n";
+            if (threads == maxThreads) break;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+//--Движок без окна для скриптов сравнения. Команды построчно из stdin:
+//    position startpos | position fen FEN   — позиция поиска
+//    go [depth N] [movetime SECONDS]        — поиск (по умолчанию --depth и --movetime)
+//    stats [FILE]                           — счётчики последнего поиска в JSON (в stdout или в файл)
+//    isready, quit
+//  Ответы: "info ...", "bestmove ХОД" (PDN, none — ходов нет), "stats {...}", "error ..."
+static int runHeadless(const AppOptions& options) {
+    std::unique_ptr<NnueNetwork> network;
+    if (options.engineKind == "nnue") {
+        network = std::make_unique<NnueNetwork>();
+        loadNetwork(options.nnue, options.variant, *network);
+    }
+    EngineSetup setup;
+    setup.network = network.get();
+    setup.mcts = options.mcts;
+    std::unique_ptr<Engine> engine = makeEngine(options.variant, options.engineKind, setup);
+    if (!engine) {
+        std::cout << "error unknown engine " << options.engineKind << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    GameRules::Cells cells = {};
+    bool whiteToMove = true;
+    auto setPosition = [&](const std::string& fen) {
+        return dispatchVariant(options.variant, [&](auto traits) {
+            using V = decltype(traits);
+            typename Rules<V>::Position pos = Rules<V>::initial();
+            if (!fen.empty() && !PdnReplay<V>::parseFen(fen, pos)) return false;
+            Rules<V>::toCells(pos, cells);
+            whiteToMove = pos.side == 0;
+            return true;
+            });
+    };
+    setPosition("");
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream in(line);
+        std::string command;
+        in >> command;
+        if (command == "quit") break;
+        if (command == "isready") std::cout << "readyok" << std::endl;
+        else if (command == "position") {
+            std::string kind, fen;
+            in >> kind;
+            std::getline(in >> std::ws, fen);
+            if (kind == "startpos" ? !setPosition("") : kind != "fen" || !setPosition(fen))
+                std::cout << "error bad position" << std::endl;
+        }
+        else if (command == "go") {
+            engine->limits = options.engineLimits;
+            std::string key;
+            double value;
+            while (in >> key >> value) {
+                if (key == "depth") engine->limits.depth = std::max(1, int(value));
+                else if (key == "movetime") engine->limits.seconds = value;
+            }
+            GameRules::PathMove move;
+            const bool found = engine->chooseMove(cells, whiteToMove, move);
+            const Engine::Report& report = engine->lastReport();
+            const std::string& pv = report.lineText;
+            std::cout << "info depth " << report.depth << " score " << report.score << " nodes " << report.nodes
+                << " pv " << pv << "\n" << "bestmove " << (found ? pv.substr(0, pv.find(' ')) : "none") << std::endl;
+        }
+        else if (command == "stats") {
+            const SearchStats* stats = engine->searchStats();
+            const std::string json = stats ? stats->json() : "{}";
+            std::string path;
+            if (in >> path) {
+                std::ofstream file(path);
+                file << json << "\n";
+                if (!file) std::cout << "error cannot write " << path << std::endl;
+            }
+            else std::cout << "stats " << json << std::endl;
+        }
+        else if (!command.empty()) std::cout << "error unknown command " << command << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+//--Решатель df-pn для позиции из FEN ("start" — начальная): выигрывает ли сторона, чей ход, и как.
+//  Для окончаний с дамками и форсированных комбинаций, где поиск на глубину упирается в горизонт
+static int runSolver(const AppOptions& options) {
+    return dispatchVariant(options.variant, [&](auto traits) {
+        using V = decltype(traits);
+        using Solver = ProofSolver<V>;
+        typename Rules<V>::Position pos = Rules<V>::initial();
+        if (options.solve != "start" && !PdnReplay<V>::parseFen(options.solve, pos)) {
+            std::cout << "Решатель: неверный FEN " << options.solve << "\n";
+            return EXIT_FAILURE;
+        }
+        auto solver = std::make_unique<Solver>(size_t(options.solveMemory));
+        std::cout << "Решатель (" << V::NAME << "): " << PdnReplay<V>::fen(pos) << ", таблица " << options.solveMemory
+            << " МБ, предел " << options.solveTime << " с\n";
+        const typename Solver::Result r = solver->solve(pos, options.solveTime);
+
+        const char* side = pos.side == 0 ? "белых" : "чёрных";
+        if (r.outcome == Solver::Outcome::WIN) {
+            std::string line;
+            for (const auto& m : r.line) {
+                if (!line.empty()) line += ' ';
+                PdnReplay<V>::appendMove(line, m);
+            }
+            std::cout << "Выигрыш " << side << ", вариант: " << line << "\n"
+                << "Дерево доказательства: " << r.proofSize << " позиций";
+            if (r.proofMissing) std::cout << " (и не меньше " << r.proofMissing << " ветвей, вытесненных из таблицы)";
+            std::cout << "\n";
+        }
+        else if (r.outcome == Solver::Outcome::NO_WIN) std::cout << "У " << side << " выигрыша нет (проигрыш или ничья)\n";
+        else std::cout << "Не решено за отведённое время\n";
+
+        std::cout << "Узлов: " << r.nodes << ", " << r.seconds << " с (" << uint64_t(r.nodes / std::max(r.seconds, 1e-9))
+            << " в секунду)\n" << "Таблица: " << r.entries << " записей, запросов " << r.probes << ", попаданий "
+            << (r.probes ? 100.0 * r.hits / r.probes : 0.0) << "%, записей " << r.stores << ", вытеснений " << r.replaced << "\n";
+        return r.outcome == Solver::Outcome::UNKNOWN ? EXIT_FAILURE : EXIT_SUCCESS;
+        });
+}
+
+//--Партии движка с самим собой по часам: время хода распределяет TimeManager, часы идут по настоящему
+//  времени поиска. Итог — просрочки, средняя глубина и сколько раз ход вышел за жёсткий предел
+static int runClockMatch(const AppOptions& options) {
+    const double base = options.clockBase > 0.0 ? options.clockBase : 10.0;
+    const double increment = options.clockBase > 0.0 ? options.clockIncrement : 0.1;
+    std::unique_ptr<NnueNetwork> network;
+    if (options.engineKind == "nnue") {
+        network = std::make_unique<NnueNetwork>();
+        loadNetwork(options.nnue, options.variant, *network);
+    }
+    EngineSetup setup;
+    setup.network = network.get();
+    setup.mcts = options.mcts;
+    std::unique_ptr<Engine> engines[2] = { makeEngine(options.variant, options.engineKind, setup),
+        makeEngine(options.variant, options.engineKind, setup) };
+    if (!engines[0]) {
+        std::cout << "Неизвестный движок: " << options.engineKind << "\n";
+        return EXIT_FAILURE;
+    }
+    const auto rules = makeRules(options.variant);
+    const TimeManager manager;
+    constexpr int MAX_PLIES = 300;
+
+    int results[3] = {}, forfeits = 0, overruns = 0, searched = 0, moves = 0;
+    long long depthSum = 0;
+    double usedSum = 0.0, lowest = base;
+    std::cout << "Партии по часам: " << options.engineKind << ", " << base << " с + " << increment << " с за ход\n";
+    for (int game = 0; game < options.clockMatch; ++game) {
+        GameRules::Cells cells = {};
+        bool whiteToMove = rules->whiteStarts();
+        dispatchVariant(options.variant, [&](auto traits) {
+            using V = decltype(traits);
+            Rules<V>::toCells(Rules<V>::initial(), cells);
+            });
+        GameClock clock;
+        clock.start(base, increment, whiteToMove ? 0 : 1);
+        std::vector<GameRules::PathMove> legal;
+        int result = 2; // 0 — победа белых, 1 — чёрных, 2 — ничья
+        for (int ply = 0; ply < MAX_PLIES; ++ply) {
+            const int side = whiteToMove ? 0 : 1;
+            rules->legalMoves(cells, whiteToMove, legal);
+            if (legal.empty()) {
+                result = side ^ 1;
+                break;
+            }
+            const TimeManager::Budget budget = manager.allocate(clock.remaining(side), increment, ply);
+            engines[side]->limits = { BackgroundSearch::UNLIMITED.depth, budget.hard, budget.soft };
+            const double before = clock.remaining(side);
+            GameRules::PathMove move;
+            engines[side]->chooseMove(cells, whiteToMove, move);
+            const double used = before - clock.remaining(side);
+            clock.press();
+
+            const Engine::Report& report = engines[side]->lastReport();
+            if (!report.fromBook && report.depth > 0) {
+                depthSum += report.depth;
+                searched++;
+            }
+            usedSum += used;
+            moves++;
+            overruns += used > budget.hard + 0.01;
+            if (clock.remaining(side) < 0.0) {
+                forfeits++;
+                result = side ^ 1;
+                break;
+            }
+            lowest = std::min(lowest, clock.remaining(side));
+            GameRules::applyPath(cells, move);
+            whiteToMove = !whiteToMove;
+        }
+        results[result]++;
+        std::cout << "  партия " << game + 1 << ": " << (result == 0 ? "1-0" : result == 1 ? "0-1" : "1/2-1/2")
+            << ", остаток белых " << GameClock::format(clock.remaining(0)) << ", чёрных " << GameClock::format(clock.remaining(1)) << "\n";
+    }
+
+    std::cout << "Итог: белые " << results[0] << ", чёрные " << results[1] << ", ничьи " << results[2]
+        << "\n  просрочек времени: " << forfeits
+        << "\n  ходов дольше жёсткого предела: " << overruns
+        << "\n  средняя глубина: " << (searched ? double(depthSum) / searched : 0.0)
+        << "\n  среднее время на ход: " << (moves ? usedSum / moves : 0.0) << " с"
+        << "\n  наименьший остаток после хода: " << GameClock::format(lowest) << "\n";
+    return forfeits == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 //Вывод координат выбранной модели
 void Application::printSelected() const{
-    std::cout << "Координаты: " << "X: "<<selectedObject_->position.x << " Y:" << selectedObject_->position.y << " Z:" << selectedObject_->position.z << std::endl
-        <<"Масштаб: "<<selectedObject_->model.scale<<std::endl
-        <<"Вращение: " << "X: " << selectedObject_->model.rotation.x << " Y:" << selectedObject_->model.rotation.y << " Z:" << selectedObject_->model.rotation.z << std::endl;
+    if (selectedObject_ == NO_ENTITY) return;
+    const glm::vec3& position = scene_.position[selectedObject_];
+    const glm::vec3& rotation = scene_.rotation[selectedObject_];
+    std::cout << "Координаты: " << "X: "<<position.x << " Y:" << position.y << " Z:" << position.z << std::endl
+        <<"Масштаб: "<<scene_.scale[selectedObject_]<<std::endl
+        <<"Вращение: " << "X: " << rotation.x << " Y:" << rotation.y << " Z:" << rotation.z << std::endl;
     return;
 }
 
-int main() {
+int main(int argc, char** argv) {
     setlocale(LC_ALL, "ru_RU");
-    Application app;
+
+    AppOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--spectator" && i + 1 < argc)
+            options.spectatorBoards = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--bench-spectator")
+            options.spectatorBench = true;
+        else if (arg == "--hot-reload")
+            options.hotReload = true;
+        else if (arg == "--lamps" && i + 1 < argc)
+            options.lamps = std::clamp(std::atoi(argv[++i]), 0, ClusteredLights::MAX_LIGHTS - 1);
+        else if (arg == "--bench-lights")
+            options.lightsBench = true;
+        else if (arg == "--id-picking")
+            options.idPicking = true;
+        else if (arg == "--bench-picking")
+            options.pickingBench = true;
+        else if (arg == "--record" && i + 1 < argc)
+            options.record = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+            options.replay = argv[++i];
+        else if (arg == "--replay-trace" && i + 1 < argc)
+            options.replayTrace = argv[++i];
+        else if (arg == "--replay-fps" && i + 1 < argc)
+            options.replayFps = std::clamp(std::atoi(argv[++i]), 1, 1000);
+        else if (arg == "--continuous")
+            options.continuous = true;
+        else if (arg == "--variant" && i + 1 < argc) {
+            if (!parseVariant(argv[++i], options.variant))
+                std::cout << "Неизвестный вариант правил: " << argv[i] << "\n";
+        }
+        else if (arg == "--pdn-check" && i + 1 < argc)
+            options.pdnCheck = argv[++i];
+        else if (arg == "--pdn-load" && i + 1 < argc)
+            options.pdnLoad = argv[++i];
+        else if (arg == "--pdn-game" && i + 1 < argc)
+            options.pdnGame = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--db-build" && i + 2 < argc) {
+            options.dbBuildPdn = argv[++i];
+            options.dbBuild = argv[++i];
+        }
+        else if (arg == "--db-query" && i + 1 < argc) {
+            options.dbQuery = argv[++i];
+            if (i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0) options.dbQueryFen = argv[++i];
+        }
+        else if (arg == "--db" && i + 1 < argc)
+            options.database = argv[++i];
+        else if (arg == "--engine" && i + 1 < argc)
+            options.engineSide = argv[++i];
+        else if (arg == "--engine-kind" && i + 1 < argc)
+            options.engineKind = argv[++i];
+        else if (arg == "--depth" && i + 1 < argc)
+            options.engineLimits.depth = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--movetime" && i + 1 < argc)
+            options.engineLimits.seconds = std::atof(argv[++i]);
+        else if (arg == "--book" && i + 1 < argc)
+            options.book = argv[++i];
+        else if (arg == "--book-build" && i + 2 < argc) {
+            options.bookBuildPdn = argv[++i];
+            options.bookBuild = argv[++i];
+        }
+        else if (arg == "--book-selfplay" && i + 2 < argc) {
+            options.bookSelfPlay = std::max(1, std::atoi(argv[++i]));
+            options.bookBuild = argv[++i];
+        }
+        else if (arg == "--book-plies" && i + 1 < argc)
+            options.bookPlies = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--book-min" && i + 1 < argc)
+            options.bookMinGames = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--book-probe" && i + 1 < argc)
+            options.bookProbe = argv[++i];
+        else if (arg == "--bench-eval")
+            options.evalBench = true;
+        else if (arg == "--bench-tactics") {
+            options.tacticsDepth = 9;
+            if (i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0)
+                options.tacticsDepth = std::clamp(std::atoi(argv[++i]), 4, 20);
+        }
+        else if (arg == "--nnue" && i + 1 < argc)
+            options.nnue = argv[++i];
+        else if (arg == "--nnue-init" && i + 1 < argc)
+            options.nnueInit = argv[++i];
+        else if (arg == "--bench-nnue")
+            options.nnueBench = true;
+        else if (arg == "--mcts-threads" && i + 1 < argc)
+            options.mcts.threads = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--mcts-playout" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy == "random") options.mcts.playout = MctsConfig::Playout::RANDOM;
+            else if (policy == "greedy") options.mcts.playout = MctsConfig::Playout::GREEDY;
+            else std::cout << "Неизвестная политика доигрывания: " << policy << "\n";
+        }
+        else if (arg == "--mcts-playouts" && i + 1 < argc)
+            options.mcts.playouts = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--bench-mcts")
+            options.mctsBench = true;
+        else if (arg == "--ponder")
+            options.ponder = true;
+        else if (arg == "--analysis")
+            options.analysis = true;
+        else if (arg == "--clock" && i + 1 < argc) {
+            // "5+3": 5 минут на партию и 3 секунды за ход; "0.5" — полминуты без добавки
+            std::string control = argv[++i];
+            size_t plus = control.find('+');
+            options.clockBase = std::atof(control.substr(0, plus).c_str()) * 60.0;
+            options.clockIncrement = plus == std::string::npos ? 0.0 : std::atof(control.c_str() + plus + 1);
+        }
+        else if (arg == "--clock-match" && i + 1 < argc)
+            options.clockMatch = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--headless")
+            options.headless = true;
+        else if (arg == "--solve" && i + 1 < argc)
+            options.solve = argv[++i];
+        else if (arg == "--solve-time" && i + 1 < argc)
+            options.solveTime = std::max(0.0, std::atof(argv[++i]));
+        else if (arg == "--solve-memory" && i + 1 < argc)
+            options.solveMemory = std::clamp(std::atoi(argv[++i]), 1, 16384);
+        else
+            std::cout << "Неизвестный параметр: " << arg << "\n";
+    }
+
+    if (!options.pdnCheck.empty())
+        return checkPdnFile(options.pdnCheck, options.variant);
+    if (!options.dbBuild.empty())
+        return buildDatabaseFile(options.dbBuildPdn, options.dbBuild, options.variant);
+    if (!options.dbQuery.empty())
+        return queryDatabaseFile(options.dbQuery, options.dbQueryFen);
+    if (!options.bookBuild.empty())
+        return buildBookFile(options);
+    if (!options.bookProbe.empty())
+        return benchmarkBookProbe(options.bookProbe);
+    if (options.evalBench)
+        return benchmarkEvaluation(options.variant);
+    if (options.tacticsDepth > 0)
+        return benchmarkTactics(options.variant, options.tacticsDepth);
+    if (!options.nnueInit.empty()) {
+        auto network = std::make_unique<NnueNetwork>();
+        network->initMaterial(options.variant);
+        if (!network->save(options.nnueInit)) {
+            std::cout << "Ошибка записи " << options.nnueInit << "\n";
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    if (options.nnueBench)
+        return benchmarkNnue(options);
+    if (options.mctsBench)
+        return benchmarkMcts(options);
+    if (options.clockMatch > 0)
+        return runClockMatch(options);
+    if (options.headless)
+        return runHeadless(options);
+    if (!options.solve.empty())
+        return runSolver(options);
+    if (options.lightsBench)
+        return benchmarkLights();
+
+    Application app(options);
     return app.run();
 }
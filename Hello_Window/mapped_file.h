@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//--Файл, отображённый в память только для чтения. Разбор идёт прямо по страницам файла,
+//  без копирования в буферы — архивы в несколько гигабайт читаются со скоростью диска
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { open(path); }
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return opened; }
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+    std::string_view view() const { return { bytes, length }; }
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) { close(); return false; }
+    length = size_t(fileSize.QuadPart);
+    opened = true;
+    if (length == 0) return true; // Пустой файл отобразить нельзя, но это не ошибка
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!bytes) { close(); return false; }
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes) UnmapViewOfFile(bytes);
+    if (mapping) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    bytes = nullptr;
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+    length = 0;
+    opened = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) { close(); return false; }
+    length = size_t(st.st_size);
+    opened = true;
+    if (length == 0) return true;
+
+    void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) { close(); return false; }
+    madvise(p, length, MADV_SEQUENTIAL);
+    bytes = static_cast<const char*>(p);
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes) munmap(const_cast<char*>(bytes), length);
+    if (fd >= 0) ::close(fd);
+    bytes = nullptr;
+    fd = -1;
+    length = 0;
+    opened = false;
+}
+
+#endif
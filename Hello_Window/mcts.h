@@ -0,0 +1,295 @@
+#pragma once
+#include "rules.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+//--Настройки поиска Монте-Карло
+struct MctsConfig {
+    enum class Playout {
+        RANDOM,   // Случайный допустимый ход
+        GREEDY    // Чаще всего — ход с превращением или самым большим взятием, иначе случайный
+    };
+
+    int threads = 0;              // 0 — по числу ядер
+    Playout playout = Playout::GREEDY;
+    int playoutPlies = 150;       // Партия длиннее считается ничьей
+    double exploration = 1.4;     // Коэффициент C в UCT
+    uint32_t virtualLoss = 3;     // Сколько проигранных визитов добавляет поток, идущий через узел
+    size_t maxNodes = 1 << 20;    // Размер пула узлов; заполненный пул больше не растёт, только уточняет оценки
+    uint64_t playouts = 0;        // Предел доигрываний за ход; 0 — только по времени
+};
+
+//--Поиск Монте-Карло по дереву (UCT) над ядром правил. Потоки растят одно дерево: статистика узлов —
+//  атомарные счётчики без блокировок, виртуальный проигрыш разводит потоки по разным веткам.
+//  Узлы берутся из пула, заведённого один раз: между ходами пул просто начинается заново
+template<class V>
+class Mcts {
+public:
+    using Core = Rules<V>;
+    using Position = typename Core::Position;
+    using Move = typename Core::Move;
+
+    static constexpr int MAX_DEPTH = 256;
+
+    struct Result {
+        Move best{};
+        double winRate = 0.5;   // Доля очков лучшего хода для стороны, чей ход
+        uint64_t playouts = 0;
+        size_t nodes = 0;
+        int depth = 0;          // Самый глубокий путь выбора
+        bool found = false;     // false — у стороны нет ходов
+        std::vector<Move> line; // Цепочка самых посещённых ходов от корня
+    };
+
+    const std::atomic<bool>* abort = nullptr;          // Поднятый флаг прерывает поиск после текущего доигрывания
+    std::function<void(const Result&)> onProgress;     // Промежуточный итог раз в PROGRESS_SECONDS, в потоке поиска
+    static constexpr double PROGRESS_SECONDS = 0.1;
+
+    explicit Mcts(const MctsConfig& config = {});
+
+    // Поиск, пока не выйдет время seconds (<= 0 — без ограничения) или не наберётся maxPlayouts (0 — без ограничения)
+    Result search(const Position& root, double seconds, uint64_t maxPlayouts);
+    const MctsConfig& config() const { return cfg; }
+
+private:
+    enum : uint8_t { UNEXPANDED, EXPANDING, EXPANDED, FULL };
+
+    struct Node {
+        std::atomic<uint32_t> visits{ 0 };
+        std::atomic<uint32_t> score{ 0 };      // Сумма исходов для стороны, сделавшей ход в узел: победа 2, ничья 1
+        std::atomic<uint32_t> pending{ 0 };    // Потоков, которые сейчас идут через узел
+        std::atomic<uint32_t> firstChild{ 0 };
+        std::atomic<uint16_t> children{ 0 };
+        std::atomic<uint8_t> state{ UNEXPANDED };
+
+        void reset() {
+            visits.store(0, std::memory_order_relaxed);
+            score.store(0, std::memory_order_relaxed);
+            pending.store(0, std::memory_order_relaxed);
+            children.store(0, std::memory_order_relaxed);
+            state.store(UNEXPANDED, std::memory_order_relaxed);
+        }
+    };
+
+    MctsConfig cfg;
+    std::unique_ptr<Node[]> nodes;
+    std::unique_ptr<Move[]> moves;               // Ход, ведущий в узел с тем же номером
+    std::atomic<size_t> used{ 0 };
+    std::atomic<uint64_t> playouts{ 0 };
+    std::atomic<int> maxDepth{ 0 };
+    std::atomic<bool> stop{ false };
+
+    void worker(const Position& root, uint32_t seed, std::chrono::steady_clock::time_point deadline, bool timed,
+        uint64_t maxPlayouts, bool reporter);
+    // Лучший ход и главная линия по текущему дереву; result.best уже задан, если корень не раскрыт
+    void snapshot(Result& result) const;
+    // Раскрытие узла: дети берутся из пула одним блоком. false — пул кончился
+    bool expand(uint32_t node, const Position& pos, std::vector<Move>& legal);
+    uint32_t select(const Node& parent) const;
+    // Победитель доигрывания: 0 или 1, -1 — ничья
+    int playout(Position pos, std::vector<Move>& legal, std::mt19937& rng) const;
+};
+
+template<class V>
+Mcts<V>::Mcts(const MctsConfig& config) : cfg(config) {
+    cfg.maxNodes = std::max<size_t>(cfg.maxNodes, 1024);
+    nodes = std::make_unique<Node[]>(cfg.maxNodes);
+    moves = std::make_unique<Move[]>(cfg.maxNodes);
+}
+
+template<class V>
+typename Mcts<V>::Result Mcts<V>::search(const Position& root, double seconds, uint64_t maxPlayouts) {
+    Result result;
+    std::vector<Move> legal;
+    Core::generate(root, legal);
+    if (legal.empty()) return result;
+    result.best = legal[0];
+    result.found = true;
+    if (legal.size() == 1) return result;
+
+    nodes[0].reset();
+    used = 1;
+    playouts = 0;
+    maxDepth = 0;
+    stop = false;
+    if (seconds <= 0.0 && maxPlayouts == 0) maxPlayouts = 10000;
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(seconds));
+    const int threads = cfg.threads > 0 ? cfg.threads : std::max(1, int(std::thread::hardware_concurrency()));
+    const uint32_t seed = std::random_device{}();
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; ++i)
+        pool.emplace_back(&Mcts::worker, this, std::cref(root), seed + i, deadline, seconds > 0.0, maxPlayouts, false);
+    worker(root, seed, deadline, seconds > 0.0, maxPlayouts, true);
+    for (auto& t : pool) t.join();
+
+    snapshot(result);
+    return result;
+}
+
+// Лучший ход — самый посещённый: его оценка надёжнее всех
+template<class V>
+void Mcts<V>::snapshot(Result& result) const {
+    result.line.clear();
+    for (uint32_t node = 0; nodes[node].state.load(std::memory_order_acquire) == EXPANDED; ) {
+        const uint32_t first = nodes[node].firstChild.load(std::memory_order_relaxed);
+        const uint32_t count = nodes[node].children.load(std::memory_order_relaxed);
+        if (count == 0) break;
+        uint32_t best = first;
+        for (uint32_t c = first; c < first + count; ++c)
+            if (nodes[c].visits.load(std::memory_order_relaxed) > nodes[best].visits.load(std::memory_order_relaxed)) best = c;
+        if (nodes[best].visits.load(std::memory_order_relaxed) == 0) break;
+        if (node == 0) {
+            result.best = moves[best];
+            result.winRate = nodes[best].score.load(std::memory_order_relaxed) / (2.0 * nodes[best].visits.load(std::memory_order_relaxed));
+        }
+        result.line.push_back(moves[best]);
+        node = best;
+    }
+    if (result.line.empty()) result.line.push_back(result.best);
+    result.playouts = playouts;
+    result.nodes = std::min(used.load(), cfg.maxNodes);
+    result.depth = maxDepth;
+}
+
+template<class V>
+void Mcts<V>::worker(const Position& root, uint32_t seed, std::chrono::steady_clock::time_point deadline, bool timed,
+    uint64_t maxPlayouts, bool reporter) {
+    std::mt19937 rng(seed);
+    std::vector<Move> legal;
+    legal.reserve(32);
+    uint32_t path[MAX_DEPTH + 1];
+    auto nextReport = std::chrono::steady_clock::now();
+
+    for (uint64_t iteration = 1; !stop.load(std::memory_order_relaxed); ++iteration) {
+        // Выбор: спуск по UCT до нераскрытого узла, на пути — виртуальный проигрыш
+        Position pos = root;
+        uint32_t node = 0;
+        int length = 0;
+        path[length++] = 0;
+        nodes[0].pending.fetch_add(1, std::memory_order_relaxed);
+        int winner = -1;
+        while (true) {
+            Node& n = nodes[node];
+            uint8_t state = n.state.load(std::memory_order_acquire);
+            if (state == UNEXPANDED && n.state.compare_exchange_strong(state, EXPANDING, std::memory_order_acq_rel))
+                state = expand(node, pos, legal) ? EXPANDED : FULL;
+            if (state != EXPANDED) {
+                winner = playout(pos, legal, rng); // Раскрывает другой поток или пул кончился
+                break;
+            }
+            if (n.children.load(std::memory_order_relaxed) == 0) {
+                winner = pos.side ^ 1; // Ходов нет — проигрыш стороны, чей ход
+                break;
+            }
+            if (length > MAX_DEPTH) {
+                winner = playout(pos, legal, rng);
+                break;
+            }
+            node = select(n);
+            Core::apply(pos, moves[node]);
+            nodes[node].pending.fetch_add(1, std::memory_order_relaxed);
+            path[length++] = node;
+            if (nodes[node].visits.load(std::memory_order_relaxed) == 0) {
+                // Первый визит в лист — доигрывание из него, раскрытие при следующем
+                winner = playout(pos, legal, rng);
+                break;
+            }
+        }
+
+        // Обратный проход: узел на глубине i — после хода стороны root.side ^ (i & 1) ^ 1
+        for (int i = 0; i < length; ++i) {
+            Node& n = nodes[path[i]];
+            const int mover = root.side ^ (i & 1) ^ 1;
+            n.score.fetch_add(winner < 0 ? 1 : winner == mover ? 2 : 0, std::memory_order_relaxed);
+            n.visits.fetch_add(1, std::memory_order_relaxed);
+            n.pending.fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (length > maxDepth.load(std::memory_order_relaxed)) maxDepth.store(length, std::memory_order_relaxed);
+
+        const uint64_t done = playouts.fetch_add(1, std::memory_order_relaxed) + 1;
+        if ((maxPlayouts && done >= maxPlayouts) || (abort && abort->load(std::memory_order_relaxed)))
+            stop.store(true, std::memory_order_relaxed);
+        if ((iteration & 63) == 0 && (timed || (reporter && onProgress))) {
+            const auto now = std::chrono::steady_clock::now();
+            if (timed && now >= deadline) stop.store(true, std::memory_order_relaxed);
+            if (reporter && onProgress && now >= nextReport) {
+                Result progress;
+                progress.found = true;
+                snapshot(progress);
+                onProgress(progress);
+                nextReport = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(PROGRESS_SECONDS));
+            }
+        }
+    }
+}
+
+template<class V>
+bool Mcts<V>::expand(uint32_t node, const Position& pos, std::vector<Move>& legal) {
+    Node& n = nodes[node];
+    Core::generate(pos, legal);
+    const size_t first = used.fetch_add(legal.size(), std::memory_order_relaxed);
+    if (first + legal.size() > cfg.maxNodes) {
+        n.state.store(FULL, std::memory_order_release);
+        return false;
+    }
+    for (size_t i = 0; i < legal.size(); ++i) {
+        nodes[first + i].reset();
+        moves[first + i] = legal[i];
+    }
+    n.firstChild.store(uint32_t(first), std::memory_order_relaxed);
+    n.children.store(uint16_t(legal.size()), std::memory_order_relaxed);
+    n.state.store(EXPANDED, std::memory_order_release); // Публикует детей остальным потокам
+    return true;
+}
+
+template<class V>
+uint32_t Mcts<V>::select(const Node& parent) const {
+    const uint32_t first = parent.firstChild.load(std::memory_order_relaxed);
+    const uint32_t count = parent.children.load(std::memory_order_relaxed);
+    const double logParent = std::log(double(parent.visits.load(std::memory_order_relaxed)
+        + parent.pending.load(std::memory_order_relaxed) * cfg.virtualLoss) + 1.0);
+    uint32_t best = first;
+    double bestValue = -1.0;
+    for (uint32_t c = first; c < first + count; ++c) {
+        const Node& child = nodes[c];
+        const double visits = child.visits.load(std::memory_order_relaxed)
+            + double(child.pending.load(std::memory_order_relaxed)) * cfg.virtualLoss;
+        if (visits == 0) return c; // Непосещённые — первыми
+        const double mean = child.score.load(std::memory_order_relaxed) / (2.0 * visits);
+        const double value = mean + cfg.exploration * std::sqrt(logParent / visits);
+        if (value > bestValue) { bestValue = value; best = c; }
+    }
+    return best;
+}
+
+template<class V>
+int Mcts<V>::playout(Position pos, std::vector<Move>& legal, std::mt19937& rng) const {
+    for (int ply = 0; ply < cfg.playoutPlies; ++ply) {
+        Core::generate(pos, legal);
+        if (legal.empty()) return pos.side ^ 1;
+
+        size_t pick = rng() % legal.size();
+        if (cfg.playout == MctsConfig::Playout::GREEDY && (rng() & 3) != 0) {
+            // Превращение дороже любого взятия, из взятий — самое большое
+            auto weight = [](const Move& m) { return (m.promotes ? 64 : 0) + std::popcount(m.captured); };
+            for (size_t i = 0, offset = pick; i < legal.size(); ++i) {
+                const size_t c = (offset + i) % legal.size();
+                if (weight(legal[c]) > weight(legal[pick])) pick = c;
+            }
+        }
+        Core::apply(pos, legal[pick]);
+    }
+    return -1;
+}
@@ -50,6 +50,7 @@ public:
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        nameSamplers();
 
         // Теперь, когда у нас есть все необходимые данные, устанавливаем вершинные буферы и указатели атрибутов
         setupMesh();
@@ -58,17 +59,68 @@ public:
     // Рендеринг меша
     void Draw(Shader& shader)
     {
-        // Связываем соответствующие текстуры
+        bindTextures(shader);
+
+        // Отрисовываем меш
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+
+        // Считается хорошей практикой возвращать значения переменных к их первоначальным значениям
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // Инстансный рендеринг меша: матрицы моделей берутся из буфера instanceVBO (атрибуты 5-8),
+    // начиная с экземпляра first. Указатели атрибутов выставляются на каждый вызов, т.к. копии
+    // модели разделяют один VAO и могут рисоваться из разных буферов
+    void DrawInstanced(Shader& shader, unsigned int instanceVBO, unsigned int count, unsigned int first = 0)
+    {
+        if (count == 0) return;
+        bindTextures(shader);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        const size_t base = size_t(first) * sizeof(glm::mat4);
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            glEnableVertexAttribArray(5 + i);
+            glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(base + i * sizeof(glm::vec4)));
+            glVertexAttribDivisor(5 + i, 1);
+        }
+        glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, count);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // Освобождение буферов GPU (меш заменён при перезагрузке модели)
+    void release()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+    }
+
+private:
+    // Данные для рендеринга 
+    unsigned int VBO, EBO;
+    vector<string> samplers; // Имя uniform-сэмплера для каждой текстуры (diffuse_textureN и т.д.)
+
+    // Имена сэмплеров собираются один раз: склейка строк в каждом Draw выделяла память на каждый меш
+    void nameSamplers()
+    {
         unsigned int diffuseNr = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr = 1;
         unsigned int heightNr = 1;
-        for (unsigned int i = 0; i < textures.size(); i++)
+        samplers.clear();
+        for (const Texture& texture : textures)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // перед связыванием активируем нужный текстурный юнит
             // Получаем номер текстуры (номер N в diffuse_textureN)
             string number;
-            string name = textures[i].type;
+            const string& name = texture.type;
             if (name == "texture_diffuse")
                 number = std::to_string(diffuseNr++);
             else if (name == "texture_specular")
@@ -77,26 +129,25 @@ public:
                 number = std::to_string(normalNr++); // конвертируем unsigned int в строку
             else if (name == "texture_height")
                 number = std::to_string(heightNr++); // конвертируем unsigned int в строку
+            samplers.push_back(name + number);
+        }
+    }
+
+    // Связываем текстуры меша с сэмплерами шейдера
+    void bindTextures(Shader& shader)
+    {
+        // Связываем соответствующие текстуры
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i); // перед связыванием активируем нужный текстурный юнит
 
             // Теперь устанавливаем сэмплер на нужный текстурный юнит
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+            glUniform1i(glGetUniformLocation(shader.ID, samplers[i].c_str()), i);
             // и связываем текстуру
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
-
-        // Отрисовываем меш
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // Считается хорошей практикой возвращать значения переменных к их первоначальным значениям
-        glActiveTexture(GL_TEXTURE0);
     }
 
-private:
-    // Данные для рендеринга 
-    unsigned int VBO, EBO;
-
     // Инициализируем все буферные объекты/массивы
     void setupMesh()
     {
@@ -19,6 +19,7 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include <memory>
 using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
@@ -29,68 +30,34 @@ struct HitBox {
     float height;
 };
 
-class Model 
-{
-public:
-    // Данные модели 
-    HitBox checkBox;
-    glm::vec3 position;
-    float scale;
-    glm::vec3 rotation;
-    vector<Texture> textures_loaded; // (оптимизация) сохраняем все загруженные текстуры, чтобы убедиться, что они не загружены более одного раза
-    vector<Mesh> meshes;
-    string directory;
-    bool gammaCorrection;
-    // Конструктор в качестве аргумента использует путь к 3D-модели
-    Model(string const& path, bool gamma = false, glm::vec3 position_ = { 0.0f, 0.0f, 0.0f }, float scale_ = 1.0f, glm::vec3 rotation_ = { 0.0f, 0.0f, 0.0f })
-        : gammaCorrection(gamma), position(position_), scale(scale_), rotation(rotation_)
-    {
-        loadModel(path);
-    }
-    void setScale(float newScale) { scale *= newScale; checkBox.radius *= newScale; }
-    void rotate(const glm::vec3& angles) { rotation += angles; }
-    // Отрисовываем модель, а значит и все её меши
-    void Draw(Shader shader) {
-        glm::mat4 modelMatrix = glm::mat4(1.0f);
-        modelMatrix = glm::translate(modelMatrix, position);
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.x), glm::vec3(1, 0, 0));
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.y), glm::vec3(0, 1, 0));
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.z), glm::vec3(0, 0, 1));
-        modelMatrix = glm::scale(modelMatrix, glm::vec3(1.0f) * scale);
-        shader.setMat4("model", modelMatrix);
-
-        for (unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
-    }
+//--Декодированная текстура в памяти (без GL)
+struct TextureImage {
+    string type;
+    string path;
+    int width = 0, height = 0, components = 0;
+    vector<unsigned char> pixels;
+};
 
-    void move(glm::vec3 direction) {
-        position += direction;
-        checkBox.position += direction;
-    }
-private:
-    // Загружаем модель с помощью Assimp и сохраняем полученные меши в векторе meshes
-    void loadModel(string const &path)
-    {
-        // Чтение файла с помощью Assimp
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // Проверка на ошибки
-        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // если НЕ 0
-        {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
-        }
-		
-        // Получение пути к файлу
-        directory = path.substr(0, path.find_last_of('/'));
+bool DecodeTexture(const string &filename, TextureImage &image);
+unsigned int UploadTexture(const TextureImage &image);
 
-        // Рекурсивная обработка корневого узла Assimp
-        processNode(scene->mRootNode, scene);
+//--Результат разбора файла модели: вершины, индексы и декодированные текстуры.
+//  GL не используется, поэтому разбор можно выполнять в фоновом потоке
+struct ModelSource {
+    struct MeshData {
+        vector<Vertex> vertices;
+        vector<unsigned int> indices;
+        vector<unsigned int> textures; // Индексы в images
+    };
+    vector<MeshData> meshes;
+    vector<TextureImage> images;
+    string directory;
+    bool ok = false;
 
-        //Генерацию Хит-бокса исходя из модели (цилиндрическая)
-        checkBox = generateHitBox();
-    }
+    // Загружаем модель с помощью Assimp и сохраняем полученные меши в векторе meshes
+    static ModelSource parse(string const &path);
 
+private:
     // Рекурсивная обработка узла. Обрабатываем каждый отдельный меш, расположенный в узле, и повторяем этот процесс для своих дочерних углов (если таковы вообще имеются)
     void processNode(aiNode *node, const aiScene *scene)
     {
@@ -100,7 +67,7 @@ private:
             // Узел содержит только индексы объектов в сцене.
             // Сцена же содержит все данные; узел - это лишь способ организации данных
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            processMesh(mesh, scene);
         }
         // После того, как мы обработали все меши (если таковые имелись), мы начинаем рекурсивно обрабатывать каждый из дочерних узлов
         for(unsigned int i = 0; i < node->mNumChildren; i++)
@@ -110,53 +77,13 @@ private:
 
     }
 
-    HitBox generateHitBox() {
-        HitBox hitbox;
-        glm::vec3 min(FLT_MAX, FLT_MAX, FLT_MAX);
-        glm::vec3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-
-        // Обходим все меши в сцене/
-        for (const auto mesh : meshes) {
-            //const aiMesh* mesh = scene->mMeshes[m];
-
-            // Обходим все вершины меша
-            for (const auto& vertex : mesh.vertices) {
-
-                // Обновляем минимальные и максимальные значения
-                min.x = std::min(min.x, vertex.Position.x);
-                min.y = std::min(min.y, vertex.Position.y);
-                min.z = std::min(min.z, vertex.Position.z);
-
-                max.x = std::max(max.x, vertex.Position.x);
-                max.y = std::max(max.y, vertex.Position.y);
-                max.z = std::max(max.z, vertex.Position.z);
-            }
-        }
-
-        // Вычисляем радиус как максимальное расстояние по XZ-плоскости
-        float extentX = (max.x - min.x) / 2.0f;
-        float extentZ = (max.z - min.z) / 2.0f;
-        hitbox.radius = std::max(extentX, extentZ);
-
-        // Вычисляем высоту
-        hitbox.height = max.y - min.y;
-
-        // Центр основания цилиндра 
-        hitbox.position = glm::vec3(
-            (min.x + max.x) / 2.0f,
-            min.y,
-            (min.z + max.z) / 2.0f
-        );
-
-        return hitbox;
-    }
-
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    void processMesh(aiMesh *mesh, const aiScene *scene)
     {
         // Данные для заполнения
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        MeshData data;
+        vector<Vertex>& vertices = data.vertices;
+        vector<unsigned int>& indices = data.indices;
+        vector<unsigned int>& textures = data.textures;
 
         // Цикл по всем вершинам меша
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -224,30 +151,30 @@ private:
         // нормали - texture_normalN
 
         // 1. Диффузные карты
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+        vector<unsigned int> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
 		
         // 2. Карты отражения
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+        vector<unsigned int> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
         textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 		
         // 3. Карты нормалей
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+        std::vector<unsigned int> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
         textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
 		
         // 4. Карты высот
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+        std::vector<unsigned int> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
         
-        // Возвращаем меш-объект, созданный на основе полученных данных
-        return Mesh(vertices, indices, textures);
+        // Сохраняем данные меша; GL-объекты создаются позже, в ModelAsset::upload
+        meshes.push_back(std::move(data));
     }
     
-    // Проверяем все текстуры материалов заданного типа и загружам текстуры, если они еще не были загружены.
-    // Необходимая информация возвращается в виде структуры Texture
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // Проверяем все текстуры материалов заданного типа и декодируем текстуры, если они еще не были загружены.
+    // Возвращаются индексы изображений в массиве images
+    vector<unsigned int> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
     {
-        vector<Texture> textures;
+        vector<unsigned int> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
@@ -255,69 +182,258 @@ private:
 			
             // Проверяем, не была ли текстура загружена ранее, и если - да, то пропускаем загрузку новой текстуры и переходим к следующей итерации
             bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            for(unsigned int j = 0; j < images.size(); j++)
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+                if(std::strcmp(images[j].path.data(), str.C_Str()) == 0)
                 {
-                    textures.push_back(textures_loaded[j]);
+                    textures.push_back(j);
                     skip = true; // текстура с тем же путем к файлу уже загружена, переходим к следующей (оптимизация)
                     break;
                 }
             }
             if(!skip)
-            {   // если текстура еще не была загружена, то загружаем её
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture); // сохраняем текстуру в массиве с уже загруженными текстурами, тем самым гарантируя, что у нас не появятся без необходимости дубликаты текстур
+            {   // если текстура еще не была загружена, то декодируем её
+                TextureImage image;
+                DecodeTexture(directory + '/' + str.C_Str(), image);
+                image.type = typeName;
+                image.path = str.C_Str();
+                textures.push_back(unsigned(images.size()));
+                images.push_back(std::move(image)); // сохраняем текстуру в массиве с уже загруженными текстурами, тем самым гарантируя, что у нас не появятся без необходимости дубликаты текстур
             }
         }
         return textures;
     }
 };
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+ModelSource ModelSource::parse(string const &path)
+{
+    ModelSource source;
+
+    // Чтение файла с помощью Assimp
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    // Проверка на ошибки
+    if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // если НЕ 0
+    {
+        cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+        return source;
+    }
+
+    // Получение пути к файлу
+    source.directory = path.substr(0, path.find_last_of('/'));
+
+    // Рекурсивная обработка корневого узла Assimp
+    source.processNode(scene->mRootNode, scene);
+    source.ok = true;
+    return source;
+}
+
+//--GPU-данные модели, общие для всех её копий. Перезагрузка подменяет их содержимое,
+//  поэтому новая геометрия сразу видна каждой копии модели
+struct ModelAsset {
+    string path;
+    vector<Mesh> meshes;
+    vector<Texture> textures_loaded;
+    uint32_t version = 0; // Растёт при каждой загрузке: построенные по мешам кэши устаревают
+    HitBox hitBox{};      // Цилиндр вокруг мешей в координатах модели; пересчитывается при каждой загрузке
+
+    // Создание текстур и буферов из разобранной модели (только из потока с GL-контекстом)
+    void upload(ModelSource&& source);
+    void release();
+
+private:
+    void generateHitBox();
+};
+
+void ModelAsset::upload(ModelSource&& source)
+{
+    release();
+
+    for (const TextureImage& image : source.images)
+        textures_loaded.push_back({ UploadTexture(image), image.type, image.path });
+
+    meshes.reserve(source.meshes.size());
+    for (ModelSource::MeshData& data : source.meshes)
+    {
+        vector<Texture> textures;
+        for (unsigned int index : data.textures)
+            textures.push_back(textures_loaded[index]);
+        meshes.push_back(Mesh(std::move(data.vertices), std::move(data.indices), std::move(textures)));
+    }
+    //Генерацию Хит-бокса исходя из модели (цилиндрическая)
+    generateHitBox();
+    version++;
+}
+
+void ModelAsset::generateHitBox()
+{
+    glm::vec3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+    glm::vec3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    // Обходим все меши в сцене/
+    for (const auto& mesh : meshes) {
+        // Обходим все вершины меша
+        for (const auto& vertex : mesh.vertices) {
+
+            // Обновляем минимальные и максимальные значения
+            min.x = std::min(min.x, vertex.Position.x);
+            min.y = std::min(min.y, vertex.Position.y);
+            min.z = std::min(min.z, vertex.Position.z);
+
+            max.x = std::max(max.x, vertex.Position.x);
+            max.y = std::max(max.y, vertex.Position.y);
+            max.z = std::max(max.z, vertex.Position.z);
+        }
+    }
+
+    // Вычисляем радиус как максимальное расстояние по XZ-плоскости
+    float extentX = (max.x - min.x) / 2.0f;
+    float extentZ = (max.z - min.z) / 2.0f;
+    hitBox.radius = std::max(extentX, extentZ);
+
+    // Вычисляем высоту
+    hitBox.height = max.y - min.y;
+
+    // Центр основания цилиндра 
+    hitBox.position = glm::vec3(
+        (min.x + max.x) / 2.0f,
+        min.y,
+        (min.z + max.z) / 2.0f
+    );
+}
+
+void ModelAsset::release()
+{
+    for (Mesh& mesh : meshes)
+        mesh.release();
+    meshes.clear();
+    for (const Texture& texture : textures_loaded)
+        glDeleteTextures(1, &texture.id);
+    textures_loaded.clear();
+}
+
+class Model 
+{
+public:
+    // Данные модели 
+    glm::vec3 position;
+    float scale;
+    glm::vec3 rotation;
+    std::shared_ptr<ModelAsset> asset; // Меши и текстуры, общие для всех копий модели
+    bool gammaCorrection;
+    // Конструктор в качестве аргумента использует путь к 3D-модели
+    Model(string const& path, bool gamma = false, glm::vec3 position_ = { 0.0f, 0.0f, 0.0f }, float scale_ = 1.0f, glm::vec3 rotation_ = { 0.0f, 0.0f, 0.0f })
+        : gammaCorrection(gamma), position(position_), scale(scale_), rotation(rotation_)
+    {
+        loadModel(path);
+    }
+    const vector<Mesh>& getMeshes() const { return asset->meshes; }
+    void setScale(float newScale) { scale *= newScale; boxScale *= newScale; }
+    // Хит-бокс строится из ассета при каждом запросе, поэтому после перезагрузки модели он сразу новый
+    HitBox checkBox() const {
+        return { asset->hitBox.position + boxOffset, asset->hitBox.radius * boxScale, asset->hitBox.height * boxScale };
+    }
+    void rotate(const glm::vec3& angles) { rotation += angles; }
+    // Отрисовываем модель, а значит и все её меши. Шейдер по ссылке: копия тянула бы за собой строки путей
+    void Draw(Shader& shader) const {
+        shader.setMat4("model", getModelMatrix());
+
+        for (unsigned int i = 0; i < asset->meshes.size(); i++)
+            asset->meshes[i].Draw(shader);
+    }
+    // Отрисовка с готовой матрицей модели (например, из системы анимаций)
+    void Draw(Shader& shader, const glm::mat4& modelMatrix) const {
+        shader.setMat4("model", modelMatrix);
+
+        for (unsigned int i = 0; i < asset->meshes.size(); i++)
+            asset->meshes[i].Draw(shader);
+    }
+    // Инстансная отрисовка всех мешей модели (матрицы экземпляров лежат в instanceVBO)
+    void DrawInstanced(Shader& shader, unsigned int instanceVBO, unsigned int count, unsigned int first = 0) {
+        for (unsigned int i = 0; i < asset->meshes.size(); i++)
+            asset->meshes[i].DrawInstanced(shader, instanceVBO, count, first);
+    }
+    // Матрица модели: перенос, поворот (X, Y, Z) и масштаб
+    glm::mat4 getModelMatrix() const {
+        glm::mat4 modelMatrix = glm::mat4(1.0f);
+        modelMatrix = glm::translate(modelMatrix, position);
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.x), glm::vec3(1, 0, 0));
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.y), glm::vec3(0, 1, 0));
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.z), glm::vec3(0, 0, 1));
+        modelMatrix = glm::scale(modelMatrix, glm::vec3(1.0f) * scale);
+        return modelMatrix;
+    }
+
+    void move(glm::vec3 direction) {
+        position += direction;
+        boxOffset += direction;
+    }
+private:
+    float boxScale = 1.0f;            // Масштаб и сдвиг хит-бокса относительно ассета (setScale, move)
+    glm::vec3 boxOffset{ 0.0f };
+
+    // Разбираем файл и загружаем меши в GPU
+    void loadModel(string const &path)
+    {
+        asset = std::make_shared<ModelAsset>();
+        asset->path = path;
+
+        ModelSource source = ModelSource::parse(path);
+        if (!source.ok)
+            return;
+        asset->upload(std::move(source));
+    }
+};
+
+bool DecodeTexture(const string &filename, TextureImage &image)
 {
-    string filename = string(path);
-    filename = directory + '/' + filename;
+    unsigned char *data = stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0);
+    if (!data)
+        return false;
+    image.pixels.assign(data, data + size_t(image.width) * image.height * image.components);
+    stbi_image_free(data);
+    return true;
+}
 
+unsigned int UploadTexture(const TextureImage &image)
+{
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    if (!image.pixels.empty())
     {
         GLenum format;
-        if (nrComponents == 1)
+        if (image.components == 1)
             format = GL_RED;
-        else if (nrComponents == 3)
+        else if (image.components == 3)
             format = GL_RGB;
-        else if (nrComponents == 4)
+        else if (image.components == 4)
             format = GL_RGBA;
 
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.data());
         glGenerateMipmap(GL_TEXTURE_2D);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
     }
     else
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        std::cout << "Texture failed to load at path: " << image.path << std::endl;
     }
 
     return textureID;
 }
 
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+{
+    TextureImage image;
+    image.path = path;
+    DecodeTexture(directory + '/' + string(path), image);
+    return UploadTexture(image);
+}
 
-#endif
 
+#endif
@@ -0,0 +1,392 @@
+#pragma once
+#include "rules.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define NNUE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define NNUE_AVX2
+#else
+#define NNUE_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+//--Небольшая сеть оценки в духе NNUE: вход — фигура на поле (4 вида x 64 бита позиции) с точки зрения
+//  каждой стороны, первый слой ведётся инкрементально (аккумулятор int16 на сторону), дальше
+//  целочисленные слои: ClippedReLU -> uint8, слой 2 — uint8 x int8 -> int32, выход — int32.
+//  Ядра слоёв есть в AVX2 и скалярном виде; AVX2 выбирается при запуске, если процессор его умеет
+class NnueNetwork {
+public:
+    static constexpr int INPUTS = 4 * 64;   // [своя простая, своя дамка, чужая простая, чужая дамка][поле]
+    static constexpr int HIDDEN = 128;      // Нейронов первого слоя на сторону
+    static constexpr int L2 = 32;
+    static constexpr int L2_SHIFT = 6;      // Масштаб int32 -> uint8 после второго слоя
+    static constexpr int OUTPUT_SCALE = 16; // Выход сети / OUTPUT_SCALE — оценка в сотых шашки
+    static constexpr uint32_t VERSION = 1;
+
+    alignas(32) int16_t w1[INPUTS][HIDDEN];
+    alignas(32) int16_t b1[HIDDEN];
+    alignas(32) int8_t w2[L2][2 * HIDDEN]; // Вход: аккумулятор стороны, чей ход, затем соперника
+    alignas(32) int32_t b2[L2];
+    alignas(32) int32_t w3[L2];
+    int32_t b3 = 0;
+    Variant variant = Variant::RUSSIAN;
+
+    bool load(const std::string& path, std::string& error);
+    bool save(const std::string& path) const;
+    // Сеть, считающая только материал (100 за простую, 300 за дамку): стартовые веса до обучения
+    void initMaterial(Variant v);
+    void randomize(uint32_t seed);
+
+    static bool hasAvx2();
+    static inline bool useAvx2 = hasAvx2(); // Можно выключить, чтобы сравнить со скалярными ядрами
+
+    // Аккумулятор с нуля: смещения плюс строки весов признаков (count штук)
+    void refresh(int16_t* acc, const uint16_t* features, int count) const;
+    // Строка весов признака прибавляется к аккумулятору или вычитается из него
+    static void addRow(int16_t* acc, const int16_t* row);
+    static void subRow(int16_t* acc, const int16_t* row);
+    // Слои после первого: два аккумулятора -> оценка (в единицах выхода сети)
+    int32_t forward(const int16_t* own, const int16_t* enemy) const;
+
+private:
+    struct Header {
+        char magic[4];   // "CKNN"
+        uint32_t version;
+        uint32_t variant;
+        uint32_t inputs, hidden, l2;
+    };
+
+    void refreshScalar(int16_t* acc, const uint16_t* features, int count) const;
+    static void addRowScalar(int16_t* acc, const int16_t* row);
+    static void subRowScalar(int16_t* acc, const int16_t* row);
+    static void layer2Scalar(const uint8_t* in, const int8_t (*w)[2 * HIDDEN], const int32_t* b, int32_t* out);
+#ifdef NNUE_X86
+    NNUE_AVX2 void refreshAvx2(int16_t* acc, const uint16_t* features, int count) const;
+    NNUE_AVX2 static void addRowAvx2(int16_t* acc, const int16_t* row);
+    NNUE_AVX2 static void subRowAvx2(int16_t* acc, const int16_t* row);
+    NNUE_AVX2 static void clipAvx2(const int16_t* acc, uint8_t* out);
+    NNUE_AVX2 static void layer2Avx2(const uint8_t* in, const int8_t (*w)[2 * HIDDEN], const int32_t* b, int32_t* out);
+#endif
+};
+
+bool NnueNetwork::hasAvx2() {
+#ifdef NNUE_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0, avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+#else
+    return false;
+#endif
+}
+
+bool NnueNetwork::load(const std::string& path, std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    Header h{};
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)) || std::memcmp(h.magic, "CKNN", 4) != 0 || h.version != VERSION) {
+        error = "не файл весов сети: " + path;
+        return false;
+    }
+    if (h.inputs != INPUTS || h.hidden != HIDDEN || h.l2 != L2) {
+        error = "другая архитектура сети в " + path;
+        return false;
+    }
+    variant = Variant(h.variant);
+    in.read(reinterpret_cast<char*>(w1), sizeof(w1));
+    in.read(reinterpret_cast<char*>(b1), sizeof(b1));
+    in.read(reinterpret_cast<char*>(w2), sizeof(w2));
+    in.read(reinterpret_cast<char*>(b2), sizeof(b2));
+    in.read(reinterpret_cast<char*>(w3), sizeof(w3));
+    in.read(reinterpret_cast<char*>(&b3), sizeof(b3));
+    if (!in) {
+        error = "файл весов обрезан: " + path;
+        return false;
+    }
+    return true;
+}
+
+bool NnueNetwork::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    Header h{ { 'C', 'K', 'N', 'N' }, VERSION, uint32_t(variant), INPUTS, HIDDEN, L2 };
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(w1), sizeof(w1));
+    out.write(reinterpret_cast<const char*>(b1), sizeof(b1));
+    out.write(reinterpret_cast<const char*>(w2), sizeof(w2));
+    out.write(reinterpret_cast<const char*>(b2), sizeof(b2));
+    out.write(reinterpret_cast<const char*>(w3), sizeof(w3));
+    out.write(reinterpret_cast<const char*>(&b3), sizeof(b3));
+    return bool(out);
+}
+
+void NnueNetwork::initMaterial(Variant v) {
+    std::memset(w1, 0, sizeof(w1));
+    std::memset(b1, 0, sizeof(b1));
+    std::memset(w2, 0, sizeof(w2));
+    std::memset(b2, 0, sizeof(b2));
+    std::memset(w3, 0, sizeof(w3));
+    b3 = 0;
+    variant = v;
+
+    // Нейрон k первого слоя считает фигуры вида k (по 4 за штуку), нейрон k второго слоя его копирует
+    for (int kind = 0; kind < 4; ++kind) {
+        for (int sq = 0; sq < 64; ++sq) w1[kind * 64 + sq][kind] = 4;
+        w2[kind][kind] = int8_t(1 << L2_SHIFT);
+    }
+    const int32_t value[4] = { 100, 300, -100, -300 };
+    for (int kind = 0; kind < 4; ++kind) w3[kind] = value[kind] * OUTPUT_SCALE / 4;
+}
+
+void NnueNetwork::randomize(uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> small(-8, 8), tiny(-2, 2);
+    for (auto& row : w1) for (auto& w : row) w = int16_t(small(rng));
+    for (auto& b : b1) b = int16_t(small(rng) + 32);
+    for (auto& row : w2) for (auto& w : row) w = int8_t(tiny(rng));
+    for (auto& b : b2) b = 0;
+    for (auto& w : w3) w = small(rng);
+    b3 = 0;
+}
+
+void NnueNetwork::refreshScalar(int16_t* acc, const uint16_t* features, int count) const {
+    int16_t sum[HIDDEN]; // Локальный массив: компилятор знает, что он не пересекается с весами
+    std::copy(b1, b1 + HIDDEN, sum);
+    for (int f = 0; f < count; ++f)
+        for (int i = 0; i < HIDDEN; ++i) sum[i] += w1[features[f]][i];
+    std::copy(sum, sum + HIDDEN, acc);
+}
+
+void NnueNetwork::addRowScalar(int16_t* acc, const int16_t* row) {
+    for (int i = 0; i < HIDDEN; ++i) acc[i] += row[i];
+}
+
+void NnueNetwork::subRowScalar(int16_t* acc, const int16_t* row) {
+    for (int i = 0; i < HIDDEN; ++i) acc[i] -= row[i];
+}
+
+void NnueNetwork::layer2Scalar(const uint8_t* in, const int8_t (*w)[2 * HIDDEN], const int32_t* b, int32_t* out) {
+    for (int j = 0; j < L2; ++j) {
+        int32_t sum = b[j];
+        for (int i = 0; i < 2 * HIDDEN; ++i) sum += int32_t(in[i]) * w[j][i];
+        out[j] = sum;
+    }
+}
+
+#ifdef NNUE_X86
+// Весь аккумулятор (128 x int16) держится в восьми регистрах, в память пишется один раз.
+// Регистры расписаны явно: цикл по массиву регистров компилятор оставляет в памяти
+void NnueNetwork::refreshAvx2(int16_t* acc, const uint16_t* features, int count) const {
+    static_assert(HIDDEN == 128, "аккумулятор занимает ровно восемь регистров AVX2");
+    const __m256i* bias = reinterpret_cast<const __m256i*>(b1);
+    __m256i s0 = _mm256_load_si256(bias), s1 = _mm256_load_si256(bias + 1);
+    __m256i s2 = _mm256_load_si256(bias + 2), s3 = _mm256_load_si256(bias + 3);
+    __m256i s4 = _mm256_load_si256(bias + 4), s5 = _mm256_load_si256(bias + 5);
+    __m256i s6 = _mm256_load_si256(bias + 6), s7 = _mm256_load_si256(bias + 7);
+    for (int f = 0; f < count; ++f) {
+        const __m256i* row = reinterpret_cast<const __m256i*>(w1[features[f]]);
+        s0 = _mm256_add_epi16(s0, _mm256_load_si256(row));
+        s1 = _mm256_add_epi16(s1, _mm256_load_si256(row + 1));
+        s2 = _mm256_add_epi16(s2, _mm256_load_si256(row + 2));
+        s3 = _mm256_add_epi16(s3, _mm256_load_si256(row + 3));
+        s4 = _mm256_add_epi16(s4, _mm256_load_si256(row + 4));
+        s5 = _mm256_add_epi16(s5, _mm256_load_si256(row + 5));
+        s6 = _mm256_add_epi16(s6, _mm256_load_si256(row + 6));
+        s7 = _mm256_add_epi16(s7, _mm256_load_si256(row + 7));
+    }
+    __m256i* out = reinterpret_cast<__m256i*>(acc);
+    _mm256_store_si256(out, s0);
+    _mm256_store_si256(out + 1, s1);
+    _mm256_store_si256(out + 2, s2);
+    _mm256_store_si256(out + 3, s3);
+    _mm256_store_si256(out + 4, s4);
+    _mm256_store_si256(out + 5, s5);
+    _mm256_store_si256(out + 6, s6);
+    _mm256_store_si256(out + 7, s7);
+}
+
+void NnueNetwork::addRowAvx2(int16_t* acc, const int16_t* row) {
+    for (int i = 0; i < HIDDEN; i += 16) {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i r = _mm256_load_si256(reinterpret_cast<const __m256i*>(row + i));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_add_epi16(a, r));
+    }
+}
+
+void NnueNetwork::subRowAvx2(int16_t* acc, const int16_t* row) {
+    for (int i = 0; i < HIDDEN; i += 16) {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i r = _mm256_load_si256(reinterpret_cast<const __m256i*>(row + i));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_sub_epi16(a, r));
+    }
+}
+
+// ClippedReLU: int16 -> [0, 127] uint8 (packus насыщает сверху на 255, поэтому сначала min)
+void NnueNetwork::clipAvx2(const int16_t* acc, uint8_t* out) {
+    const __m256i top = _mm256_set1_epi16(127);
+    for (int i = 0; i < HIDDEN; i += 32) {
+        __m256i lo = _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i)), top);
+        __m256i hi = _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i + 16)), top);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+}
+
+// uint8 x int8 по 32 байта: maddubs даёт суммы пар в int16 (127 * 127 * 2 не переполняет), madd с единицами — в int32
+void NnueNetwork::layer2Avx2(const uint8_t* in, const int8_t (*w)[2 * HIDDEN], const int32_t* b, int32_t* out) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int j = 0; j < L2; ++j) {
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < 2 * HIDDEN; i += 32) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            __m256i y = _mm256_load_si256(reinterpret_cast<const __m256i*>(w[j] + i));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, y), ones));
+        }
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+        out[j] = b[j] + _mm_cvtsi128_si32(s);
+    }
+}
+#endif
+
+void NnueNetwork::refresh(int16_t* acc, const uint16_t* features, int count) const {
+#ifdef NNUE_X86
+    if (useAvx2) return refreshAvx2(acc, features, count);
+#endif
+    refreshScalar(acc, features, count);
+}
+
+void NnueNetwork::addRow(int16_t* acc, const int16_t* row) {
+#ifdef NNUE_X86
+    if (useAvx2) return addRowAvx2(acc, row);
+#endif
+    addRowScalar(acc, row);
+}
+
+void NnueNetwork::subRow(int16_t* acc, const int16_t* row) {
+#ifdef NNUE_X86
+    if (useAvx2) return subRowAvx2(acc, row);
+#endif
+    subRowScalar(acc, row);
+}
+
+int32_t NnueNetwork::forward(const int16_t* own, const int16_t* enemy) const {
+    alignas(32) uint8_t hidden[2 * HIDDEN];
+    alignas(32) int32_t l2[L2];
+#ifdef NNUE_X86
+    if (useAvx2) {
+        clipAvx2(own, hidden);
+        clipAvx2(enemy, hidden + HIDDEN);
+        layer2Avx2(hidden, w2, b2, l2);
+    }
+    else
+#endif
+    {
+        for (int i = 0; i < HIDDEN; ++i) {
+            hidden[i] = uint8_t(std::clamp<int>(own[i], 0, 127));
+            hidden[HIDDEN + i] = uint8_t(std::clamp<int>(enemy[i], 0, 127));
+        }
+        layer2Scalar(hidden, w2, b2, l2);
+    }
+
+    int32_t sum = b3;
+    for (int j = 0; j < L2; ++j) sum += std::clamp(l2[j] >> L2_SHIFT, 0, 127) * w3[j];
+    return sum;
+}
+
+//--Оценка сетью с тем же интерфейсом, что у Evaluator<V>: аккумулятор правится на каждом ходе
+template<class V>
+class NnueEvaluator {
+public:
+    using Core = Rules<V>;
+    using Position = typename Core::Position;
+    using Move = typename Core::Move;
+    using Undo = typename Core::Undo;
+    static constexpr int HIDDEN = NnueNetwork::HIDDEN;
+
+    struct Accumulator {
+        alignas(32) int16_t v[2][HIDDEN]; // [перспектива: 0 — белые, 1 — чёрные]
+    };
+
+    explicit NnueEvaluator(const NnueNetwork* net_ = nullptr) : net(net_) {}
+    const NnueNetwork* net;
+
+    Accumulator accumulate(const Position& p) const;
+    void update(Accumulator& acc, const Move& m, const Undo& u, int side) const;
+    int evaluate(const Position& p, const Accumulator& acc) const {
+        return net->forward(acc.v[p.side], acc.v[p.side ^ 1]) / NnueNetwork::OUTPUT_SCALE;
+    }
+    int evaluate(const Position& p) const { return evaluate(p, accumulate(p)); }
+
+    // Оценка массива позиций, каждой — полным пересчётом аккумулятора. Общей работы между позициями нет:
+    // веса обоих слоёв (64 и 8 КБ) и так лежат в кэше, а сборка аккумуляторов блоком по признакам
+    // на замерах оказалась медленнее пересчёта в регистрах
+    void evaluateAll(const Position* positions, size_t count, int* out) const;
+
+private:
+    // Поле глазами чёрных — доска повёрнута на 180 градусов
+    static constexpr std::array<uint8_t, 64> MIRROR = [] {
+        std::array<uint8_t, 64> m{};
+        for (int sq = 0; sq < 64; ++sq)
+            if (Core::ROW[sq] >= 0) m[sq] = uint8_t(Core::square(V::SIZE - 1 - Core::ROW[sq], V::SIZE - 1 - Core::COL[sq]));
+        return m;
+    }();
+    // Номер входа: фигура стороны owner вида king на поле sq с точки зрения perspective
+    static int feature(int perspective, int owner, bool king, int sq) {
+        return ((owner == perspective ? 0 : 2) + king) * 64 + (perspective == 0 ? sq : MIRROR[sq]);
+    }
+    void add(Accumulator& acc, int owner, bool king, int sq) const {
+        for (int p = 0; p < 2; ++p) NnueNetwork::addRow(acc.v[p], net->w1[feature(p, owner, king, sq)]);
+    }
+    void sub(Accumulator& acc, int owner, bool king, int sq) const {
+        for (int p = 0; p < 2; ++p) NnueNetwork::subRow(acc.v[p], net->w1[feature(p, owner, king, sq)]);
+    }
+};
+
+template<class V>
+typename NnueEvaluator<V>::Accumulator NnueEvaluator<V>::accumulate(const Position& p) const {
+    Accumulator acc;
+    uint16_t features[2][64];
+    int count = 0;
+    for (int s = 0; s < 2; ++s) {
+        for (int king = 0; king < 2; ++king)
+            for (uint64_t set = king ? p.kings[s] : p.men[s]; set; set &= set - 1, ++count)
+                for (int view = 0; view < 2; ++view)
+                    features[view][count] = uint16_t(feature(view, s, king, std::countr_zero(set)));
+    }
+    net->refresh(acc.v[0], features[0], count);
+    net->refresh(acc.v[1], features[1], count);
+    return acc;
+}
+
+template<class V>
+void NnueEvaluator<V>::update(Accumulator& acc, const Move& m, const Undo& u, int side) const {
+    sub(acc, side, u.wasKing, m.from());
+    add(acc, side, u.wasKing || m.promotes, m.to());
+    for (uint64_t set = u.capturedMen; set; set &= set - 1) sub(acc, side ^ 1, false, std::countr_zero(set));
+    for (uint64_t set = u.capturedKings; set; set &= set - 1) sub(acc, side ^ 1, true, std::countr_zero(set));
+}
+
+template<class V>
+void NnueEvaluator<V>::evaluateAll(const Position* positions, size_t count, int* out) const {
+    for (size_t i = 0; i < count; ++i) out[i] = evaluate(positions[i]);
+}
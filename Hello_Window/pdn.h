@@ -0,0 +1,563 @@
+#pragma once
+#include "rules.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+//--Как вариант записывается в PDN: номер в теге GameType и нотация полей
+//  (алгебраическая a1..h8 или номера тёмных полей 1..N, поле 1 — у чёрных слева)
+template<class V> struct PdnNotation;
+template<> struct PdnNotation<RussianRules>       { static constexpr int GAME_TYPE = 25; static constexpr bool ALGEBRAIC = true; };
+template<> struct PdnNotation<EnglishRules>       { static constexpr int GAME_TYPE = 21; static constexpr bool ALGEBRAIC = false; };
+template<> struct PdnNotation<InternationalRules> { static constexpr int GAME_TYPE = 20; static constexpr bool ALGEBRAIC = false; };
+template<> struct PdnNotation<BrazilianRules>     { static constexpr int GAME_TYPE = 26; static constexpr bool ALGEBRAIC = false; };
+
+struct PdnTag {
+    std::string_view name;
+    std::string_view value; // Как в файле: экранирование \" не раскрывается
+};
+
+//--Партия из PDN: теги и ходы — срезы исходного текста, строки не копируются
+struct PdnGame {
+    std::vector<PdnTag> tags;
+    std::vector<std::string_view> moves;
+    std::string_view result;
+    size_t line = 0; // Строка, с которой начинается партия
+
+    std::string_view tag(std::string_view name) const {
+        for (const auto& t : tags)
+            if (t.name == name) return t.value;
+        return {};
+    }
+    void clear() {
+        tags.clear();
+        moves.clear();
+        result = {};
+    }
+};
+
+//--Потоковый разбор PDN: партия за партией прямо по тексту (обычно — по отображённому в память файлу).
+//  Буферы PdnGame переиспользуются, так что на ход не выделяется память
+class PdnReader {
+public:
+    explicit PdnReader(std::string_view text, size_t firstLine = 1) : text(text), line(firstLine) {}
+
+    bool next(PdnGame& game);
+    size_t offset() const { return pos; }
+    size_t currentLine() const { return line; }
+
+    static bool isResult(std::string_view token) {
+        return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*"
+            || token == "2-0" || token == "0-2" || token == "1-1" || token == "0-0";
+    }
+
+private:
+    std::string_view text;
+    size_t pos = 0;
+    size_t line = 1;
+
+    void skipSpace();
+    void skipPast(char close);
+    void skipVariation();
+    void readTag(PdnGame& game);
+    std::string_view readToken();
+};
+
+void PdnReader::skipSpace() {
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (c == '\n') line++;
+        else if (c != ' ' && c != '\t' && c != '\r') return;
+        pos++;
+    }
+}
+
+void PdnReader::skipPast(char close) {
+    while (pos < text.size() && text[pos] != close) {
+        if (text[pos] == '\n') line++;
+        pos++;
+    }
+    if (pos < text.size()) {
+        if (text[pos] == '\n') line++;
+        pos++;
+    }
+}
+
+// Варианты ( ... ) пропускаются целиком, с учётом вложенности и комментариев внутри
+void PdnReader::skipVariation() {
+    int depth = 0;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (c == '{') { skipPast('}'); continue; }
+        if (c == '\n') line++;
+        else if (c == '(') depth++;
+        else if (c == ')' && --depth == 0) { pos++; return; }
+        pos++;
+    }
+}
+
+void PdnReader::readTag(PdnGame& game) {
+    pos++; // '['
+    size_t start = pos;
+    while (pos < text.size() && text[pos] != ' ' && text[pos] != '"' && text[pos] != ']') pos++;
+    PdnTag tag{ text.substr(start, pos - start), {} };
+
+    while (pos < text.size() && text[pos] == ' ') pos++;
+    if (pos < text.size() && text[pos] == '"') {
+        start = ++pos;
+        while (pos < text.size() && text[pos] != '"' && text[pos] != '\n') {
+            if (text[pos] == '\\' && pos + 1 < text.size()) pos++;
+            pos++;
+        }
+        tag.value = text.substr(start, pos - start);
+    }
+    skipPast(']');
+    game.tags.push_back(tag);
+}
+
+std::string_view PdnReader::readToken() {
+    size_t start = pos;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '[' || c == ']'
+            || c == '{' || c == '}' || c == '(' || c == ')' || c == ';') break;
+        pos++;
+    }
+    return text.substr(start, pos - start);
+}
+
+bool PdnReader::next(PdnGame& game) {
+    game.clear();
+    bool started = false, inMoves = false;
+    for (;;) {
+        skipSpace();
+        if (pos >= text.size()) return started;
+        if (!started) { started = true; game.line = line; }
+
+        switch (text[pos]) {
+        case '[':
+            if (inMoves) return true; // Следующая партия, у этой не было результата
+            readTag(game);
+            continue;
+        case '{': skipPast('}'); continue;
+        case ';': skipPast('\n'); continue;
+        case '(': skipVariation(); continue;
+        }
+
+        inMoves = true;
+        std::string_view token = readToken();
+        if (token.empty()) { pos++; continue; } // Лишняя закрывающая скобка
+        if (token[0] == '$') continue;           // NAG
+
+        // Номер хода "12." или "12..." может быть приклеен к ходу
+        size_t digits = 0;
+        while (digits < token.size() && std::isdigit((unsigned char)token[digits])) digits++;
+        if (digits < token.size() && token[digits] == '.') {
+            while (digits < token.size() && token[digits] == '.') digits++;
+            token.remove_prefix(digits);
+            if (token.empty()) continue;
+        }
+        if (isResult(token)) {
+            game.result = token;
+            return true;
+        }
+        while (!token.empty() && (token.back() == '!' || token.back() == '?')) token.remove_suffix(1);
+        if (!token.empty()) game.moves.push_back(token);
+    }
+}
+
+//--Прогон партии PDN через ядро правил: каждый ход сверяется со списком допустимых
+template<class V>
+class PdnReplay {
+public:
+    using Core = Rules<V>;
+    using Position = typename Core::Position;
+    using Move = typename Core::Move;
+    static constexpr bool ALGEBRAIC = PdnNotation<V>::ALGEBRAIC;
+
+    // Стартовая позиция — из тега FEN или начальная расстановка
+    bool load(const PdnGame& game);
+
+    const Position& start() const { return startPos; }
+    const Position& position() const { return pos; }
+    const std::vector<Move>& line() const { return played; }
+    // Номер каждого хода в списке, который выдал Rules<V>::generate (компактная запись партии)
+    const std::vector<uint8_t>& choices() const { return picked; }
+    const std::string& error() const { return message; }
+
+    static int parseSquare(std::string_view text); // Номер бита или -1
+    static void appendSquare(std::string& out, int sq);
+    static void appendMove(std::string& out, const Move& m);
+    static bool parseFen(std::string_view fen, Position& p);
+    static std::string fen(const Position& p);
+
+private:
+    Position startPos, pos;
+    std::vector<Move> played, legal;
+    std::vector<uint8_t> picked;
+    std::string message;
+
+    const Move* match(std::string_view token);
+};
+
+template<class V>
+int PdnReplay<V>::parseSquare(std::string_view text) {
+    if (text.empty()) return -1;
+    int row, col;
+    if (std::isalpha((unsigned char)text[0])) {
+        col = std::tolower((unsigned char)text[0]) - 'a';
+        int rank = 0;
+        for (size_t i = 1; i < text.size(); ++i) {
+            if (!std::isdigit((unsigned char)text[i])) return -1;
+            rank = rank * 10 + (text[i] - '0');
+        }
+        row = Core::SIZE - rank;
+    }
+    else {
+        int n = 0;
+        for (char c : text) {
+            if (!std::isdigit((unsigned char)c)) return -1;
+            n = n * 10 + (c - '0');
+        }
+        if (n < 1 || n > Core::SIZE * Core::HALF) return -1;
+        row = (n - 1) / Core::HALF;
+        int k = (n - 1) % Core::HALF;
+        col = row % 2 == 0 ? 2 * k + 1 : 2 * k;
+    }
+    if (row < 0 || row >= Core::SIZE || col < 0 || col >= Core::SIZE) return -1;
+    return Core::square(row, col);
+}
+
+template<class V>
+void PdnReplay<V>::appendSquare(std::string& out, int sq) {
+    int row = Core::ROW[sq], col = Core::COL[sq];
+    if constexpr (ALGEBRAIC) {
+        out += char('a' + col);
+        out += std::to_string(Core::SIZE - row);
+    }
+    else
+        out += std::to_string(row * Core::HALF + col / 2 + 1);
+}
+
+// Взятие пишется полным путём, чтобы ход читался однозначно
+template<class V>
+void PdnReplay<V>::appendMove(std::string& out, const Move& m) {
+    appendSquare(out, m.from());
+    for (int i = 1; i <= m.steps; ++i) {
+        out += m.isCapture() ? 'x' : '-';
+        appendSquare(out, m.squares[i]);
+    }
+}
+
+// FEN вида "W:W21,22,K31:B1-12" — сторона хода и списки полей (K — дамка, возможны диапазоны).
+// Невозможная расстановка (поле занято дважды, простая на поле превращения, лишние шашки) — ошибка
+template<class V>
+bool PdnReplay<V>::parseFen(std::string_view fen, Position& p) {
+    p = Position{};
+    while (!fen.empty() && (fen.back() == '.' || fen.back() == ' ')) fen.remove_suffix(1);
+
+    size_t colon = fen.find(':');
+    std::string_view side = fen.substr(0, colon);
+    if (side.empty() || (side[0] != 'W' && side[0] != 'B')) return false;
+    p.side = side[0] == 'W' ? 0 : 1;
+
+    while (colon != std::string_view::npos) {
+        fen.remove_prefix(colon + 1);
+        colon = fen.find(':');
+        std::string_view field = fen.substr(0, colon);
+        if (field.empty() || (field[0] != 'W' && field[0] != 'B')) return false;
+        const int owner = field[0] == 'W' ? 0 : 1;
+        field.remove_prefix(1);
+
+        while (!field.empty()) {
+            size_t comma = field.find(',');
+            std::string_view item = field.substr(0, comma);
+            field = comma == std::string_view::npos ? std::string_view() : field.substr(comma + 1);
+            if (item.empty()) continue;
+
+            bool king = item[0] == 'K';
+            if (king) item.remove_prefix(1);
+            size_t dash = item.find('-');
+            int first = parseSquare(item.substr(0, dash));
+            int last = dash == std::string_view::npos ? first : parseSquare(item.substr(dash + 1));
+            if (first < 0 || last < 0) return false;
+
+            // Диапазон бывает только в числовой нотации: перебираем номера полей
+            for (int sq = first; sq <= last; ++sq) {
+                if (!Core::has(Core::BOARD, sq)) continue;
+                if (Core::has(p.occupied(), sq)) return false; // Две шашки на одном поле
+                (king ? p.kings[owner] : p.men[owner]) |= 1ull << sq;
+            }
+        }
+    }
+    // Позиция должна быть возможной: простые не стоят на своём поле превращения,
+    // и шашек у стороны не больше, чем в начальной расстановке
+    for (int s = 0; s < 2; ++s) {
+        if (p.men[s] & Core::PROMOTE[s]) return false;
+        if (std::popcount(p.pieces(s)) > V::ROWS * Core::HALF) return false;
+    }
+    return true;
+}
+
+template<class V>
+std::string PdnReplay<V>::fen(const Position& p) {
+    std::string out = p.side == 0 ? "W" : "B";
+    for (int owner = 0; owner < 2; ++owner) {
+        out += owner == 0 ? ":W" : ":B";
+        bool first = true;
+        for (int sq = 0; sq < 64; ++sq) {
+            bool man = Core::has(p.men[owner], sq), king = Core::has(p.kings[owner], sq);
+            if (!man && !king) continue;
+            if (!first) out += ',';
+            if (king) out += 'K';
+            appendSquare(out, sq);
+            first = false;
+        }
+    }
+    return out;
+}
+
+template<class V>
+const typename PdnReplay<V>::Move* PdnReplay<V>::match(std::string_view token) {
+    int squares[Core::MAX_CAPTURES + 1];
+    int count = 0;
+    while (!token.empty()) {
+        size_t sep = token.find_first_of("-x:");
+        if (count > Core::MAX_CAPTURES) return nullptr;
+        squares[count] = parseSquare(token.substr(0, sep));
+        if (squares[count++] < 0) return nullptr;
+        token = sep == std::string_view::npos ? std::string_view() : token.substr(sep + 1);
+    }
+    if (count < 2) return nullptr;
+
+    Core::generate(pos, legal);
+    for (const Move& m : legal) {
+        if (m.from() != squares[0] || m.to() != squares[count - 1]) continue;
+        // Промежуточные поля проверяем, только если они записаны (иначе "11x25" подходит к любому пути)
+        if (count > 2) {
+            if (count != m.steps + 1) continue;
+            bool same = true;
+            for (int i = 1; i < count - 1; ++i) same &= m.squares[i] == squares[i];
+            if (!same) continue;
+        }
+        return &m;
+    }
+    return nullptr;
+}
+
+template<class V>
+bool PdnReplay<V>::load(const PdnGame& game) {
+    played.clear();
+    picked.clear();
+    message.clear();
+
+    std::string_view setup = game.tag("FEN");
+    if (setup.empty()) startPos = Core::initial();
+    else if (!parseFen(setup, startPos)) {
+        message = "неверный тег FEN";
+        return false;
+    }
+
+    pos = startPos;
+    for (size_t i = 0; i < game.moves.size(); ++i) {
+        const Move* m = match(game.moves[i]);
+        if (!m) {
+            message = "недопустимый ход " + std::to_string(i / 2 + 1) + (i % 2 ? "... " : ". ") + std::string(game.moves[i]);
+            return false;
+        }
+        played.push_back(*m);
+        picked.push_back(uint8_t(m - legal.data()));
+        Core::apply(pos, *m);
+    }
+    return true;
+}
+
+//--Запись партии в PDN. GameType добавляется сам, FEN — если партия начата не с начальной расстановки
+template<class V>
+void writePdn(std::ostream& out, const std::vector<std::pair<std::string, std::string>>& tags,
+    const typename Rules<V>::Position& start, const std::vector<typename Rules<V>::Move>& line, std::string_view result) {
+    using Core = Rules<V>;
+    for (const auto& [name, value] : tags)
+        out << '[' << name << " \"" << value << "\"]\n";
+    out << "[GameType \"" << PdnNotation<V>::GAME_TYPE << "\"]\n";
+
+    if (start != Core::initial())
+        out << "[FEN \"" << PdnReplay<V>::fen(start) << "\"]\n";
+    out << '\n';
+
+    // Номер хода ставится перед ходом той стороны, что начинает партию по правилам варианта
+    const int firstSide = V::WHITE_STARTS ? 0 : 1;
+    std::string text, token;
+    size_t lineStart = 0;
+    int number = 1, side = start.side;
+    for (size_t i = 0; i < line.size(); ++i) {
+        token.clear();
+        if (side == firstSide) token = std::to_string(number) + ". ";
+        else if (i == 0) token = std::to_string(number) + "... ";
+        PdnReplay<V>::appendMove(token, line[i]);
+        if (side != firstSide) number++;
+        side ^= 1;
+
+        if (text.size() - lineStart + token.size() > 79) { text += '\n'; lineStart = text.size(); }
+        else if (!text.empty()) text += ' ';
+        text += token;
+    }
+    if (text.size() - lineStart + result.size() > 79) text += '\n';
+    else if (!text.empty()) text += ' ';
+    out << text << result << "\n\n";
+}
+
+// Вариант по тегу GameType (учитывается только первое число тега)
+bool variantFromGameType(std::string_view gameType, Variant& out) {
+    int type = 0;
+    size_t i = 0;
+    for (; i < gameType.size() && std::isdigit((unsigned char)gameType[i]); ++i)
+        type = type * 10 + (gameType[i] - '0');
+    if (i == 0) return false;
+    for (Variant v : { Variant::RUSSIAN, Variant::ENGLISH, Variant::INTERNATIONAL, Variant::BRAZILIAN }) {
+        if (dispatchVariant(v, [](auto traits) { return PdnNotation<decltype(traits)>::GAME_TYPE; }) == type) {
+            out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+//--Партия PDN для сцены: стартовая расстановка и ходы в координатах доски
+bool loadPdnGame(Variant variant, const PdnGame& game, GameRules::Cells& cells, bool& whiteToMove,
+    std::vector<GameRules::PathMove>& moves, std::string& error) {
+    return dispatchVariant(variant, [&](auto traits) {
+        using V = decltype(traits);
+        PdnReplay<V> replay;
+        if (!replay.load(game)) {
+            error = replay.error();
+            return false;
+        }
+        Rules<V>::toCells(replay.start(), cells);
+        whiteToMove = replay.start().side == 0;
+        moves.clear();
+        for (const auto& m : replay.line())
+            moves.push_back(VariantRules<V>::toPath(m));
+        return true;
+        });
+}
+
+//--Запись партии сцены: ходы в координатах доски переводятся в нотацию варианта
+void savePdnGame(Variant variant, std::ostream& out, const std::vector<std::pair<std::string, std::string>>& tags,
+    const GameRules::Cells& cells, bool whiteToMove, const std::vector<GameRules::PathMove>& moves, std::string_view result) {
+    dispatchVariant(variant, [&](auto traits) {
+        using V = decltype(traits);
+        using Core = Rules<V>;
+        std::vector<typename Core::Move> line;
+        for (const auto& pm : moves) {
+            typename Core::Move& m = line.emplace_back();
+            m.steps = uint8_t(pm.path.size() - 1);
+            for (size_t i = 0; i < pm.path.size(); ++i)
+                m.squares[i] = uint8_t(Core::square(pm.path[i].first, pm.path[i].second));
+            for (size_t i = 0; i < pm.taken.size(); ++i) {
+                m.taken[i] = uint8_t(Core::square(pm.taken[i].first, pm.taken[i].second));
+                m.captured |= 1ull << m.taken[i];
+            }
+            m.promotes = pm.promotes;
+        }
+        writePdn<V>(out, tags, Core::fromCells(cells, whiteToMove ? 0 : 1), line, result);
+        });
+}
+
+//--Разбиение архива на parts кусков по границам партий (для параллельной обработки).
+//  Граница — строка тега, перед которой стоит строка ходов. Возвращает смещения начала кусков и конец текста
+std::vector<size_t> splitPdnArchive(std::string_view text, size_t parts) {
+    auto gameStartAfter = [&](size_t from) {
+        size_t p = from;
+        while ((p = text.find("\n[", p)) != std::string_view::npos) {
+            size_t prevEnd = p;
+            while (prevEnd > 0 && (text[prevEnd - 1] == '\r' || text[prevEnd - 1] == '\n' || text[prevEnd - 1] == ' ')) prevEnd--;
+            size_t prevStart = text.rfind('\n', prevEnd ? prevEnd - 1 : 0);
+            prevStart = prevStart == std::string_view::npos ? 0 : prevStart + 1;
+            if (prevEnd > prevStart && text[prevStart] != '[') return p + 1;
+            p += 2;
+        }
+        return text.size();
+    };
+
+    std::vector<size_t> bounds{ 0 };
+    for (size_t i = 1; i < parts; ++i) {
+        size_t b = gameStartAfter(std::max(bounds.back(), text.size() * i / parts));
+        if (b >= text.size()) break;
+        bounds.push_back(b);
+    }
+    bounds.push_back(text.size());
+    return bounds;
+}
+
+// Потоков на архив: по одному на мегабайт текста, не больше числа ядер
+size_t pdnWorkers(std::string_view text) {
+    return std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), text.size() / (1 << 20) + 1));
+}
+
+//--Проверка архива PDN: каждая партия прогоняется через генератор ходов своего варианта
+//  (по тегу GameType, иначе fallback). Куски архива проверяются параллельно
+struct PdnCheckStats {
+    size_t games = 0;
+    size_t moves = 0;
+    size_t invalid = 0;
+    std::vector<std::string> errors; // Первые ошибки с номерами строк
+};
+
+PdnCheckStats checkPdnArchive(std::string_view text, Variant fallback, size_t maxErrors = 10) {
+    const std::vector<size_t> bounds = splitPdnArchive(text, pdnWorkers(text));
+    struct Chunk {
+        PdnCheckStats stats;
+        size_t lines = 0;
+        std::vector<std::pair<size_t, std::string>> errors; // Строка внутри куска и сообщение
+    };
+    std::vector<Chunk> chunks(bounds.size() - 1);
+
+    auto work = [&](size_t index) {
+        Chunk& chunk = chunks[index];
+        PdnReader reader(text.substr(bounds[index], bounds[index + 1] - bounds[index]), 0);
+        PdnGame game;
+        std::tuple<PdnReplay<RussianRules>, PdnReplay<EnglishRules>, PdnReplay<InternationalRules>, PdnReplay<BrazilianRules>> replays;
+        while (reader.next(game)) {
+            if (game.moves.empty() && game.tags.empty()) continue;
+            Variant variant = fallback;
+            variantFromGameType(game.tag("GameType"), variant);
+            dispatchVariant(variant, [&](auto traits) {
+                auto& replay = std::get<PdnReplay<decltype(traits)>>(replays);
+                chunk.stats.games++;
+                if (!replay.load(game)) {
+                    chunk.stats.invalid++;
+                    if (chunk.errors.size() < maxErrors) chunk.errors.emplace_back(game.line, replay.error());
+                }
+                chunk.stats.moves += replay.line().size();
+                });
+        }
+        chunk.lines = reader.currentLine();
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < chunks.size(); ++i) pool.emplace_back(work, i);
+    work(0);
+    for (auto& t : pool) t.join();
+
+    PdnCheckStats total;
+    size_t lineBase = 1;
+    for (const Chunk& chunk : chunks) {
+        total.games += chunk.stats.games;
+        total.moves += chunk.stats.moves;
+        total.invalid += chunk.stats.invalid;
+        for (const auto& [line, message] : chunk.errors)
+            if (total.errors.size() < maxErrors)
+                total.errors.push_back("строка " + std::to_string(lineBase + line) + ": " + message);
+        lineBase += chunk.lines;
+    }
+    return total;
+}
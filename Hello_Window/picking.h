@@ -0,0 +1,184 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+//--Выбор по буферу номеров: основной проход рисует в свой кадровый буфер, где рядом с цветом лежит
+//  номер объекта (R32UI) под каждым пикселем. Номер и глубина пикселя под курсором копируются в буфер
+//  упаковки пикселей, а читаются кадром позже, когда забор сообщит, что GPU их дописал: glReadPixels
+//  в память процесса не вызывается, и конвейер не останавливается
+class IdPicker {
+public:
+    static constexpr uint32_t NONE = 0;
+
+    struct Result {
+        uint32_t id = NONE;
+        float depth = 1.0f;         // Глубина окна [0, 1]; 1 — фон
+        int x = 0, y = 0;           // Пиксель от нижнего левого угла
+        double requested = 0.0;     // Время запроса
+        int frames = 0;             // Через сколько основных проходов пришёл ответ
+        uint32_t tag = 0;           // Метка запроса (что делать с ответом — решает вызывающий)
+    };
+
+    IdPicker(int width, int height);
+    ~IdPicker();
+    IdPicker(const IdPicker&) = delete;
+    IdPicker& operator=(const IdPicker&) = delete;
+
+    void resize(int width, int height);
+    // Основной проход: цвет и номера объектов (очищены в NONE) в свой кадровый буфер
+    void begin();
+    // Копирование запрошенного пикселя и перенос цвета в окно. Интерфейс рисуется после — прямо в окно
+    void end();
+    // Пиксель прочитается в конце ближайшего основного прохода; новый запрос до него заменяет старый
+    void request(int x, int y, double time, uint32_t tag);
+    // Готовый ответ (по одному, в порядке запросов); false — пока нет
+    bool poll(Result& out);
+    bool pending() const;
+
+private:
+    static constexpr int SLOTS = 3;  // Столько запросов может ждать GPU одновременно
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        Result result;
+    };
+    Slot slots[SLOTS];
+    int nextSlot = 0;
+    bool queued = false;
+    Result queuedRequest;
+
+    GLuint fbo = 0, colorBuffer = 0, idBuffer = 0, depthBuffer = 0;
+    int width = 0, height = 0;
+    void createTargets();
+    void destroyTargets();
+};
+
+IdPicker::IdPicker(int width_, int height_) : width(width_), height(height_) {
+    for (Slot& slot : slots) {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(uint32_t) + sizeof(float), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    createTargets();
+}
+
+IdPicker::~IdPicker() {
+    for (Slot& slot : slots) {
+        if (slot.fence) glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.pbo);
+    }
+    destroyTargets();
+}
+
+void IdPicker::createTargets() {
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    auto attach = [this](GLuint& buffer, GLenum format, GLenum attachment) {
+        glGenRenderbuffers(1, &buffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, buffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, buffer);
+    };
+    attach(colorBuffer, GL_RGBA8, GL_COLOR_ATTACHMENT0);
+    attach(idBuffer, GL_R32UI, GL_COLOR_ATTACHMENT1);
+    attach(depthBuffer, GL_DEPTH_COMPONENT24, GL_DEPTH_ATTACHMENT);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: буфер номеров для выбора не собран\n";
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void IdPicker::destroyTargets() {
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &idBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glDeleteFramebuffers(1, &fbo);
+}
+
+void IdPicker::resize(int width_, int height_) {
+    if (width_ == width && height_ == height) return;
+    width = width_;
+    height = height_;
+    destroyTargets();
+    createTargets();
+}
+
+void IdPicker::begin() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    // glClear для целочисленного буфера не определён: цвет и глубина чистятся отдельно от номеров
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    const GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, buffers);
+    const GLuint none[4] = { NONE, 0, 0, 0 };
+    glClearBufferuiv(GL_COLOR, 1, none);
+}
+
+void IdPicker::end() {
+    for (Slot& slot : slots)
+        if (slot.fence) slot.result.frames++;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    Slot& slot = slots[nextSlot];
+    if (queued && !slot.fence) {
+        // Номер и глубина — в один буфер упаковки; копирование идёт на GPU, возврат сразу
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glReadBuffer(GL_COLOR_ATTACHMENT1);
+        glReadPixels(queuedRequest.x, queuedRequest.y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, (void*)0);
+        glReadPixels(queuedRequest.x, queuedRequest.y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, (void*)sizeof(uint32_t));
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.result = queuedRequest;
+        slot.result.frames = 0;
+        queued = false;
+        nextSlot = (nextSlot + 1) % SLOTS;
+    }
+
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void IdPicker::request(int x, int y, double time, uint32_t tag) {
+    queuedRequest = Result{};
+    queuedRequest.x = x < 0 ? 0 : x >= width ? width - 1 : x;
+    queuedRequest.y = y < 0 ? 0 : y >= height ? height - 1 : y;
+    queuedRequest.requested = time;
+    queuedRequest.tag = tag;
+    queued = true;
+}
+
+bool IdPicker::poll(Result& out) {
+    // Ответы отдаются в порядке запросов: слоты занимаются по кругу, самый старый ждущий — первый
+    // занятый начиная с nextSlot. Пока его забор не сработал, более новые ответы ждут
+    for (int i = 0; i < SLOTS; ++i) {
+        Slot& slot = slots[(nextSlot + i) % SLOTS];
+        if (!slot.fence) continue;
+        const GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        out = slot.result;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        if (const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(uint32_t) + sizeof(float), GL_MAP_READ_BIT)) {
+            std::memcpy(&out.id, data, sizeof(uint32_t));
+            std::memcpy(&out.depth, static_cast<const char*>(data) + sizeof(uint32_t), sizeof(float));
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return true;
+    }
+    return false;
+}
+
+bool IdPicker::pending() const {
+    if (queued) return true;
+    for (const Slot& slot : slots)
+        if (slot.fence) return true;
+    return false;
+}
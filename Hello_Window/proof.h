@@ -0,0 +1,311 @@
+#pragma once
+#include "rules.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+//--Решатель df-pn (поиск по числам доказательства в глубину): доказывает выигрыш стороны, чей ход в корне
+//  (атакующего), или что его нет. Числа узла (phi, delta) — в смысле стороны, чей ход в узле: phi — цена
+//  доказать её выигрыш, delta — опровергнуть. Узлы хранятся только в таблице ограниченного размера;
+//  из корзины вытесняется запись, на которую ушло меньше всего работы.
+//  Ничья (повторение на пути или партия длиннее MAX_PLY) — не выигрыш атакующего. Такая оценка зависит
+//  от пути и может попасть в таблицу через родителя: ничьи по повторению решатель видит не всегда точно,
+//  зато выигрыш, который он доказал, настоящий — в дереве доказательства ничьих нет
+template<class V>
+class ProofSolver {
+public:
+    using Core = Rules<V>;
+    using Position = typename Core::Position;
+    using Move = typename Core::Move;
+
+    static constexpr uint32_t INF = 1u << 30;
+    static constexpr int MAX_PLY = 160;
+
+    enum class Outcome { WIN, NO_WIN, UNKNOWN };   // NO_WIN — проигрыш или ничья; UNKNOWN — не хватило времени
+
+    struct Result {
+        Outcome outcome = Outcome::UNKNOWN;
+        Move best{};                 // Выигрывающий ход (для WIN)
+        std::vector<Move> line;      // Вариант: атакующий — доказанный ход, защита — самый упорный
+        uint64_t nodes = 0;          // Раскрытых узлов
+        uint64_t proofSize = 0;      // Позиций в дереве доказательства (для WIN)
+        uint64_t proofMissing = 0;   // Ветвей дерева, вытесненных из таблицы: дерево не меньше proofSize
+        double seconds = 0.0;
+        uint64_t probes = 0, hits = 0, stores = 0, replaced = 0; // Таблица: запросы, попадания, записи, вытеснения
+        size_t entries = 0;          // Размер таблицы
+    };
+
+    const std::atomic<bool>* abort = nullptr; // Поднятый флаг прерывает решение (проверка раз в 4096 узлов)
+
+    explicit ProofSolver(size_t megabytes = 64);
+    // Решение до seconds (<= 0 — без ограничения) или maxNodes узлов (0 — без ограничения)
+    Result solve(const Position& root, double seconds, uint64_t maxNodes = 0);
+
+private:
+    struct Entry {
+        uint64_t key = 0;
+        uint32_t phi = 1, delta = 1;
+        uint32_t work = 0;           // 0 — пустая запись
+    };
+    static constexpr size_t WAYS = 4; // Записей в корзине
+    struct Child {
+        uint64_t key;
+        uint32_t phi, delta;
+        bool draw;                   // Числа ничьей зависят от пути и в таблицу не пишутся
+    };
+
+    std::vector<Entry> table;
+    size_t bucketMask = 0;
+    std::vector<Move> moves[MAX_PLY + 1];
+    std::vector<Child> children[MAX_PLY + 1];
+    uint64_t path[MAX_PLY + 1] = {};
+    int attacker = 0;
+    Result stats;
+    std::chrono::steady_clock::time_point deadline;
+    bool timed = false, stopped = false;
+    uint64_t nodeLimit = 0;
+
+    const Entry* find(uint64_t key) const;
+    void store(uint64_t key, uint32_t phi, uint32_t delta, uint64_t work);
+    // Числа позиции p (ход уже сделан), стоящей на пути на уровне ply
+    void childNumbers(const Position& p, int ply, Child& child);
+    void mid(Position& p, uint64_t key, uint32_t thPhi, uint32_t thDelta, int ply, uint32_t& phiOut, uint32_t& deltaOut);
+    uint64_t proofTree(Position& p, uint64_t key, int ply, std::unordered_set<uint64_t>& seen);
+    void mainLine(Position p, uint64_t key);
+};
+
+template<class V>
+ProofSolver<V>::ProofSolver(size_t megabytes) {
+    size_t buckets = 1;
+    while (buckets * 2 * WAYS * sizeof(Entry) <= std::max<size_t>(megabytes, 1) << 20) buckets *= 2;
+    table.resize(buckets * WAYS);
+    bucketMask = buckets - 1;
+    for (auto& list : moves) list.reserve(32);
+    for (auto& list : children) list.reserve(32);
+}
+
+template<class V>
+const typename ProofSolver<V>::Entry* ProofSolver<V>::find(uint64_t key) const {
+    const Entry* bucket = &table[(key & bucketMask) * WAYS];
+    for (size_t i = 0; i < WAYS; ++i)
+        if (bucket[i].work && bucket[i].key == key) return &bucket[i];
+    return nullptr;
+}
+
+template<class V>
+void ProofSolver<V>::store(uint64_t key, uint32_t phi, uint32_t delta, uint64_t work) {
+    stats.stores++;
+    Entry* bucket = &table[(key & bucketMask) * WAYS];
+    Entry* slot = &bucket[0];
+    for (size_t i = 0; i < WAYS; ++i) {
+        if (bucket[i].work && bucket[i].key == key) {
+            slot = &bucket[i];
+            break;
+        }
+        if (bucket[i].work < slot->work) slot = &bucket[i];
+    }
+    if (slot->work && slot->key != key) stats.replaced++;
+    // Работа накапливается: запись, в которую вложено много узлов, дольше не вытесняется
+    const uint64_t total = (slot->key == key ? slot->work : 0) + std::max<uint64_t>(work, 1);
+    *slot = { key, phi, delta, uint32_t(std::min<uint64_t>(total, UINT32_MAX)) };
+}
+
+template<class V>
+void ProofSolver<V>::childNumbers(const Position& p, int ply, Child& child) {
+    // Ничья: сторона, чей ход, выигрыша не имеет. У атакующего это «опровергнуто», у защиты — «доказано»
+    child.draw = ply >= MAX_PLY;
+    for (int i = ply - 2; i >= 0 && !child.draw; i -= 2) child.draw = path[i] == child.key;
+    if (child.draw) {
+        const bool attackerToMove = p.side == attacker;
+        child.phi = attackerToMove ? INF : 0;
+        child.delta = attackerToMove ? 0 : INF;
+        return;
+    }
+    stats.probes++;
+    if (const Entry* e = find(child.key)) {
+        stats.hits++;
+        child.phi = e->phi;
+        child.delta = e->delta;
+    }
+    else child.phi = child.delta = 1;
+}
+
+template<class V>
+typename ProofSolver<V>::Result ProofSolver<V>::solve(const Position& root, double seconds, uint64_t maxNodes) {
+    const auto started = std::chrono::steady_clock::now();
+    stats = Result();
+    stats.entries = table.size();
+    std::fill(table.begin(), table.end(), Entry());
+    attacker = root.side;
+    stopped = false;
+    timed = seconds > 0.0;
+    nodeLimit = maxNodes;
+    deadline = started + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+
+    Position pos = root;
+    const uint64_t key = Core::hash(root);
+    uint32_t phi, delta;
+    mid(pos, key, INF, INF, 0, phi, delta);
+
+    Result result = stats;
+    // Нули чисел ставят только решённые листья, поэтому итог верен и после остановки по времени
+    if (phi == 0) result.outcome = Outcome::WIN;
+    else if (delta == 0) result.outcome = Outcome::NO_WIN;
+    if (result.outcome == Outcome::WIN) {
+        std::unordered_set<uint64_t> seen;
+        stats.proofMissing = 0;
+        result.proofSize = proofTree(pos, key, 0, seen);
+        result.proofMissing = stats.proofMissing;
+        mainLine(root, key);
+        result.line = stats.line;
+        if (!result.line.empty()) result.best = result.line[0];
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return result;
+}
+
+//--Раскрытие узла (MID): пока числа узла не вышли за пороги, спускаемся в ребёнка с наименьшим delta
+//  с порогами, при которых он остаётся лучшим. Числа детей читаются из таблицы, кроме только что раскрытого:
+//  его числа приходят из рекурсии, и если таблица мала и запись уже вытеснена, узел всё равно продвигается,
+//  а не раскрывает того же ребёнка заново
+template<class V>
+void ProofSolver<V>::mid(Position& p, uint64_t key, uint32_t thPhi, uint32_t thDelta, int ply,
+    uint32_t& phiOut, uint32_t& deltaOut) {
+    const uint64_t before = stats.nodes++;
+    if ((stats.nodes & 4095) == 0 && ((timed && std::chrono::steady_clock::now() >= deadline)
+        || (abort && abort->load(std::memory_order_relaxed)) || (nodeLimit && stats.nodes >= nodeLimit))) stopped = true;
+
+    std::vector<Move>& list = moves[ply];
+    Core::generate(p, list);
+    if (list.empty()) { // Нечем ходить — проигрыш стороны, чей ход
+        store(key, INF, 0, 1);
+        phiOut = INF;
+        deltaOut = 0;
+        return;
+    }
+    path[ply] = key;
+
+    typename Core::Undo undo;
+    const int side = p.side;
+    std::vector<Child>& kids = children[ply];
+    kids.resize(list.size());
+    for (size_t i = 0; i < list.size(); ++i) {
+        Core::make(p, list[i], undo);
+        kids[i].key = Core::hashAfter(key, list[i], undo, side);
+        childNumbers(p, ply + 1, kids[i]);
+        Core::unmake(p, list[i], undo);
+    }
+    size_t searched = kids.size(); // Пока никого не раскрывали, числа только что прочитаны
+    for (;;) {
+        uint32_t phi = INF, delta = 0, secondDelta = INF;
+        size_t best = 0;
+        for (size_t i = 0; i < kids.size(); ++i) {
+            // Братья могли решиться через транспозиции в поддереве раскрытого ребёнка
+            if (searched < kids.size() && i != searched && !kids[i].draw) {
+                stats.probes++;
+                if (const Entry* e = find(kids[i].key)) {
+                    stats.hits++;
+                    kids[i].phi = e->phi;
+                    kids[i].delta = e->delta;
+                }
+            }
+            // Сумма насыщается: INF — только если какой-то ребёнок уже решён в нашу пользу
+            delta = delta >= INF || kids[i].phi >= INF ? INF : std::min(INF - 1, delta + kids[i].phi);
+            if (kids[i].delta < phi) {
+                secondDelta = phi;
+                phi = kids[i].delta;
+                best = i;
+            }
+            else if (kids[i].delta < secondDelta) secondDelta = kids[i].delta;
+        }
+        if (phi >= thPhi || delta >= thDelta || stopped) {
+            store(key, phi, delta, stats.nodes - before);
+            phiOut = phi;
+            deltaOut = delta;
+            return;
+        }
+        // Пороги не выше INF: иначе решённый ребёнок (0 или INF) не выходит за них и раскрывается без конца
+        Child& child = kids[best];
+        Core::make(p, list[best], undo);
+        mid(p, child.key, std::min(INF, thDelta - delta + child.phi), std::min({ thPhi, secondDelta + 1, INF }), ply + 1,
+            child.phi, child.delta);
+        Core::unmake(p, list[best], undo);
+        searched = best;
+    }
+}
+
+//--Размер дерева доказательства: у атакующего — один доказанный ход, у защиты — все ответы.
+//  Совпадающие позиции считаются один раз
+template<class V>
+uint64_t ProofSolver<V>::proofTree(Position& p, uint64_t key, int ply, std::unordered_set<uint64_t>& seen) {
+    if (!seen.insert(key).second) return 0;
+    if (ply >= MAX_PLY) {
+        stats.proofMissing++;
+        return 1;
+    }
+    std::vector<Move>& list = moves[ply];
+    Core::generate(p, list);
+    const bool attackerToMove = p.side == attacker;
+    const int side = p.side;
+    typename Core::Undo undo;
+    uint64_t size = 1;
+    bool proved = !attackerToMove;
+    for (size_t i = 0; i < list.size(); ++i) {
+        Core::make(p, list[i], undo);
+        const uint64_t childKey = Core::hashAfter(key, list[i], undo, side);
+        const Entry* e = find(childKey);
+        // Ребёнок доказан для атакующего: у защиты на ходу нет выигрыша (delta == 0), у атакующего — phi == 0
+        const bool childProved = e && (attackerToMove ? e->delta == 0 : e->phi == 0);
+        if (childProved) size += proofTree(p, childKey, ply + 1, seen);
+        else if (!attackerToMove) stats.proofMissing++;
+        Core::unmake(p, list[i], undo);
+        if (attackerToMove && childProved) {
+            proved = true;
+            break;
+        }
+    }
+    if (!proved) stats.proofMissing++;
+    return size;
+}
+
+//--Главный вариант доказательства: атакующий идёт доказанным ходом, защита — ходом, на который ушло
+//  больше всего работы (самое упорное сопротивление)
+template<class V>
+void ProofSolver<V>::mainLine(Position p, uint64_t key) {
+    stats.line.clear();
+    std::vector<Move> list;
+    std::unordered_set<uint64_t> seen;
+    typename Core::Undo undo;
+    while (int(stats.line.size()) < MAX_PLY && seen.insert(key).second) {
+        Core::generate(p, list);
+        const bool attackerToMove = p.side == attacker;
+        const int side = p.side;
+        size_t chosen = list.size();
+        uint64_t chosenKey = 0;
+        uint32_t chosenWork = 0;
+        for (size_t i = 0; i < list.size(); ++i) {
+            Core::make(p, list[i], undo);
+            const uint64_t childKey = Core::hashAfter(key, list[i], undo, side);
+            Core::unmake(p, list[i], undo);
+            const Entry* e = find(childKey);
+            if (attackerToMove && e && e->delta == 0) {
+                chosen = i;
+                chosenKey = childKey;
+                break;
+            }
+            if (!attackerToMove && (chosen == list.size() || (e && e->work > chosenWork))) {
+                chosen = i;
+                chosenKey = childKey;
+                chosenWork = e ? e->work : 0;
+            }
+        }
+        if (chosen == list.size()) break;
+        stats.line.push_back(list[chosen]);
+        Core::apply(p, list[chosen]);
+        key = chosenKey;
+    }
+}
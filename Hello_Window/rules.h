@@ -0,0 +1,606 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+//--Код фигуры в клетке (состояние доски без GL-объектов)
+enum PieceCode : uint8_t { PIECE_NONE, PIECE_WHITE, PIECE_BLACK, PIECE_WHITE_KING, PIECE_BLACK_KING };
+
+//--Что делает простая шашка, дошедшая до последнего ряда посреди взятия
+enum class PromotionInCapture {
+    CONTINUE_AS_KING, // Становится дамкой и продолжает бить уже как дамка
+    STOP,             // Становится дамкой, ход на этом заканчивается
+    CONTINUE_AS_MAN   // Бьёт дальше как простая; дамкой становится, только если закончила ход на последнем ряду
+};
+
+enum class Variant { RUSSIAN, ENGLISH, INTERNATIONAL, BRAZILIAN };
+
+//--Варианты правил. Всё, чем варианты отличаются, — константы времени компиляции,
+//  так что генератор ходов собирается под каждый вариант отдельно и не ветвится по правилам во время игры
+struct RussianRules {
+    static constexpr Variant ID = Variant::RUSSIAN;
+    static constexpr const char* NAME = "russian";
+    static constexpr int SIZE = 8;
+    static constexpr int ROWS = 3;                  // Рядов шашек у каждой стороны в начальной позиции
+    static constexpr bool WHITE_STARTS = true;
+    static constexpr bool FLYING_KINGS = true;      // Дамка ходит и бьёт на любое расстояние
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;
+    static constexpr bool MAJORITY_CAPTURE = false; // Обязательно брать наибольшее число шашек
+    static constexpr PromotionInCapture PROMOTION = PromotionInCapture::CONTINUE_AS_KING;
+    // Ходов каждой стороны одними дамками без взятий, после которых объявляется ничья
+    static constexpr int DRAW_KING_MOVES = 15;
+};
+
+struct EnglishRules {
+    static constexpr Variant ID = Variant::ENGLISH;
+    static constexpr const char* NAME = "english";
+    static constexpr int SIZE = 8;
+    static constexpr int ROWS = 3;
+    static constexpr bool WHITE_STARTS = false;     // Первыми ходят чёрные
+    static constexpr bool FLYING_KINGS = false;
+    static constexpr bool MEN_CAPTURE_BACKWARD = false;
+    static constexpr bool MAJORITY_CAPTURE = false;
+    static constexpr PromotionInCapture PROMOTION = PromotionInCapture::STOP;
+    static constexpr int DRAW_KING_MOVES = 40;
+};
+
+struct InternationalRules {
+    static constexpr Variant ID = Variant::INTERNATIONAL;
+    static constexpr const char* NAME = "international";
+    static constexpr int SIZE = 10;
+    static constexpr int ROWS = 4;
+    static constexpr bool WHITE_STARTS = true;
+    static constexpr bool FLYING_KINGS = true;
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;
+    static constexpr bool MAJORITY_CAPTURE = true;
+    static constexpr PromotionInCapture PROMOTION = PromotionInCapture::CONTINUE_AS_MAN;
+    static constexpr int DRAW_KING_MOVES = 25;
+};
+
+// Международные правила на доске 8x8
+struct BrazilianRules {
+    static constexpr Variant ID = Variant::BRAZILIAN;
+    static constexpr const char* NAME = "brazilian";
+    static constexpr int SIZE = 8;
+    static constexpr int ROWS = 3;
+    static constexpr bool WHITE_STARTS = true;
+    static constexpr bool FLYING_KINGS = true;
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;
+    static constexpr bool MAJORITY_CAPTURE = true;
+    static constexpr PromotionInCapture PROMOTION = PromotionInCapture::CONTINUE_AS_MAN;
+    static constexpr int DRAW_KING_MOVES = 20;
+};
+
+//--Ядро правил на битбордах. Тёмные поля нумеруются по рядам (SIZE / 2 в ряду), после каждой пары
+//  рядов вставлено «призрачное» поле. Тогда соседи по диагонали всегда отстоят на SIZE / 2 и SIZE / 2 + 1,
+//  а сдвиг за край доски попадает на призрачное поле и отрезается маской BOARD
+template<class V>
+class Rules {
+public:
+    static constexpr int SIZE = V::SIZE;
+    static constexpr int HALF = SIZE / 2;
+    static_assert(SIZE % 2 == 0 && SIZE * HALF + HALF - 1 < 64, "доска не помещается в 64-битный битборд");
+
+    // Направления: первые два — вверх (вперёд для белых), последние два — вниз (вперёд для чёрных)
+    static constexpr int DIRS[4] = { -(HALF + 1), -HALF, HALF, HALF + 1 };
+    static constexpr int MAX_CAPTURES = V::ROWS * HALF; // Больше, чем шашек у соперника, не снять
+
+    // Номер бита для тёмного поля (row + col нечётно), иначе -1
+    static constexpr int square(int row, int col) {
+        return (row + col) % 2 == 1 ? row * HALF + col / 2 + row / 2 : -1;
+    }
+    static constexpr std::array<int8_t, 64> ROW = [] {
+        std::array<int8_t, 64> a{};
+        for (auto& v : a) v = -1;
+        for (int r = 0; r < SIZE; ++r)
+            for (int c = 0; c < SIZE; ++c)
+                if (square(r, c) >= 0) a[square(r, c)] = int8_t(r);
+        return a;
+    }();
+    static constexpr std::array<int8_t, 64> COL = [] {
+        std::array<int8_t, 64> a{};
+        for (auto& v : a) v = -1;
+        for (int r = 0; r < SIZE; ++r)
+            for (int c = 0; c < SIZE; ++c)
+                if (square(r, c) >= 0) a[square(r, c)] = int8_t(c);
+        return a;
+    }();
+    static constexpr uint64_t rowMask(int row) {
+        uint64_t m = 0;
+        for (int c = 0; c < SIZE; ++c)
+            if (square(row, c) >= 0) m |= 1ull << square(row, c);
+        return m;
+    }
+    static constexpr uint64_t BOARD = [] {
+        uint64_t m = 0;
+        for (int r = 0; r < SIZE; ++r) m |= rowMask(r);
+        return m;
+    }();
+    // Поля превращения: белые идут к ряду 0, чёрные — к последнему
+    static constexpr uint64_t PROMOTE[2] = { rowMask(0), rowMask(SIZE - 1) };
+
+    struct Position {
+        uint64_t men[2] = {}, kings[2] = {}; // [0] — белые, [1] — чёрные
+        int side = 0;                        // Чей ход: 0 — белые
+
+        uint64_t pieces(int s) const { return men[s] | kings[s]; }
+        uint64_t occupied() const { return pieces(0) | pieces(1); }
+        bool operator==(const Position&) const = default;
+    };
+
+    // Ключи Zobrist: [2 * сторона + дамка][поле] и ключ очереди хода чёрных
+    static constexpr std::array<std::array<uint64_t, 64>, 4> ZOBRIST = [] {
+        std::array<std::array<uint64_t, 64>, 4> keys{};
+        uint64_t state = 0x9E3779B97F4A7C15ull;
+        for (auto& row : keys)
+            for (auto& key : row) {
+                // splitmix64
+                uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                key = z ^ (z >> 31);
+            }
+        return keys;
+    }();
+    static constexpr uint64_t ZOBRIST_SIDE = 0xD6E8FEB86659FD93ull;
+    static uint64_t hash(const Position& p);
+
+    struct Move {
+        uint8_t squares[MAX_CAPTURES + 1]; // Путь: исходное поле и поле после каждого шага
+        uint8_t taken[MAX_CAPTURES];       // Шашка, снятая на каждом шаге взятия
+        uint8_t steps = 0;                 // Тихий ход — один шаг без взятия
+        bool promotes = false;
+        uint64_t captured = 0;
+
+        int from() const { return squares[0]; }
+        int to() const { return squares[steps]; }
+        bool isCapture() const { return captured != 0; }
+    };
+
+    static Position initial();
+    // Позиция из двумерного массива кодов PieceCode (cells[row][col])
+    template<class Cells>
+    static Position fromCells(const Cells& cells, int side);
+    template<class Cells>
+    static void toCells(const Position& p, Cells& cells);
+
+    // Все допустимые ходы стороны, чей ход (с учётом обязательного и, если надо, наибольшего взятия)
+    static void generate(const Position& p, std::vector<Move>& out);
+    // Только взятия (с правилом большинства); пусто — взятий нет. Для тихого поиска
+    static void captures(const Position& p, std::vector<Move>& out);
+    // Есть ли ход без взятия — проверка сдвигами, без списка
+    static bool hasQuietMove(const Position& p);
+    static void apply(Position& p, const Move& m);
+
+    // Всё, что нужно для отмены хода: снятые простые и дамки и кем был ходивший
+    struct Undo {
+        uint64_t capturedMen = 0, capturedKings = 0;
+        bool wasKing = false;
+    };
+    // Ход с запоминанием и отмена — без копирования позиции и выделений памяти
+    static void make(Position& p, const Move& m, Undo& u);
+    static void unmake(Position& p, const Move& m, const Undo& u);
+    // Хэш позиции после make() из хэша до хода; side — сторона, сделавшая ход
+    static uint64_t hashAfter(uint64_t h, const Move& m, const Undo& u, int side);
+
+    static bool has(uint64_t set, int sq) { return unsigned(sq) < 64 && (set >> sq & 1); }
+
+private:
+    static uint64_t bit(int sq) { return 1ull << sq; }
+    static int popLowest(uint64_t& set) {
+        int sq = std::countr_zero(set);
+        set &= set - 1;
+        return sq;
+    }
+    static uint64_t shift(uint64_t set, int d) { return d > 0 ? set << d : set >> -d; }
+
+    static void generateQuiet(const Position& p, std::vector<Move>& out);
+    static void generateCaptures(const Position& p, std::vector<Move>& out);
+    static void manCaptures(const Position& p, int sq, Move& m, uint64_t empty, std::vector<Move>& out);
+    static void kingCaptures(const Position& p, int sq, Move& m, uint64_t empty, std::vector<Move>& out);
+    static bool kingCanCapture(const Position& p, int sq, uint64_t captured, uint64_t empty);
+};
+
+template<class V>
+typename Rules<V>::Position Rules<V>::initial() {
+    Position p;
+    p.side = V::WHITE_STARTS ? 0 : 1;
+    for (int r = 0; r < V::ROWS; ++r) {
+        p.men[1] |= rowMask(r);
+        p.men[0] |= rowMask(SIZE - 1 - r);
+    }
+    return p;
+}
+
+template<class V>
+template<class Cells>
+typename Rules<V>::Position Rules<V>::fromCells(const Cells& cells, int side) {
+    Position p;
+    p.side = side;
+    for (int r = 0; r < SIZE; ++r)
+        for (int c = 0; c < SIZE; ++c) {
+            int sq = square(r, c);
+            if (sq < 0) continue;
+            switch (cells[r][c]) {
+            case PIECE_WHITE:      p.men[0] |= bit(sq); break;
+            case PIECE_BLACK:      p.men[1] |= bit(sq); break;
+            case PIECE_WHITE_KING: p.kings[0] |= bit(sq); break;
+            case PIECE_BLACK_KING: p.kings[1] |= bit(sq); break;
+            default: break;
+            }
+        }
+    return p;
+}
+
+template<class V>
+template<class Cells>
+void Rules<V>::toCells(const Position& p, Cells& cells) {
+    for (int r = 0; r < SIZE; ++r)
+        for (int c = 0; c < SIZE; ++c) {
+            int sq = square(r, c);
+            cells[r][c] = sq < 0 ? PIECE_NONE
+                : has(p.men[0], sq) ? PIECE_WHITE
+                : has(p.men[1], sq) ? PIECE_BLACK
+                : has(p.kings[0], sq) ? PIECE_WHITE_KING
+                : has(p.kings[1], sq) ? PIECE_BLACK_KING : PIECE_NONE;
+        }
+}
+
+template<class V>
+uint64_t Rules<V>::hash(const Position& p) {
+    uint64_t h = p.side ? ZOBRIST_SIDE : 0;
+    const uint64_t* sets[4] = { &p.men[0], &p.kings[0], &p.men[1], &p.kings[1] };
+    for (int kind = 0; kind < 4; ++kind)
+        for (uint64_t set = *sets[kind]; set; )
+            h ^= ZOBRIST[kind][popLowest(set)];
+    return h;
+}
+
+template<class V>
+void Rules<V>::generate(const Position& p, std::vector<Move>& out) {
+    captures(p, out);
+    if (out.empty()) generateQuiet(p, out);
+}
+
+template<class V>
+void Rules<V>::captures(const Position& p, std::vector<Move>& out) {
+    out.clear();
+    generateCaptures(p, out);
+    if (out.empty()) return;
+    if constexpr (V::MAJORITY_CAPTURE) {
+        int best = 0;
+        for (const Move& m : out) best = std::max(best, int(m.steps));
+        size_t kept = 0;
+        for (const Move& m : out)
+            if (m.steps == best) out[kept++] = m;
+        out.resize(kept);
+    }
+}
+
+template<class V>
+bool Rules<V>::hasQuietMove(const Position& p) {
+    const int s = p.side;
+    const uint64_t empty = BOARD & ~p.occupied();
+    for (int i = 0; i < 2; ++i)
+        if (shift(p.men[s], DIRS[s * 2 + i]) & empty) return true;
+    for (int d : DIRS)
+        if (shift(p.kings[s], d) & empty) return true;
+    return false;
+}
+
+template<class V>
+void Rules<V>::generateQuiet(const Position& p, std::vector<Move>& out) {
+    const int s = p.side;
+    const uint64_t empty = BOARD & ~p.occupied();
+
+    // Простые шашки: все ходы в одном направлении получаются одним сдвигом
+    for (int i = 0; i < 2; ++i) {
+        const int d = DIRS[s * 2 + i];
+        for (uint64_t targets = shift(p.men[s], d) & empty; targets; ) {
+            int to = popLowest(targets);
+            Move& m = out.emplace_back();
+            m.squares[0] = uint8_t(to - d);
+            m.squares[1] = uint8_t(to);
+            m.steps = 1;
+            m.promotes = has(PROMOTE[s], to);
+        }
+    }
+
+    for (uint64_t kings = p.kings[s]; kings; ) {
+        int from = popLowest(kings);
+        for (int d : DIRS)
+            for (int to = from + d; has(empty, to); to += d) {
+                Move& m = out.emplace_back();
+                m.squares[0] = uint8_t(from);
+                m.squares[1] = uint8_t(to);
+                m.steps = 1;
+                if constexpr (!V::FLYING_KINGS) break;
+            }
+    }
+}
+
+template<class V>
+void Rules<V>::generateCaptures(const Position& p, std::vector<Move>& out) {
+    const int s = p.side;
+    Move m;
+    for (uint64_t men = p.men[s]; men; ) {
+        int from = popLowest(men);
+        m.squares[0] = uint8_t(from);
+        // Шашка уходит со своего поля, снятые шашки стоят на доске до конца хода (турецкий удар запрещён)
+        manCaptures(p, from, m, BOARD & ~(p.occupied() & ~bit(from)), out);
+    }
+    for (uint64_t kings = p.kings[s]; kings; ) {
+        int from = popLowest(kings);
+        m.squares[0] = uint8_t(from);
+        kingCaptures(p, from, m, BOARD & ~(p.occupied() & ~bit(from)), out);
+    }
+}
+
+template<class V>
+void Rules<V>::manCaptures(const Position& p, int sq, Move& m, uint64_t empty, std::vector<Move>& out) {
+    const int s = p.side;
+    const uint64_t enemy = p.pieces(s ^ 1) & ~m.captured;
+    bool extended = false;
+
+    // Если простые бьют только вперёд, берём два направления своей стороны
+    constexpr int DIR_COUNT = V::MEN_CAPTURE_BACKWARD ? 4 : 2;
+    for (int i = 0; i < DIR_COUNT; ++i) {
+        const int d = V::MEN_CAPTURE_BACKWARD ? DIRS[i] : DIRS[s * 2 + i];
+        const int mid = sq + d, land = mid + d;
+        if (!has(enemy, mid) || !has(empty, land)) continue;
+
+        extended = true;
+        m.taken[m.steps] = uint8_t(mid);
+        m.squares[++m.steps] = uint8_t(land);
+        m.captured |= bit(mid);
+
+        if (has(PROMOTE[s], land) && V::PROMOTION != PromotionInCapture::CONTINUE_AS_MAN) {
+            m.promotes = true;
+            if constexpr (V::PROMOTION == PromotionInCapture::STOP)
+                out.push_back(m);
+            else
+                kingCaptures(p, land, m, empty, out);
+            m.promotes = false;
+        }
+        else
+            manCaptures(p, land, m, empty, out);
+
+        m.captured &= ~bit(mid);
+        m.steps--;
+    }
+
+    if (!extended && m.steps > 0) {
+        m.promotes = has(PROMOTE[s], sq);
+        out.push_back(m);
+        m.promotes = false;
+    }
+}
+
+template<class V>
+bool Rules<V>::kingCanCapture(const Position& p, int sq, uint64_t captured, uint64_t empty) {
+    const uint64_t enemy = p.pieces(p.side ^ 1) & ~captured;
+    for (int d : DIRS) {
+        int mid = sq + d;
+        if constexpr (V::FLYING_KINGS)
+            while (has(empty, mid)) mid += d;
+        if (has(enemy, mid) && has(empty, mid + d)) return true;
+    }
+    return false;
+}
+
+template<class V>
+void Rules<V>::kingCaptures(const Position& p, int sq, Move& m, uint64_t empty, std::vector<Move>& out) {
+    const uint64_t enemy = p.pieces(p.side ^ 1) & ~m.captured;
+    bool extended = false;
+
+    for (int d : DIRS) {
+        int mid = sq + d;
+        if constexpr (V::FLYING_KINGS)
+            while (has(empty, mid)) mid += d;
+        if (!has(enemy, mid)) continue;
+
+        // Поля, на которые можно встать за снятой шашкой
+        int landings[SIZE];
+        int count = 0;
+        for (int land = mid + d; has(empty, land); land += d) {
+            landings[count++] = land;
+            if constexpr (!V::FLYING_KINGS) break;
+        }
+        if (count == 0) continue;
+
+        extended = true;
+        m.taken[m.steps] = uint8_t(mid);
+        m.captured |= bit(mid);
+        m.steps++;
+
+        // Если с какого-то поля взятие продолжается, останавливаться на остальных нельзя
+        bool continues[SIZE];
+        bool any = false;
+        for (int i = 0; i < count; ++i) {
+            continues[i] = kingCanCapture(p, landings[i], m.captured, empty);
+            any |= continues[i];
+        }
+        for (int i = 0; i < count; ++i) {
+            if (any && !continues[i]) continue;
+            m.squares[m.steps] = uint8_t(landings[i]);
+            kingCaptures(p, landings[i], m, empty, out);
+        }
+
+        m.steps--;
+        m.captured &= ~bit(mid);
+    }
+
+    if (!extended && m.steps > 0) out.push_back(m);
+}
+
+template<class V>
+void Rules<V>::apply(Position& p, const Move& m) {
+    Undo u;
+    make(p, m, u);
+}
+
+template<class V>
+void Rules<V>::make(Position& p, const Move& m, Undo& u) {
+    const int s = p.side;
+    const uint64_t from = bit(m.from()), to = bit(m.to());
+    u.wasKing = p.kings[s] & from;
+    u.capturedMen = p.men[s ^ 1] & m.captured;
+    u.capturedKings = p.kings[s ^ 1] & m.captured;
+    // Дамка может вернуться на исходное поле, поэтому сначала снимаем, потом ставим
+    if (u.wasKing)
+        p.kings[s] = (p.kings[s] & ~from) | to;
+    else {
+        p.men[s] &= ~from;
+        if (m.promotes) p.kings[s] |= to;
+        else p.men[s] |= to;
+    }
+    p.men[s ^ 1] &= ~m.captured;
+    p.kings[s ^ 1] &= ~m.captured;
+    p.side ^= 1;
+}
+
+template<class V>
+void Rules<V>::unmake(Position& p, const Move& m, const Undo& u) {
+    p.side ^= 1;
+    const int s = p.side;
+    const uint64_t from = bit(m.from()), to = bit(m.to());
+    p.men[s] &= ~to;
+    p.kings[s] &= ~to;
+    if (u.wasKing) p.kings[s] |= from;
+    else p.men[s] |= from;
+    p.men[s ^ 1] |= u.capturedMen;
+    p.kings[s ^ 1] |= u.capturedKings;
+}
+
+template<class V>
+uint64_t Rules<V>::hashAfter(uint64_t h, const Move& m, const Undo& u, int side) {
+    const int own = 2 * side, enemy = 2 * (side ^ 1);
+    h ^= ZOBRIST[own + u.wasKing][m.from()];
+    h ^= ZOBRIST[own + (u.wasKing || m.promotes)][m.to()];
+    for (uint64_t set = u.capturedMen; set; ) h ^= ZOBRIST[enemy][popLowest(set)];
+    for (uint64_t set = u.capturedKings; set; ) h ^= ZOBRIST[enemy + 1][popLowest(set)];
+    return h ^ ZOBRIST_SIDE;
+}
+
+//--Правила для сцены: позиция и ходы в координатах доски (ряд, столбец).
+//  Виртуальный вызов — один на запрос хода, генерация внутри специализирована под вариант
+class GameRules {
+public:
+    static constexpr int MAX_SIZE = 10;
+    using Cells = uint8_t[MAX_SIZE][MAX_SIZE];
+
+    struct PathMove {
+        std::vector<std::pair<int, int>> path;  // path[0] — исходное поле, дальше — поле после каждого шага
+        std::vector<std::pair<int, int>> taken; // Шашка, снятая на шаге i (у тихого хода пусто)
+        bool promotes = false;
+    };
+
+    virtual ~GameRules() = default;
+    virtual Variant variant() const = 0;
+    virtual const char* name() const = 0;
+    virtual int size() const = 0;
+    virtual int startRows() const = 0;
+    virtual bool whiteStarts() const = 0;
+    virtual int drawKingMoves() const = 0;
+    virtual uint64_t hash(const Cells& cells, bool whiteToMove) const = 0;
+    virtual void legalMoves(const Cells& cells, bool whiteToMove, std::vector<PathMove>& out) const = 0;
+    // То же, но ходы пишутся в out[0..n) поверх прежних: векторы путей переиспользуются, out не
+    // уменьшается. Возвращает n. Для доски, которая пересчитывает ходы каждый полуход без выделений
+    virtual size_t fillLegalMoves(const Cells& cells, bool whiteToMove, std::vector<PathMove>& out) const = 0;
+
+    // Ход на массиве клеток: фигура переходит в конец пути, снятые убираются. Допустимость не проверяется
+    static void applyPath(Cells& cells, const PathMove& move);
+};
+
+void GameRules::applyPath(Cells& cells, const PathMove& move) {
+    const auto [fromRow, fromCol] = move.path.front();
+    const auto [toRow, toCol] = move.path.back();
+    uint8_t piece = cells[fromRow][fromCol];
+    if (move.promotes)
+        piece = piece == PIECE_WHITE ? uint8_t(PIECE_WHITE_KING) : piece == PIECE_BLACK ? uint8_t(PIECE_BLACK_KING) : piece;
+    cells[fromRow][fromCol] = PIECE_NONE;
+    for (const auto& [r, c] : move.taken) cells[r][c] = PIECE_NONE;
+    cells[toRow][toCol] = piece;
+}
+
+template<class V>
+class VariantRules : public GameRules {
+public:
+    using Core = Rules<V>;
+    static_assert(V::SIZE <= MAX_SIZE, "вариант не помещается в GameRules::Cells");
+
+    Variant variant() const override { return V::ID; }
+    const char* name() const override { return V::NAME; }
+    int size() const override { return V::SIZE; }
+    int startRows() const override { return V::ROWS; }
+    bool whiteStarts() const override { return V::WHITE_STARTS; }
+    int drawKingMoves() const override { return V::DRAW_KING_MOVES; }
+    uint64_t hash(const Cells& cells, bool whiteToMove) const override {
+        return Core::hash(Core::fromCells(cells, whiteToMove ? 0 : 1));
+    }
+
+    void legalMoves(const Cells& cells, bool whiteToMove, std::vector<PathMove>& out) const override {
+        out.resize(fillLegalMoves(cells, whiteToMove, out));
+    }
+
+    size_t fillLegalMoves(const Cells& cells, bool whiteToMove, std::vector<PathMove>& out) const override {
+        // Запас генератора живёт в потоке: после первых ходов партии он уже нужного размера
+        thread_local std::vector<typename Core::Move> moves;
+        Core::generate(Core::fromCells(cells, whiteToMove ? 0 : 1), moves);
+
+        if (out.size() < moves.size()) out.resize(moves.size());
+        for (size_t i = 0; i < moves.size(); ++i)
+            toPath(moves[i], out[i]);
+        return moves.size();
+    }
+
+    static PathMove toPath(const typename Core::Move& m) {
+        PathMove pm;
+        toPath(m, pm);
+        return pm;
+    }
+
+    // Запись в готовый PathMove: clear() оставляет выделенную память векторов
+    static void toPath(const typename Core::Move& m, PathMove& pm) {
+        pm.path.clear();
+        pm.taken.clear();
+        for (int i = 0; i <= m.steps; ++i)
+            pm.path.emplace_back(Core::ROW[m.squares[i]], Core::COL[m.squares[i]]);
+        if (m.isCapture())
+            for (int i = 0; i < m.steps; ++i)
+                pm.taken.emplace_back(Core::ROW[m.taken[i]], Core::COL[m.taken[i]]);
+        pm.promotes = m.promotes;
+    }
+};
+
+// Вызывает fn с типом правил выбранного варианта: fn(RussianRules{}) и т.д.
+template<class Fn>
+decltype(auto) dispatchVariant(Variant variant, Fn&& fn) {
+    switch (variant) {
+    case Variant::ENGLISH:       return fn(EnglishRules{});
+    case Variant::INTERNATIONAL: return fn(InternationalRules{});
+    case Variant::BRAZILIAN:     return fn(BrazilianRules{});
+    default:                     return fn(RussianRules{});
+    }
+}
+
+std::unique_ptr<GameRules> makeRules(Variant variant) {
+    return dispatchVariant(variant, [](auto traits) -> std::unique_ptr<GameRules> {
+        return std::make_unique<VariantRules<decltype(traits)>>();
+        });
+}
+
+bool parseVariant(const std::string& name, Variant& out) {
+    for (Variant v : { Variant::RUSSIAN, Variant::ENGLISH, Variant::INTERNATIONAL, Variant::BRAZILIAN }) {
+        if (name == dispatchVariant(v, [](auto traits) { return std::string(decltype(traits)::NAME); })) {
+            out = v;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,313 @@
+#pragma once
+#include "clock.h"
+#include "eval.h"
+#include "rules.h"
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+//--Счётчики одного поиска. Их ведёт экземпляр перебора, а он принадлежит одному потоку, поэтому
+//  счёт идёт обычными сложениями без атомиков и без общих строк кэша с другими потоками
+struct SearchStats {
+    static constexpr int CUTOFF_SLOTS = 8;  // Отсечение на 1-м, 2-м, ... ходе; последний — 8-й и дальше
+    static constexpr int MAX_ITERATIONS = 64;
+
+    struct Iteration {
+        int depth = 0;
+        int score = 0;
+        uint64_t nodes = 0;     // Узлов за итерацию
+        double seconds = 0.0;   // С начала поиска до конца итерации
+    };
+
+    uint64_t nodes = 0;         // Все узлы
+    uint64_t qnodes = 0;        // Узлы на горизонте и за ним (оценка или тихий поиск)
+    uint64_t expanded = 0;      // Узлы, где перебирались ходы
+    uint64_t moves = 0;         // Ходов в них всего
+    uint64_t cutoffs[CUTOFF_SLOTS] = {};
+    Iteration iterations[MAX_ITERATIONS];
+    int iterationCount = 0;
+    double seconds = 0.0;
+    bool forced = false;        // Ход единственный: поиска не было, глубина 0
+
+    void reset() { *this = SearchStats(); }
+    void addIteration(int depth, int score, double elapsed);
+    // Среднее число ходов в раскрытом узле
+    double branching() const { return expanded ? double(moves) / expanded : 0.0; }
+    // Рост итерации: узлов последней итерации к узлам предыдущей
+    double effectiveBranching() const;
+    // Доля отсечений на первом ходе — мера качества порядка ходов
+    double firstMoveCutoffRate() const;
+    std::string json() const;
+};
+
+void SearchStats::addIteration(int depth, int score, double elapsed) {
+    if (iterationCount == MAX_ITERATIONS) return;
+    uint64_t before = 0;
+    for (int i = 0; i < iterationCount; ++i) before += iterations[i].nodes;
+    iterations[iterationCount++] = { depth, score, nodes - before, elapsed };
+}
+
+double SearchStats::effectiveBranching() const {
+    if (iterationCount < 2 || iterations[iterationCount - 2].nodes == 0) return 0.0;
+    return double(iterations[iterationCount - 1].nodes) / iterations[iterationCount - 2].nodes;
+}
+
+double SearchStats::firstMoveCutoffRate() const {
+    uint64_t total = 0;
+    for (uint64_t c : cutoffs) total += c;
+    return total ? double(cutoffs[0]) / total : 0.0;
+}
+
+std::string SearchStats::json() const {
+    // Числа через to_chars: JSON не должен зависеть от локали процесса (в ru_RU printf пишет запятую)
+    std::string out;
+    auto number = [&out](const char* key, auto value) {
+        char buffer[32];
+        const auto end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+        if (out.back() != '{' && out.back() != '[') out += ',';
+        if (key) out.append("\"").append(key).append("\":");
+        out.append(buffer, end);
+    };
+    out += "{";
+    number("nodes", nodes);
+    number("qnodes", qnodes);
+    number("expanded", expanded);
+    number("seconds", seconds);
+    number("nps", seconds > 0.0 ? double(nodes) / seconds : 0.0);
+    number("depth", iterationCount ? iterations[iterationCount - 1].depth : 0);
+    out += forced ? ",\"forced\":true" : ",\"forced\":false";
+    number("branching", branching());
+    number("effectiveBranching", effectiveBranching());
+    number("firstMoveCutoffRate", firstMoveCutoffRate());
+    out += ",\"cutoffs\":[";
+    for (uint64_t c : cutoffs) number(nullptr, c);
+    out += "],\"iterations\":[";
+    for (int i = 0; i < iterationCount; ++i) {
+        const Iteration& it = iterations[i];
+        if (i) out += ",";
+        out += "{";
+        number("depth", it.depth);
+        number("score", it.score);
+        number("nodes", it.nodes);
+        number("seconds", it.seconds);
+        out += "}";
+    }
+    out += "]}";
+    return out;
+}
+
+//--Перебор с альфа-бета отсечением над ядром правил варианта: итеративное углубление,
+//  списки ходов заведены на каждый уровень заранее, поэтому в переборе нет выделений памяти.
+//  E — оценка с аккумулятором (Evaluator<V> или NnueEvaluator<V>)
+template<class V, class E = Evaluator<V>>
+class AlphaBeta {
+public:
+    using Core = Rules<V>;
+    using Position = typename Core::Position;
+    using Move = typename Core::Move;
+    using Eval = E;
+
+    static constexpr int MAX_PLY = 64;
+    static constexpr int WIN = 30000;       // Оценка выигрыша; ближе к корню — больше
+
+    struct Result {
+        Move best{};
+        int score = 0;
+        int depth = 0;        // Последняя полностью просчитанная глубина
+        uint64_t nodes = 0;
+        bool found = false;   // false — у стороны нет ходов
+        std::vector<Move> line; // Главный вариант последней итерации, начиная с best
+    };
+
+    const std::atomic<bool>* abort = nullptr;          // Поднятый флаг прерывает поиск (проверка раз в 256 узлов)
+    // За горизонтом доигрывать взятия (тихий поиск). Выключается для сравнения в --bench-tactics
+    bool quiescence = true;
+    std::function<void(const Result&)> onIteration;    // После каждой законченной итерации, в потоке поиска
+
+    explicit AlphaBeta(const Eval& eval_ = Eval()) : eval(eval_), pv((MAX_PLY + 1) * (MAX_PLY + 1)) {
+        for (auto& list : moves) list.reserve(32);
+    }
+
+    // Поиск до глубины maxDepth или пока не выйдет время (seconds <= 0 — без ограничения): итерация,
+    // прерванная по времени, не в счёт. softSeconds > 0 — мягкий предел TimeManager: новая итерация
+    // не начинается после его половины (следующая обычно дольше всех предыдущих вместе), предел
+    // растягивается, если лучший ход только что сменился, и сжимается, если он устойчив
+    Result search(const Position& root, int maxDepth, double seconds, double softSeconds = 0.0);
+    // Счётчики последнего (или идущего — только из потока поиска) поиска
+    const SearchStats& stats() const { return counters; }
+
+private:
+    Eval eval;
+    std::vector<Move> moves[MAX_PLY + 1];
+    // Треугольная таблица главного варианта: строка ply — лучшее продолжение с уровня ply
+    std::vector<Move> pv;
+    int pvLength[MAX_PLY + 1] = {};
+    typename Eval::Accumulator acc;         // Материал и поля текущей позиции перебора
+    SearchStats counters;
+    std::chrono::steady_clock::time_point deadline;
+    bool timed = false, stopped = false;
+
+    int negamax(Position& p, int depth, int alpha, int beta, int ply);
+    int quiesce(Position& p, int alpha, int beta, int ply);
+    // Счёт узла и раз в 256 узлов — проверка времени и флага прерывания
+    bool interrupted();
+};
+
+template<class V, class E>
+typename AlphaBeta<V, E>::Result AlphaBeta<V, E>::search(const Position& root, int maxDepth, double seconds, double softSeconds) {
+    Result result;
+    const auto started = std::chrono::steady_clock::now();
+    counters.reset();
+    stopped = false;
+    timed = seconds > 0.0;
+    deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(seconds));
+
+    std::vector<Move> rootMoves;
+    Core::generate(root, rootMoves);
+    if (rootMoves.size() <= 1) {
+        // Ходов нет или он единственный (обычно вынужденное взятие): не считаем, но счётчики заполняем —
+        // по ним должно быть видно, что поиск прошёл, а не сорвался
+        counters.forced = rootMoves.size() == 1;
+        counters.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        if (rootMoves.empty()) return result;
+        result.best = rootMoves[0];
+        result.found = true;
+        result.line = { rootMoves[0] };
+        return result;
+    }
+    result.best = rootMoves[0];
+    result.found = true;
+    result.line = { rootMoves[0] };
+
+    Position pos = root;
+    typename Core::Undo undo;
+    acc = eval.accumulate(root);
+    const typename Eval::Accumulator rootAcc = acc;
+    std::vector<Move> line;
+    int stable = 0; // Итераций подряд с тем же лучшим ходом
+    for (int depth = 1; depth <= std::min(maxDepth, MAX_PLY - 1); ++depth) {
+        int alpha = -WIN - 1;
+        size_t bestIndex = 0;
+        for (size_t i = 0; i < rootMoves.size(); ++i) {
+            Core::make(pos, rootMoves[i], undo);
+            eval.update(acc, rootMoves[i], undo, root.side);
+            int score = -negamax(pos, depth - 1, -WIN - 1, -alpha, 1);
+            Core::unmake(pos, rootMoves[i], undo);
+            acc = rootAcc;
+            if (stopped) break;
+            if (score > alpha) {
+                alpha = score;
+                bestIndex = i;
+                line.assign(1, rootMoves[i]);
+                line.insert(line.end(), pv.begin() + (MAX_PLY + 1) + 1, pv.begin() + (MAX_PLY + 1) + pvLength[1]);
+            }
+        }
+        if (stopped) break; // Недосчитанная итерация не в счёт
+
+        // Лучший ход — первым на следующей итерации
+        stable = depth > 1 && bestIndex == 0 ? stable + 1 : 0;
+        std::swap(rootMoves[0], rootMoves[bestIndex]);
+        result.best = rootMoves[0];
+        result.score = alpha;
+        result.depth = depth;
+        result.line = line;
+        result.nodes = counters.nodes;
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        counters.addIteration(depth, alpha, elapsed);
+        if (onIteration) onIteration(result);
+        if (alpha >= WIN - MAX_PLY || alpha <= -WIN + MAX_PLY) break; // Выигрыш или проигрыш найден
+        if (softSeconds > 0.0 && elapsed >= 0.5 * softSeconds * TimeManager::stability(stable)) break;
+    }
+    result.nodes = counters.nodes;
+    counters.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return result;
+}
+
+template<class V, class E>
+bool AlphaBeta<V, E>::interrupted() {
+    if ((++counters.nodes & 255) == 0 && ((timed && std::chrono::steady_clock::now() >= deadline)
+        || (abort && abort->load(std::memory_order_relaxed)))) stopped = true;
+    return stopped;
+}
+
+template<class V, class E>
+int AlphaBeta<V, E>::negamax(Position& p, int depth, int alpha, int beta, int ply) {
+    if ((depth <= 0 || ply >= MAX_PLY) && quiescence) return quiesce(p, alpha, beta, ply);
+    if (interrupted()) return 0;
+    pvLength[ply] = ply;
+
+    std::vector<Move>& list = moves[ply];
+    Core::generate(p, list);
+    if (list.empty()) return -WIN + ply; // Нечем ходить — проигрыш
+    if (depth <= 0 || ply >= MAX_PLY) {
+        counters.qnodes++;
+        return eval.evaluate(p, acc);
+    }
+    counters.expanded++;
+    counters.moves += list.size();
+
+    typename Core::Undo undo;
+    const typename Eval::Accumulator saved = acc;
+    const int side = p.side;
+    for (size_t i = 0; i < list.size(); ++i) {
+        Core::make(p, list[i], undo);
+        eval.update(acc, list[i], undo, side);
+        int score = -negamax(p, depth - 1, -beta, -alpha, ply + 1);
+        Core::unmake(p, list[i], undo);
+        acc = saved;
+        if (score > alpha) {
+            alpha = score;
+            Move* row = &pv[ply * (MAX_PLY + 1)];
+            const Move* next = &pv[(ply + 1) * (MAX_PLY + 1)];
+            row[ply] = list[i];
+            for (int j = ply + 1; j < pvLength[ply + 1]; ++j) row[j] = next[j];
+            pvLength[ply] = pvLength[ply + 1];
+            if (alpha >= beta) {
+                counters.cutoffs[std::min(i, size_t(SearchStats::CUTOFF_SLOTS - 1))]++;
+                break;
+            }
+        }
+    }
+    return alpha;
+}
+
+//--Тихий поиск: за горизонтом доигрываются только взятия. Взятие обязательно, поэтому, пока оно
+//  есть, оценке позиции (stand pat) верить нельзя: перебираются все взятия, как в полном узле.
+//  Без взятий позиция тихая — оценка; без ходов вовсе — проигрыш. Цепочки вынужденных разменов
+//  так досчитываются до конца, а генератор взятий дешевле полного (тихие ходы не строятся)
+template<class V, class E>
+int AlphaBeta<V, E>::quiesce(Position& p, int alpha, int beta, int ply) {
+    if (interrupted()) return 0;
+    pvLength[ply] = ply;
+    counters.qnodes++;
+
+    std::vector<Move>& list = moves[ply];
+    Core::captures(p, list);
+    if (list.empty()) return Core::hasQuietMove(p) ? eval.evaluate(p, acc) : -WIN + ply;
+    if (ply >= MAX_PLY) return eval.evaluate(p, acc);
+
+    typename Core::Undo undo;
+    const typename Eval::Accumulator saved = acc;
+    const int side = p.side;
+    for (size_t i = 0; i < list.size(); ++i) {
+        Core::make(p, list[i], undo);
+        eval.update(acc, list[i], undo, side);
+        const int score = -quiesce(p, -beta, -alpha, ply + 1);
+        Core::unmake(p, list[i], undo);
+        acc = saved;
+        if (score > alpha) {
+            alpha = score;
+            if (alpha >= beta) {
+                counters.cutoffs[std::min(i, size_t(SearchStats::CUTOFF_SLOTS - 1))]++;
+                break;
+            }
+        }
+    }
+    return alpha;
+}
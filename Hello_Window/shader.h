@@ -6,21 +6,36 @@
 
 #include <string>
 #include <fstream>
-#include <sstream>
 #include <iostream>
 
+#include "shader_cache.h"
+
 class Shader
 {
 public:
     unsigned int ID;
+
+    // Исходники программы. Чтение не трогает GL, поэтому его можно делать в фоновом потоке
+    struct Sources
+    {
+        std::string vertex;
+        std::string fragment;
+        std::string geometry;
+        bool ok = false;
+    };
 	
-    // Конструктор генерирует шейдер "на лету"
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    // Конструктор генерирует шейдер "на лету" (или берёт готовую программу из кэша бинарников)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, ShaderCache* cache = nullptr)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath ? geometryPath : ""), cache(cache)
+    {
+        bool linked;
+        ID = build(readSources(), linked);
+    }
+
+    // 1. Получение исходного кода вершинного/фрагментного шейдера
+    Sources readSources() const
     {
-        // 1. Получение исходного кода вершинного/фрагментного шейдера
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
+        Sources sources;
         std::ifstream vShaderFile;
         std::ifstream fShaderFile;
         std::ifstream gShaderFile;
@@ -31,81 +46,43 @@ public:
         gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
         try
         {
-            // Открываем файлы
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-			
-            // Читаем содержимое файловых буферов
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-			
-            // Закрываем файлы
-            vShaderFile.close();
-            fShaderFile.close();
-			
-            // Конвертируем в строковую переменную данные из потока
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+            // Читаем файлы целиком одним вызовом
+            readFile(vShaderFile, vertexPath.c_str(), sources.vertex);
+            readFile(fShaderFile, fragmentPath.c_str(), sources.fragment);
 			
             // Если путь к геометрическому шейдеру присутствует, то также загружаем и геометрический шейдер
-            if (geometryPath != nullptr)
-            {
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
+            if (!geometryPath.empty())
+                readFile(gShaderFile, geometryPath.c_str(), sources.geometry);
+            sources.ok = true;
         }
         catch (std::ifstream::failure& e)
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-		
-        // 2. Компилируем шейдеры
-        unsigned int vertex, fragment;
-		
-        // Вершинный шейдер
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-		
-        // Фрагментный шейдер
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-		
-        // Если был дан геометрический шейдер, то компилируем его
-        unsigned int geometry;
-        if (geometryPath != nullptr)
+        return sources;
+    }
+
+    // Пересборка из новых исходников (горячая перезагрузка). Старая программа заменяется,
+    // только если новая слинковалась, иначе шейдер продолжает работать со старой
+    bool reload(const Sources& sources)
+    {
+        if (!sources.ok)
+            return false;
+        bool linked;
+        unsigned int program = build(sources, linked);
+        if (!linked)
         {
-            const char* gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            glDeleteProgram(program);
+            return false;
         }
-		
-        // Шейдерная программа
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if (geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-		
-        // После того, как мы связали шейдеры с нашей программой, удаляем их, т.к. они нам больше не нужны
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if (geometryPath != nullptr)
-            glDeleteShader(geometry);
+        glDeleteProgram(ID);
+        ID = program;
+        return true;
     }
+
+    const std::string& getVertexPath() const { return vertexPath; }
+    const std::string& getFragmentPath() const { return fragmentPath; }
+    const std::string& getGeometryPath() const { return geometryPath; }
 	
     // Активация шейдера
     void use() const
@@ -113,68 +90,160 @@ public:
         glUseProgram(ID);
     }
 	
-    // Полезные uniform-функции
+    // Полезные uniform-функции. Имя — C-строка: литерал не превращается во временную std::string
+    // (длинные имена вроде "spotLight.direction" иначе выделяли бы память на каждый вызов)
+    // ------------------------------------------------------------------------
+    void setBool(const char* name, bool value) const
+    {
+        glUniform1i(glGetUniformLocation(ID, name), (int)value);
+    }
     // ------------------------------------------------------------------------
-    void setBool(const std::string& name, bool value) const
+    void setInt(const char* name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(glGetUniformLocation(ID, name), value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string& name, int value) const
+    void setUint(const char* name, unsigned int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1ui(glGetUniformLocation(ID, name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string& name, float value) const
+    void setFloat(const char* name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(glGetUniformLocation(ID, name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string& name, const glm::vec2& value) const
+    void setVec2(const char* name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec2(const std::string& name, float x, float y) const
+    void setVec2(const char* name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(glGetUniformLocation(ID, name), x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string& name, const glm::vec3& value) const
+    void setVec3(const char* name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec3(const std::string& name, float x, float y, float z) const
+    void setVec3(const char* name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(glGetUniformLocation(ID, name), x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string& name, const glm::vec4& value) const
+    void setVec4(const char* name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec4(const std::string& name, float x, float y, float z, float w) const
+    void setVec4(const char* name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(glGetUniformLocation(ID, name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string& name, const glm::mat2& mat) const
+    void setIVec3(const char* name, int x, int y, int z) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniform3i(glGetUniformLocation(ID, name), x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string& name, const glm::mat3& mat) const
+    void setMat2(const char* name, const glm::mat2& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+    void setMat3(const char* name, const glm::mat3& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
+    }
+    // ------------------------------------------------------------------------
+    void setMat4(const char* name, const glm::mat4& mat) const
+    {
+        glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string geometryPath;
+    ShaderCache* cache;
+
+    // 2. Компиляция и связывание программы
+    unsigned int build(const Sources& sources, bool& linked)
+    {
+        // Готовый бинарник программы для этих исходников и этого драйвера
+        uint64_t cacheKey = 0;
+        if (cache && cache->enabled())
+        {
+            cacheKey = cache->key(sources.vertex, sources.fragment, sources.geometry);
+            unsigned int program = cache->load(cacheKey);
+            if (program != 0)
+            {
+                linked = true;
+                return program;
+            }
+        }
+
+        const char* vShaderCode = sources.vertex.c_str();
+        const char* fShaderCode = sources.fragment.c_str();
+        const bool hasGeometry = !geometryPath.empty();
+		
+        unsigned int vertex, fragment;
+		
+        // Вершинный шейдер
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+		
+        // Фрагментный шейдер
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        checkCompileErrors(fragment, "FRAGMENT");
+		
+        // Если был дан геометрический шейдер, то компилируем его
+        unsigned int geometry;
+        if (hasGeometry)
+        {
+            const char* gShaderCode = sources.geometry.c_str();
+            geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glCompileShader(geometry);
+            checkCompileErrors(geometry, "GEOMETRY");
+        }
+		
+        // Шейдерная программа
+        unsigned int program = glCreateProgram();
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        if (hasGeometry)
+            glAttachShader(program, geometry);
+        if (cache && cache->enabled())
+            cache->prepare(program);
+        glLinkProgram(program);
+        linked = checkCompileErrors(program, "PROGRAM");
+        if (linked && cache && cache->enabled())
+            cache->store(cacheKey, program);
+		
+        // После того, как мы связали шейдеры с нашей программой, удаляем их, т.к. они нам больше не нужны
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        if (hasGeometry)
+            glDeleteShader(geometry);
+        return program;
+    }
+
+    static void readFile(std::ifstream& file, const char* path, std::string& out)
+    {
+        file.open(path, std::ios::binary);
+        file.seekg(0, std::ios::end);
+        out.resize(size_t(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        file.read(&out[0], out.size());
+        file.close();
+    }
+
     // Полезные функции для проверки ошибок компиляции/связывания шейдеров
-    void checkCompileErrors(GLuint shader, std::string type)
+    static bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -196,6 +265,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success != 0;
     }
 };
 #endif
@@ -0,0 +1,168 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Константы ARB_get_program_binary / GL 4.1 (glad, собранный под 3.3, может их не содержать)
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+//--Кэш бинарников шейдерных программ (glGetProgramBinary/glProgramBinary).
+//  Ключ — хэш исходников вместе со строкой драйвера, поэтому смена шейдера или драйвера
+//  просто даёт промах, а несовместимый бинарник отбрасывается и программа пересобирается
+class ShaderCache {
+public:
+    explicit ShaderCache(const std::string& directory);
+
+    bool enabled() const { return supported; }
+    uint64_t key(const std::string& vertex, const std::string& fragment, const std::string& geometry) const;
+
+    // Программа из кэша или 0, если бинарника нет либо драйвер его не принял
+    unsigned int load(uint64_t key);
+    // Вызывается до glLinkProgram, чтобы драйвер сохранил бинарник
+    void prepare(unsigned int program) const;
+    void store(uint64_t key, unsigned int program);
+
+    int hits = 0, misses = 0;
+
+private:
+    typedef void (APIENTRYP GetProgramBinaryFn)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+    typedef void (APIENTRYP ProgramBinaryFn)(GLuint, GLenum, const void*, GLsizei);
+    typedef void (APIENTRYP ProgramParameteriFn)(GLuint, GLenum, GLint);
+
+    static constexpr uint32_t MAGIC = 0x42505343; // "CSPB"
+    static constexpr uint32_t VERSION = 1;
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    std::filesystem::path directory;
+    std::string driver;
+    bool supported = false;
+    GetProgramBinaryFn getProgramBinary = nullptr;
+    ProgramBinaryFn programBinary = nullptr;
+    ProgramParameteriFn programParameteri = nullptr;
+
+    std::filesystem::path pathFor(uint64_t key) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+        return directory / name;
+    }
+    static uint64_t fnv1a(uint64_t hash, const std::string& data) {
+        for (unsigned char c : data) { hash ^= c; hash *= 1099511628211ull; }
+        return (hash ^ 0xFF) * 1099511628211ull; // Разделитель, чтобы "ab"+"c" != "a"+"bc"
+    }
+};
+
+ShaderCache::ShaderCache(const std::string& directory_) : directory(directory_) {
+    getProgramBinary = reinterpret_cast<GetProgramBinaryFn>(glfwGetProcAddress("glGetProgramBinary"));
+    programBinary = reinterpret_cast<ProgramBinaryFn>(glfwGetProcAddress("glProgramBinary"));
+    programParameteri = reinterpret_cast<ProgramParameteriFn>(glfwGetProcAddress("glProgramParameteri"));
+
+    GLint formats = 0;
+    if (getProgramBinary && programBinary && programParameteri)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    supported = formats > 0;
+
+    auto str = [](GLenum name) {
+        const GLubyte* s = glGetString(name);
+        return s ? std::string(reinterpret_cast<const char*>(s)) : std::string();
+    };
+    driver = str(GL_VENDOR) + "|" + str(GL_RENDERER) + "|" + str(GL_VERSION);
+
+    if (supported) {
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec) supported = false;
+    }
+    if (!supported)
+        std::cout << "SHADER_CACHE: бинарники программ не поддерживаются, шейдеры собираются из исходников\n";
+}
+
+uint64_t ShaderCache::key(const std::string& vertex, const std::string& fragment, const std::string& geometry) const {
+    uint64_t hash = 14695981039346656037ull;
+    hash = fnv1a(hash, driver);
+    hash = fnv1a(hash, vertex);
+    hash = fnv1a(hash, fragment);
+    hash = fnv1a(hash, geometry);
+    return hash;
+}
+
+unsigned int ShaderCache::load(uint64_t key) {
+    if (!supported) return 0;
+
+    std::ifstream file(pathFor(key), std::ios::binary);
+    FileHeader header{};
+    if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || header.magic != MAGIC || header.version != VERSION || header.key != key) {
+        misses++;
+        return 0;
+    }
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size())) { misses++; return 0; }
+
+    GLuint program = glCreateProgram();
+    programBinary(program, header.format, binary.data(), GLsizei(binary.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        // Драйвер обновился или формат устарел — выбрасываем бинарник и собираем заново
+        glDeleteProgram(program);
+        file.close();
+        std::error_code ec;
+        std::filesystem::remove(pathFor(key), ec);
+        misses++;
+        return 0;
+    }
+    hits++;
+    return program;
+}
+
+void ShaderCache::prepare(unsigned int program) const {
+    if (supported) programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ShaderCache::store(uint64_t key, unsigned int program) {
+    if (!supported) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    getProgramBinary(program, length, nullptr, &format, binary.data());
+
+    FileHeader header{ MAGIC, VERSION, key, format, uint32_t(length) };
+    // Пишем во временный файл и переименовываем, чтобы прерванная запись не оставила битый кэш
+    std::filesystem::path target = pathFor(key), temp = target;
+    temp += ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file) return;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), binary.size());
+        if (!file) return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp, target, ec);
+}
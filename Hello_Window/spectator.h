@@ -0,0 +1,302 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "model.h"
+#include "shader.h"
+#include "frustum.h"
+#include "animation.h"
+#include "CheckerBoard.h"
+
+//--Снимок одной партии: то, чем внешний поток кормит зрительскую сцену
+struct BoardSnapshot {
+    static constexpr int SIZE = RussianRules::SIZE; // Лента транслирует партии на доске 8x8
+    uint8_t cells[SIZE][SIZE] = {};
+
+    // Начальная расстановка (совпадает с CheckersBoard для русских шашек)
+    static BoardSnapshot initial() {
+        BoardSnapshot s;
+        for (int r = 0; r < SIZE; ++r)
+            for (int c = 0; c < SIZE; ++c)
+                if ((r + c) % 2 == 1)
+                    s.cells[r][c] = r < 3 ? PIECE_BLACK : (r >= SIZE - 3 ? PIECE_WHITE : PIECE_NONE);
+        return s;
+    }
+};
+
+//--Зрительская сцена: N досок сеткой, общая геометрия, инстансинг и отсечение по пирамиде видимости
+class SpectatorScene {
+public:
+    SpectatorScene(const Model& table, const Model& white, const Model& black,
+        const glm::mat4& tableMatrix, glm::vec3 boardOrigin, float cellSize, float height, int count);
+    ~SpectatorScene();
+
+    void resize(int count);               // Новое число досок (пересобирает сетку)
+    void setBoard(int index, const BoardSnapshot& state); // Переход анимируется, если похож на один ход
+    const BoardSnapshot& getBoard(int index) const { return boards[index].state; }
+    int size() const { return int(boards.size()); }
+
+    float gridExtent() const { return 0.5f * pitch * float(columns); } // Половина ширины сетки
+
+    // Отрисовка всех видимых досок шейдером с инстансными матрицами (атрибуты 5-8); now — время для анимаций
+    void render(Shader& shader, const glm::mat4& viewProjection, float now);
+    int visibleBoards() const { return lastVisible; }
+    size_t activeAnimations() const { return animations.size(); }
+
+private:
+    enum Batch { TABLES, WHITE_PIECES, BLACK_PIECES, BATCH_COUNT };
+
+    struct BoardSlot {
+        BoardSnapshot state;
+        glm::vec3 offset;
+        glm::vec3 boundsMin, boundsMax;
+        std::vector<glm::mat4> white, black; // Кэш матриц фигур, пересчитывается только при изменении
+        uint8_t animating[BoardSnapshot::SIZE * BoardSnapshot::SIZE] = {}; // Фигуры в полёте не попадают в кэш
+        bool dirty = true;
+    };
+
+    Model tableModel, whiteModel, blackModel;
+    glm::mat4 tableMatrix;   // Матрица стола доски с нулевым смещением
+    glm::mat4 kingLocal;     // Переворот дамки (как в Checker::setKing)
+    glm::vec3 boardOrigin;
+    float cellSize, height, pitch;
+    int columns = 1;
+    int lastVisible = 0;
+    float clock = 0.0f; // Время последнего кадра, от него стартуют новые анимации
+
+    AnimationSystem animations;
+
+    std::vector<BoardSlot> boards;
+    std::vector<glm::mat4> upload[BATCH_COUNT];
+    unsigned int instanceVBO[BATCH_COUNT] = {};
+    size_t capacity[BATCH_COUNT] = {};
+
+    void rebuild(BoardSlot& slot);
+    void uploadBatch(Batch batch);
+    void animateTransition(int index, const BoardSnapshot& before, const BoardSnapshot& after);
+    glm::vec3 cellPosition(const BoardSlot& slot, int cell) const {
+        return slot.offset + boardOrigin + glm::vec3((cell % BoardSnapshot::SIZE) * cellSize, height, (cell / BoardSnapshot::SIZE) * cellSize);
+    }
+    static glm::mat4 withOffset(glm::mat4 m, const glm::vec3& offset) {
+        m[3] += glm::vec4(offset, 0.0f);
+        return m;
+    }
+};
+
+SpectatorScene::SpectatorScene(const Model& table, const Model& white, const Model& black,
+    const glm::mat4& tableMatrix_, glm::vec3 boardOrigin_, float cellSize_, float height_, int count)
+    : tableModel(table), whiteModel(white), blackModel(black), tableMatrix(tableMatrix_),
+    boardOrigin(boardOrigin_), cellSize(cellSize_), height(height_) {
+
+    pitch = cellSize * BoardSnapshot::SIZE + 4.0f;
+    kingLocal = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, whiteModel.checkBox().height, 0.0f));
+    kingLocal = glm::rotate(kingLocal, glm::radians(180.0f), glm::vec3(0, 0, 1));
+
+    glGenBuffers(BATCH_COUNT, instanceVBO);
+    resize(count);
+}
+
+SpectatorScene::~SpectatorScene() {
+    glDeleteBuffers(BATCH_COUNT, instanceVBO);
+}
+
+void SpectatorScene::resize(int count) {
+    animations.clear();
+    boards.assign(count, BoardSlot{});
+    columns = std::max(1, int(std::ceil(std::sqrt(double(count)))));
+    int rows = (count + columns - 1) / columns;
+
+    // Центр игрового поля доски относительно её origin
+    glm::vec3 fieldCenter = boardOrigin + glm::vec3((BoardSnapshot::SIZE - 1) * cellSize * 0.5f, 0.0f,
+                                                    (BoardSnapshot::SIZE - 1) * cellSize * 0.5f);
+    for (int i = 0; i < count; ++i) {
+        BoardSlot& slot = boards[i];
+        slot.state = BoardSnapshot::initial();
+        slot.offset = glm::vec3((i % columns - (columns - 1) * 0.5f) * pitch, 0.0f,
+                                (i / columns - (rows - 1) * 0.5f) * pitch);
+        glm::vec3 center = slot.offset + fieldCenter;
+        slot.boundsMin = center - glm::vec3(pitch * 0.5f, 2.0f, pitch * 0.5f);
+        slot.boundsMax = center + glm::vec3(pitch * 0.5f, 4.0f, pitch * 0.5f);
+        slot.white.reserve(BoardSnapshot::SIZE * BoardSnapshot::SIZE / 2);
+        slot.black.reserve(BoardSnapshot::SIZE * BoardSnapshot::SIZE / 2);
+    }
+
+    // Резервируем под худший случай, чтобы сборка кадра не выделяла память
+    upload[TABLES].reserve(count);
+    upload[WHITE_PIECES].reserve(size_t(count) * BoardSnapshot::SIZE * BoardSnapshot::SIZE / 2);
+    upload[BLACK_PIECES].reserve(size_t(count) * BoardSnapshot::SIZE * BoardSnapshot::SIZE / 2);
+}
+
+void SpectatorScene::setBoard(int index, const BoardSnapshot& state) {
+    animateTransition(index, boards[index].state, state);
+    boards[index].state = state;
+    boards[index].dirty = true;
+}
+
+//--Разбор разницы двух снимков: одна фигура сменила клетку — скольжение или прыжок,
+//  пропавшие фигуры соперника — снятие, ставшая дамкой — переворот
+void SpectatorScene::animateTransition(int index, const BoardSnapshot& before, const BoardSnapshot& after) {
+    const int CELLS = BoardSnapshot::SIZE * BoardSnapshot::SIZE;
+    BoardSlot& slot = boards[index];
+
+    // Незаконченные анимации доски больше не актуальны
+    animations.cancelOwner(index);
+    std::fill(std::begin(slot.animating), std::end(slot.animating), uint8_t(0));
+
+    auto isWhite = [](uint8_t p) { return p == PIECE_WHITE || p == PIECE_WHITE_KING; };
+    auto isKing = [](uint8_t p) { return p == PIECE_WHITE_KING || p == PIECE_BLACK_KING; };
+    const uint8_t* b = &before.cells[0][0];
+    const uint8_t* a = &after.cells[0][0];
+
+    int arrived = -1, arrivals = 0;
+    for (int i = 0; i < CELLS; ++i)
+        if (a[i] != PIECE_NONE && b[i] == PIECE_NONE) { arrived = i; ++arrivals; }
+    if (arrivals != 1) return; // Не похоже на один ход (начало партии, пачка изменений)
+
+    int left = -1;
+    for (int i = 0; i < CELLS; ++i)
+        if (b[i] != PIECE_NONE && a[i] == PIECE_NONE && isWhite(b[i]) == isWhite(a[arrived])) { left = i; break; }
+    if (left < 0) return;
+
+    uint8_t batch = isWhite(a[arrived]) ? WHITE_PIECES : BLACK_PIECES;
+    float kingLift = whiteModel.checkBox().height;
+    bool wasKing = isKing(b[left]);
+    glm::vec3 lift = wasKing ? glm::vec3(0.0f, kingLift, 0.0f) : glm::vec3(0.0f);
+    float angle = wasKing ? 180.0f : 0.0f;
+    glm::vec3 from = cellPosition(slot, left) + lift, to = cellPosition(slot, arrived) + lift;
+
+    int rowDelta = std::abs(arrived / BoardSnapshot::SIZE - left / BoardSnapshot::SIZE);
+    float duration = rowDelta > 1 ? AnimationSystem::JUMP_TIME : AnimationSystem::SLIDE_TIME;
+    if (rowDelta > 1) animations.jump(index, arrived, batch, from, to, angle, clock);
+    else animations.slide(index, arrived, batch, from, to, angle, clock);
+    slot.animating[arrived]++;
+
+    if (!wasKing && isKing(a[arrived])) {
+        animations.kingFlip(index, arrived, batch, to, kingLift, clock + duration);
+        slot.animating[arrived]++;
+    }
+
+    // Снятые фигуры соперника исчезают, когда над ними проходит прыжок
+    for (int i = 0; i < CELLS; ++i)
+        if (b[i] != PIECE_NONE && a[i] == PIECE_NONE && i != left) {
+            uint8_t capturedBatch = isWhite(b[i]) ? WHITE_PIECES : BLACK_PIECES;
+            glm::vec3 at = cellPosition(slot, i) + (isKing(b[i]) ? glm::vec3(0.0f, kingLift, 0.0f) : glm::vec3(0.0f));
+            animations.remove(index, i, capturedBatch, at, isKing(b[i]) ? 180.0f : 0.0f, clock + duration * 0.5f);
+        }
+}
+
+void SpectatorScene::rebuild(BoardSlot& slot) {
+    slot.white.clear();
+    slot.black.clear();
+    for (int r = 0; r < BoardSnapshot::SIZE; ++r) {
+        for (int c = 0; c < BoardSnapshot::SIZE; ++c) {
+            uint8_t piece = slot.state.cells[r][c];
+            if (piece == PIECE_NONE || slot.animating[r * BoardSnapshot::SIZE + c]) continue;
+
+            glm::vec3 pos = slot.offset + boardOrigin + glm::vec3(c * cellSize, height, r * cellSize);
+            bool king = piece == PIECE_WHITE_KING || piece == PIECE_BLACK_KING;
+            glm::mat4 m = withOffset(king ? kingLocal : glm::mat4(1.0f), pos);
+
+            if (piece == PIECE_WHITE || piece == PIECE_WHITE_KING) slot.white.push_back(m);
+            else slot.black.push_back(m);
+        }
+    }
+    slot.dirty = false;
+}
+
+void SpectatorScene::uploadBatch(Batch batch) {
+    const std::vector<glm::mat4>& data = upload[batch];
+    if (data.empty()) return;
+
+    size_t bytes = data.size() * sizeof(glm::mat4);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO[batch]);
+    if (bytes > capacity[batch]) capacity[batch] = bytes * 2;
+    // Сиротим старое хранилище, чтобы не ждать GPU, читающий прошлый кадр
+    glBufferData(GL_ARRAY_BUFFER, capacity[batch], nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SpectatorScene::render(Shader& shader, const glm::mat4& viewProjection, float now) {
+    Frustum frustum = Frustum::fromMatrix(viewProjection);
+    for (auto& batch : upload) batch.clear();
+    clock = now;
+
+    // Анимированные фигуры пишутся сразу в массивы экземпляров; закончившие возвращаются в кэш доски
+    animations.update(now, upload);
+    for (const auto& f : animations.finished()) {
+        BoardSlot& slot = boards[f.owner];
+        if (f.kind != AnimationSystem::REMOVE && slot.animating[f.key] > 0) slot.animating[f.key]--;
+        slot.dirty = true;
+    }
+
+    lastVisible = 0;
+    for (auto& slot : boards) {
+        if (!frustum.intersectsAABB(slot.boundsMin, slot.boundsMax)) continue;
+        ++lastVisible;
+
+        if (slot.dirty) rebuild(slot);
+        upload[TABLES].push_back(withOffset(tableMatrix, slot.offset));
+        upload[WHITE_PIECES].insert(upload[WHITE_PIECES].end(), slot.white.begin(), slot.white.end());
+        upload[BLACK_PIECES].insert(upload[BLACK_PIECES].end(), slot.black.begin(), slot.black.end());
+    }
+
+    for (int b = 0; b < BATCH_COUNT; ++b)
+        uploadBatch(Batch(b));
+
+    shader.use();
+    tableModel.DrawInstanced(shader, instanceVBO[TABLES], unsigned(upload[TABLES].size()));
+    whiteModel.DrawInstanced(shader, instanceVBO[WHITE_PIECES], unsigned(upload[WHITE_PIECES].size()));
+    blackModel.DrawInstanced(shader, instanceVBO[BLACK_PIECES], unsigned(upload[BLACK_PIECES].size()));
+}
+
+//--Поток партий для зрительской сцены (демо и стресс-тест): на каждой доске идёт своя партия случайными
+//  допустимыми ходами русских шашек. Кончилась партия или затянулась — доска начинает новую
+class SpectatorFeed {
+public:
+    explicit SpectatorFeed(uint32_t seed) : rng(seed) { legal.reserve(64); }
+    // updates ходов на случайных досках
+    void update(SpectatorScene& scene, int updates);
+
+private:
+    using Core = Rules<RussianRules>;
+    static constexpr int MAX_PLIES = 200; // Дамки без взятий могут кружить бесконечно
+
+    struct Game {
+        Core::Position position = Core::initial();
+        int plies = 0;
+    };
+
+    std::mt19937 rng;
+    std::vector<Game> games;
+    std::vector<Core::Move> legal; // Рабочий список ходов: кадр не выделяет память
+};
+
+void SpectatorFeed::update(SpectatorScene& scene, int updates) {
+    // resize расставляет на всех досках начальную позицию: партии начинаются заново
+    if (games.size() != size_t(scene.size())) games.assign(scene.size(), Game{});
+    if (games.empty()) return;
+    std::uniform_int_distribution<int> boardIndex(0, scene.size() - 1);
+
+    for (int u = 0; u < updates; ++u) {
+        const int i = boardIndex(rng);
+        Game& game = games[i];
+        legal.clear();
+        if (game.plies < MAX_PLIES) Core::generate(game.position, legal);
+        if (legal.empty()) game = Game{};
+        else {
+            Core::apply(game.position, legal[rng() % legal.size()]);
+            game.plies++;
+        }
+
+        BoardSnapshot s;
+        Core::toCells(game.position, s.cells);
+        scene.setBoard(i, s);
+    }
+}
@@ -1,33 +1,19 @@
 #version 330 core
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out uint ObjectId;   // Буфер номеров для выбора (IdPicker); без него запись отбрасывается
 
 struct Material {
     sampler2D diffuse;
     sampler2D specular;
     float shininess;
-}; 
+};
 
 struct DirLight {
     vec3 direction;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
 
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
-  
-    float constant;
-    float linear;
-    float quadratic;
-  
     vec3 ambient;
     vec3 diffuse;
-    vec3 specular;       
+    vec3 specular;
 };
 
 in vec3 FragPos;
@@ -35,74 +21,102 @@ in vec3 Normal;
 in vec2 TexCoords;
 
 uniform vec3 viewPos;
+uniform mat4 view;
 uniform DirLight dirLight;
-uniform SpotLight spotLight;
 uniform Material material;
+uniform uint objectId;
+
+// Точечные источники и прожекторы разложены по кластерам вида на CPU (lights.h):
+// фрагмент перебирает только источники своего кластера
+uniform samplerBuffer lightData;     // 4 texel на источник: (позиция, range), (цвет, linear), (направление, quadratic), (cutOff, outerCutOff)
+uniform usamplerBuffer clusterGrid;  // (смещение, число источников) на кластер
+uniform usamplerBuffer lightIndices;
+uniform ivec3 clusterCount;          // Плиток по X, по Y и слоёв глубины
+uniform vec2 clusterTile;            // Размер плитки в пикселях
+uniform vec2 clusterDepth;           // Слой = log(глубина) * x - y
 
 // Прототипы функций
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
+vec3 CalcLight(int index, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
 
 void main()
-{    
+{
     // Свойства
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
-    
+    vec3 diffuseColor = vec3(texture(material.diffuse, TexCoords));
+    vec3 specularColor = vec3(texture(material.specular, TexCoords));
+
     // Этап №1: Направленное освещение
-    vec3 result = CalcDirLight(dirLight, norm, viewDir); 
-    // Этап №2: Прожектор
-    result += CalcSpotLight(spotLight, norm, FragPos, viewDir);    
-    
+    vec3 result = CalcDirLight(dirLight, norm, viewDir, diffuseColor, specularColor);
+
+    // Этап №2: Источники кластера, в который попал фрагмент
+    float depth = -(view * vec4(FragPos, 1.0)).z;
+    int slice = clamp(int(log(max(depth, 1e-4)) * clusterDepth.x - clusterDepth.y), 0, clusterCount.z - 1);
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy / clusterTile), ivec2(0), clusterCount.xy - 1);
+    uvec2 range = texelFetch(clusterGrid, tile.x + clusterCount.x * (tile.y + clusterCount.y * slice)).xy;
+    for (uint i = 0u; i < range.y; ++i)
+        result += CalcLight(int(texelFetch(lightIndices, int(range.x + i)).r), norm, FragPos, viewDir, diffuseColor, specularColor);
+
     FragColor = vec4(result, 1.0);
+    ObjectId = objectId;
 }
 
 // Вычисляем цвет при использовании направленного света
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor)
 {
     vec3 lightDir = normalize(-light.direction);
-	
+
     // Диффузное затенение
     float diff = max(dot(normal, lightDir), 0.0);
-	
+
     // Отраженное затенение
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-	
+
     // Совмещаем результаты
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
     return (ambient + diffuse + specular);
 }
 
-// Вычисляем цвет при использовании прожектора
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+// Вычисляем цвет от точечного источника или прожектора из списка кластера
+vec3 CalcLight(int index, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor)
 {
-    vec3 lightDir = normalize(light.position - fragPos);
-	
+    vec4 positionRange = texelFetch(lightData, index * 4);
+    vec4 colorLinear = texelFetch(lightData, index * 4 + 1);
+    vec4 directionQuadratic = texelFetch(lightData, index * 4 + 2);
+    vec2 cone = texelFetch(lightData, index * 4 + 3).xy;
+
+    vec3 toLight = positionRange.xyz - fragPos;
+    float distance = length(toLight);
+    if (distance >= positionRange.w)
+        return vec3(0.0);
+    vec3 lightDir = toLight / distance;
+
     // Диффузное затенение
     float diff = max(dot(normal, lightDir), 0.0);
-	
+
     // Отраженное затенение
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-	
-    // Затухание
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance)); 
-	
-    // Интенсивность прожектора
-    float theta = dot(lightDir, normalize(-light.direction)); 
-    float epsilon = light.cutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
-	
+
+    // Затухание; к границе range свет плавно гаснет, чтобы не обрываться на краю кластеров
+    float attenuation = 1.0 / (1.0 + colorLinear.w * distance + directionQuadratic.w * (distance * distance));
+    float edge = distance / positionRange.w;
+    edge = clamp(1.0 - edge * edge * edge * edge, 0.0, 1.0);
+    attenuation *= edge * edge;
+
+    // Интенсивность прожектора (у точечного источника outerCutOff = -1)
+    float intensity = 1.0;
+    if (cone.y > -1.0) {
+        float theta = dot(lightDir, normalize(-directionQuadratic.xyz));
+        intensity = clamp((theta - cone.y) / (cone.x - cone.y), 0.0, 1.0);
+    }
+
     // Совмещаем результаты
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    ambient *= attenuation * intensity;
-    diffuse *= attenuation * intensity;
-    specular *= attenuation * intensity;
-    return (ambient + diffuse + specular);
-}
\ No newline at end of file
+    vec3 diffuse = colorLinear.rgb * diff * diffuseColor;
+    vec3 specular = colorLinear.rgb * spec * specularColor;
+    return (diffuse + specular) * attenuation * intensity;
+}
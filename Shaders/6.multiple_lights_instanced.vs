@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 5) in mat4 aInstanceModel; // Матрица модели экземпляра (занимает атрибуты 5-8)
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    FragPos = vec3(aInstanceModel * vec4(aPos, 1.0));
+    // В экземплярах только поворот, равномерный масштаб и перенос, поэтому обратная транспонированная матрица не нужна
+    Normal = mat3(aInstanceModel) * aNormal;
+    TexCoords = aTexCoords;
+    
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file